@@ -0,0 +1,662 @@
+#include "../src/perfcounters.h"
+#include "romgen.h"
+#include <Chip8/Analysis.h>
+#include <Chip8/Board.h>
+#include <Chip8/Breakpoints.h>
+#include <Chip8/FrameRecorder.h>
+#include <Chip8/History.h>
+#include <Chip8/Instruction.h>
+#include <Chip8/Memory.h>
+#include <Chip8/SharedEnv.h>
+#include <Chip8/TerminalVideo.h>
+#include <Chip8/Trace.h>
+#include <Chip8/Upscaler.h>
+#include <Chip8/Video.h>
+#include <Chip8/VideoAtlas.h>
+#include <Chip8/WavAudio.h>
+#include <algorithm>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <chip8.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Every case reports
+//  bytes_allocated - heap bytes requested per iteration
+//  instructions    - Chip8 instructions executed (or decoded) per second,
+//                    where the case runs any
+// next to the time per iteration. With --perf, hardware counters are added
+// per emulated instruction (hw_*_per_instr) or else per iteration. Compare
+// runs with
+//  Chip8_bench --benchmark_format=json > result.json
+
+namespace {
+std::atomic<std::uint64_t> g_allocated(0);
+// Set by --perf when the counters could be opened
+Chip8::PerfCounters *g_perf = nullptr;
+} // namespace
+
+void *operator new(std::size_t size) {
+  g_allocated.fetch_add(size, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+class Counters {
+  benchmark::State &m_state;
+  std::uint64_t m_allocated;
+  std::uint64_t m_instructions = 0;
+
+public:
+  explicit Counters(benchmark::State &state)
+      : m_state(state), m_allocated(g_allocated.load()) {
+    if (g_perf)
+      g_perf->start();
+  }
+  ~Counters() {
+    Chip8::PerfCounters::Sample sample;
+    if (g_perf)
+      sample = g_perf->stop();
+    const double allocated = g_allocated - m_allocated;
+    m_state.counters["bytes_allocated"] =
+        benchmark::Counter(allocated, benchmark::Counter::kAvgIterations);
+    if (m_instructions)
+      m_state.counters["instructions"] = benchmark::Counter(
+          static_cast<double>(m_instructions), benchmark::Counter::kIsRate);
+    if (g_perf)
+      addPerf(sample);
+  }
+  void instructions(std::uint64_t count) { m_instructions += count; }
+
+private:
+  void addPerf(const Chip8::PerfCounters::Sample &sample) {
+    for (int it = 0; it < Chip8::PerfCounters::EventCount; ++it) {
+      if (!sample.valid[it])
+        continue;
+      std::string name = std::string("hw_") + Chip8::PerfCounters::name(
+                             static_cast<Chip8::PerfCounters::Event>(it));
+      const double value = static_cast<double>(sample.values[it]);
+      if (m_instructions)
+        m_state.counters[name + "_per_instr"] = value / m_instructions;
+      else
+        m_state.counters[name + "_per_iter"] = benchmark::Counter(
+            value, benchmark::Counter::kAvgIterations);
+    }
+  }
+};
+
+std::shared_ptr<Chip8::Board> makeBoard() {
+  return std::make_shared<Chip8::Board>(std::make_shared<Chip8::Video>(),
+                                        std::make_shared<Chip8::Audio>());
+}
+
+std::vector<std::uint8_t> toBytes(const std::vector<std::uint16_t> &code) {
+  std::vector<std::uint8_t> rom;
+  for (auto op : code) {
+    rom.push_back(op >> 8);
+    rom.push_back(op & 0xFF);
+  }
+  return rom;
+}
+
+// Setup followed by kBodySize copies of one instruction and a jump back to
+// the first copy, so nearly every step executes the measured instruction
+constexpr std::size_t kBodySize = 64;
+
+std::vector<std::uint8_t>
+loopRom(const std::vector<std::uint16_t> &setup,
+        std::uint16_t (*op)(std::uint16_t addr, std::uint16_t end)) {
+  std::vector<std::uint16_t> code(setup);
+  const std::uint16_t body = 0x200 + 2 * code.size();
+  const std::uint16_t end = body + 2 * kBodySize;
+  for (std::size_t it = 0; it < kBodySize; ++it)
+    code.push_back(op(body + 2 * it, end));
+  code.push_back(0x1000 | body);
+  // Subroutine for CALL, placed right after the jump
+  code.push_back(0x00EE);
+  return toBytes(code);
+}
+
+struct OpcodeClass {
+  const char *name;
+  std::uint16_t (*op)(std::uint16_t addr, std::uint16_t end);
+};
+
+const OpcodeClass kOpcodeClasses[] = {
+    {"LD Vx, NN", [](std::uint16_t, std::uint16_t) -> std::uint16_t {
+       return 0x6A42;
+     }},
+    {"ADD Vx, NN", [](std::uint16_t, std::uint16_t) -> std::uint16_t {
+       return 0x7A01;
+     }},
+    {"ADD Vx, Vy", [](std::uint16_t, std::uint16_t) -> std::uint16_t {
+       return 0x8AB4;
+     }},
+    {"SHL Vx", [](std::uint16_t, std::uint16_t) -> std::uint16_t {
+       return 0x8ABE;
+     }},
+    // VA is 0, every other copy is skipped
+    {"SE Vx, NN", [](std::uint16_t, std::uint16_t) -> std::uint16_t {
+       return 0x3A00;
+     }},
+    {"JP NNN", [](std::uint16_t addr, std::uint16_t) -> std::uint16_t {
+       return 0x1000 | (addr + 2);
+     }},
+    {"CALL/RET", [](std::uint16_t, std::uint16_t end) -> std::uint16_t {
+       return 0x2000 | (end + 2);
+     }},
+    {"LD I, NNN", [](std::uint16_t, std::uint16_t) -> std::uint16_t {
+       return 0xAE00;
+     }},
+    {"RND Vx, NN", [](std::uint16_t, std::uint16_t) -> std::uint16_t {
+       return 0xCA0F;
+     }},
+    {"LD B, Vx", [](std::uint16_t, std::uint16_t) -> std::uint16_t {
+       return 0xFA33;
+     }},
+    // Both advance I, every other copy moves it back to 0xE00
+    {"LD [I], Vx + LD I", [](std::uint16_t addr, std::uint16_t) {
+       return std::uint16_t((addr & 2) ? 0xFF55 : 0xAE00);
+     }},
+    {"LD Vx, [I] + LD I", [](std::uint16_t addr, std::uint16_t) {
+       return std::uint16_t((addr & 2) ? 0xFF65 : 0xAE00);
+     }},
+    {"LD DT, Vx", [](std::uint16_t, std::uint16_t) -> std::uint16_t {
+       return 0xFA15;
+     }},
+};
+
+void BM_Opcode(benchmark::State &state) {
+  const OpcodeClass &opcode = kOpcodeClasses[state.range(0)];
+  auto board = makeBoard();
+  // LD VA, 0; LD I, 0xE00
+  board->LoadBinary(loopRom({0x6A00, 0xAE00}, opcode.op));
+  board->step();
+  board->step();
+  state.SetLabel(opcode.name);
+  Counters counters(state);
+  for (auto _ : state)
+    board->step();
+  counters.instructions(state.iterations());
+}
+BENCHMARK(BM_Opcode)->DenseRange(
+    0, sizeof(kOpcodeClasses) / sizeof(kOpcodeClasses[0]) - 1);
+
+// Args: sprite height, x, y
+void BM_Draw(benchmark::State &state) {
+  const std::uint16_t height = state.range(0);
+  const std::uint16_t x = state.range(1);
+  const std::uint16_t y = state.range(2);
+  auto board = makeBoard();
+  // LD V0, x; LD V1, y; LD I, 0x050 (font, 80 bytes of glyphs)
+  auto rom = loopRom({static_cast<std::uint16_t>(0x6000 | x),
+                      static_cast<std::uint16_t>(0x6100 | y), 0xA050},
+                     [](std::uint16_t, std::uint16_t) {
+                       return std::uint16_t(0xD010);
+                     });
+  // DRW V0, V1, height in every copy
+  for (std::size_t it = 0; it < kBodySize; ++it)
+    rom[6 + 2 * it + 1] |= height;
+  board->LoadBinary(rom);
+  for (int it = 0; it < 3; ++it)
+    board->step();
+  Counters counters(state);
+  for (auto _ : state)
+    board->step();
+  counters.instructions(state.iterations());
+}
+BENCHMARK(BM_Draw)->ArgsProduct({{1, 5, 15}, {0, 3, 60}, {0, 28}});
+
+void BM_Reset(benchmark::State &state) {
+  auto board = makeBoard();
+  Counters counters(state);
+  for (auto _ : state)
+    board->reset();
+}
+BENCHMARK(BM_Reset);
+
+void BM_LoadBinary(benchmark::State &state) {
+  auto board = makeBoard();
+  const auto rom = Chip8::GenerateRom(1, state.range(0) / 2);
+  Counters counters(state);
+  for (auto _ : state) {
+    board->reset();
+    board->LoadBinary(rom);
+  }
+  state.SetBytesProcessed(state.iterations() * rom.size());
+}
+BENCHMARK(BM_LoadBinary)->Arg(256)->Arg(3584);
+
+void BM_Disasm(benchmark::State &state) {
+  std::uint16_t code = 0;
+  Counters counters(state);
+  for (auto _ : state) {
+    auto text = Chip8::Instruction(code++).disasm();
+    benchmark::DoNotOptimize(text);
+  }
+  counters.instructions(state.iterations());
+}
+BENCHMARK(BM_Disasm);
+
+void BM_DisasmBuffer(benchmark::State &state) {
+  std::uint16_t code = 0;
+  char text[Chip8::DisasmMaxLength];
+  Counters counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        Chip8::Instruction(code++).disasm(text, sizeof(text)));
+  }
+  counters.instructions(state.iterations());
+}
+BENCHMARK(BM_DisasmBuffer);
+
+// Control flow recovery over a ROM filling all of memory
+void BM_Analysis(benchmark::State &state) {
+  const auto rom = Chip8::GenerateRom(state.range(0), 1700);
+  Chip8::Analysis analysis;
+  for (auto _ : state) {
+    if (Chip8::ResultType::Ok != analysis.analyze(rom))
+      state.SkipWithError("ROM does not fit");
+    benchmark::DoNotOptimize(analysis.blocks().data());
+  }
+  state.SetBytesProcessed(state.iterations() * rom.size());
+}
+BENCHMARK(BM_Analysis)->Arg(1)->Arg(2);
+
+// Pixel path of SDLVideo::update without SDL: LED fade of the whole screen
+void BM_VideoLeds(benchmark::State &state) {
+  Chip8::Video video;
+  video.reset();
+  for (std::uint8_t y = 0; y < 32; y += 2)
+    for (std::uint8_t x = 0; x < 64; x += 8)
+      video.flipSprite(x, y, 0xA5 ^ y);
+  Counters counters(state);
+  for (auto _ : state) {
+    video.updateLeds();
+    benchmark::DoNotOptimize(video.leds());
+  }
+}
+BENCHMARK(BM_VideoLeds);
+
+// One frame of a sprite moving across a busy screen. Arg selects the glyphs,
+// 0 quadrant and 1 braille.
+void BM_TerminalRender(benchmark::State &state) {
+  Chip8::TerminalVideo video(
+      -1, state.range(0) ? Chip8::TerminalVideo::Glyphs::Braille
+                         : Chip8::TerminalVideo::Glyphs::Quadrant);
+  video.reset();
+  for (std::uint8_t y = 0; y < 32; y += 2)
+    for (std::uint8_t x = 0; x < 64; x += 8)
+      video.flipSprite(x, y, 0xA5 ^ y);
+  video.render();
+  std::uint8_t x = 0;
+  std::size_t bytes = 0;
+  Counters counters(state);
+  for (auto _ : state) {
+    for (std::uint8_t row = 0; row < 8; ++row)
+      video.flipSprite(x, 12 + row, 0xFF);
+    x = (x + 1) & 63;
+    for (std::uint8_t row = 0; row < 8; ++row)
+      video.flipSprite(x, 12 + row, 0xFF);
+    bytes += video.render().size();
+  }
+  state.counters["bytes_per_frame"] =
+      static_cast<double>(bytes) / state.iterations();
+}
+BENCHMARK(BM_TerminalRender)->Arg(0)->Arg(1);
+
+// CPU side of one SDLGrid frame: fade and pack Arg machines, a quarter of
+// them moving a sprite. The 60 fps budget is 16.7 ms.
+void BM_AtlasUpdate(benchmark::State &state) {
+  const std::size_t count = static_cast<std::size_t>(state.range(0));
+  std::vector<Chip8::Video> videos(count);
+  for (auto &video : videos) {
+    video.reset();
+    for (std::uint8_t y = 0; y < 32; y += 4)
+      video.flipSprite(8, y, 0xA5 ^ y);
+  }
+  Chip8::VideoAtlas atlas(count);
+  std::uint8_t x = 0;
+  std::size_t tiles = 0;
+  Counters counters(state);
+  for (auto _ : state) {
+    for (std::size_t index = 0; index < count; index += 4)
+      videos[index].flipSprite(x, 20, 0xFF);
+    x = (x + 1) & 63;
+    for (std::size_t index = 0; index < count; ++index) {
+      videos[index].updateLeds();
+      atlas.update(index, videos[index]);
+    }
+    tiles += atlas.changedTiles();
+    benchmark::DoNotOptimize(atlas.pixels() + atlas.dirtyTop() * atlas.width());
+    atlas.clearDirty();
+  }
+  state.counters["tiles/frame"] =
+      static_cast<double>(tiles) / state.iterations();
+}
+BENCHMARK(BM_AtlasUpdate)->Arg(64)->Arg(256)->Arg(1024)->Unit(
+    benchmark::kMicrosecond);
+
+// One SDLVideo frame at 1080p height (scale 30 gives 1920x960) with the
+// upscaler. Args: filter (0 nearest, 1 Scale2x), effects, SIMD level.
+void BM_Upscale(benchmark::State &state) {
+  Chip8::Upscaler upscaler(30,
+                           state.range(0) ? Chip8::UpscaleFilter::Scale2x
+                                          : Chip8::UpscaleFilter::Nearest,
+                           static_cast<unsigned>(state.range(1)));
+  upscaler.setSimd(static_cast<Chip8::SimdLevel>(state.range(2)));
+  state.SetLabel(Chip8::simdName(upscaler.simd()));
+  Chip8::Video video;
+  video.reset();
+  for (std::uint8_t y = 0; y < 32; y += 2)
+    for (std::uint8_t x = 0; x < 64; x += 8)
+      video.flipSprite(x, y, 0xA5 ^ y);
+  video.updateLeds();
+  std::vector<std::uint32_t> out(upscaler.width() * upscaler.height());
+  Counters counters(state);
+  for (auto _ : state) {
+    upscaler.run(video.leds(), out.data(), upscaler.width() * 4);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * out.size() * 4);
+}
+BENCHMARK(BM_Upscale)
+    ->ArgsProduct({{0, 1}, {0, 3}, {0, 1, 2}})
+    ->Unit(benchmark::kMicrosecond);
+
+// An hour of emulated audio at 44.1 kHz, a short beep every second, rendered
+// in the chunks WavAudio::writeWav uses
+void BM_WavRender(benchmark::State &state) {
+  auto audio = std::make_shared<Chip8::WavAudio>();
+  Chip8::Board board(std::make_shared<Chip8::Video>(), audio);
+  audio->attach(board);
+  board.setTimingMode(Chip8::TimingMode::Vip);
+  board.reset();
+  // LD V0, 10; LD ST, V0; LD V1, 60; LD DT, V1; LD V1, DT; SE V1, 0;
+  // JP 0x208; JP 0x200
+  board.LoadBinary({0x60, 0x0A, 0xF0, 0x18, 0x61, 0x3C, 0xF1, 0x15, 0xF1,
+                    0x07, 0x31, 0x00, 0x12, 0x08, 0x12, 0x00});
+  while (board.frame() < 60 * 3600)
+    board.step();
+  const unsigned rate = 44100;
+  const std::uint64_t samples =
+      Chip8::WavAudio::sampleAt(board.cycles(), rate);
+  std::vector<std::int16_t> chunk(64 * 1024);
+  Counters counters(state);
+  for (auto _ : state) {
+    for (std::uint64_t pos = 0; pos < samples; pos += chunk.size()) {
+      const std::size_t count = static_cast<std::size_t>(
+          std::min<std::uint64_t>(chunk.size(), samples - pos));
+      audio->render(rate, pos, count, chunk.data());
+      benchmark::DoNotOptimize(chunk.data());
+    }
+  }
+  state.counters["beeps"] = audio->transitions().size() / 2;
+  state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(BM_WavRender)->Unit(benchmark::kMillisecond);
+
+void BM_MemoryRead(benchmark::State &state) {
+  Chip8::Memory memory;
+  std::uint16_t addr = 0;
+  std::uint8_t value = 0;
+  Counters counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(memory.read(addr, value));
+    addr = (addr + 1) & (Chip8::MemorySize - 1);
+  }
+}
+BENCHMARK(BM_MemoryRead);
+
+void BM_MemoryWrite(benchmark::State &state) {
+  Chip8::Memory memory;
+  // Own every page, the loop measures the in-place path
+  for (std::uint16_t addr = 0; addr < Chip8::MemorySize;
+       addr += Chip8::Memory::PageSize)
+    benchmark::DoNotOptimize(memory.write(addr, 0));
+  std::uint16_t addr = 0;
+  Counters counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(memory.write(addr, addr & 0xFF));
+    addr = (addr + 1) & (Chip8::MemorySize - 1);
+  }
+}
+BENCHMARK(BM_MemoryWrite);
+
+// Fork and dirty one page: the cost of a speculative copy of a machine
+void BM_MemoryForkWrite(benchmark::State &state) {
+  Chip8::Memory memory;
+  for (std::uint16_t addr = 0; addr < Chip8::MemorySize;
+       addr += Chip8::Memory::PageSize)
+    benchmark::DoNotOptimize(memory.write(addr, 0));
+  Counters counters(state);
+  for (auto _ : state) {
+    Chip8::Memory fork = memory.fork();
+    benchmark::DoNotOptimize(fork.write(0x300, 1));
+  }
+}
+BENCHMARK(BM_MemoryForkWrite);
+
+// Whole program in VIP timing. Args: generator seed
+void BM_Rom(benchmark::State &state) {
+  constexpr std::uint64_t kSteps = 1000;
+  auto board = makeBoard();
+  board->setTimingMode(Chip8::TimingMode::Vip);
+  board->LoadBinary(Chip8::GenerateRom(state.range(0), 512));
+  Counters counters(state);
+  for (auto _ : state) {
+    for (std::uint64_t it = 0; it < kSteps; ++it)
+      board->step();
+  }
+  counters.instructions(state.iterations() * kSteps);
+  if (board->isBreak())
+    state.SkipWithError("program stopped");
+}
+BENCHMARK(BM_Rom)->Arg(1)->Arg(2)->Arg(3);
+
+// BM_Rom while recording an execution trace, compare against BM_Rom for the
+// recording overhead
+void BM_RomTraced(benchmark::State &state) {
+  constexpr std::uint64_t kSteps = 1000;
+  const char *path = "Chip8_bench.trace";
+  auto board = makeBoard();
+  board->setTimingMode(Chip8::TimingMode::Vip);
+  board->LoadBinary(Chip8::GenerateRom(state.range(0), 512));
+  auto tracer = std::make_shared<Chip8::TraceRecorder>();
+  if (Chip8::ResultType::Ok != tracer->open(path)) {
+    state.SkipWithError("cannot open trace file");
+    return;
+  }
+  board->setTracer(tracer);
+  {
+    Counters counters(state);
+    for (auto _ : state) {
+      for (std::uint64_t it = 0; it < kSteps; ++it)
+        board->step();
+    }
+    counters.instructions(state.iterations() * kSteps);
+  }
+  board->setTracer(nullptr);
+  if (Chip8::ResultType::Ok != tracer->close())
+    state.SkipWithError("trace write failed");
+  std::remove(path);
+}
+BENCHMARK(BM_RomTraced)->Arg(1)->Arg(2)->Arg(3);
+
+// Per frame cost of FrameRecorder on the emulation thread, scale 4 raw
+// output. Arg 0 repeats one picture, 1 changes it every frame. Every thread
+// records its own file, as parallel headless runs do.
+void BM_FrameCapture(benchmark::State &state) {
+  const std::string path =
+      "Chip8_bench_" + std::to_string(state.thread_index()) + ".raw";
+  Chip8::Video video;
+  video.reset();
+  Chip8::FrameRecorder recorder;
+  if (Chip8::ResultType::Ok !=
+      recorder.open(path.c_str(), Chip8::FrameFormat::Raw, 4)) {
+    state.SkipWithError("cannot open video file");
+    return;
+  }
+  std::uint8_t x = 0;
+  {
+    Counters counters(state);
+    for (auto _ : state) {
+      if (state.range(0))
+        video.flipSprite(x++ & 63, 7, 0x81);
+      recorder.capture(video);
+    }
+  }
+  if (Chip8::ResultType::Ok != recorder.close())
+    state.SkipWithError("video write failed");
+  std::remove(path.c_str());
+  std::remove((path + ".idx").c_str());
+}
+BENCHMARK(BM_FrameCapture)->Arg(0)->Arg(1)->Threads(1)->Threads(4);
+
+// Agent round trips through shared memory, the emulator serving on another
+// thread. Arg is frames run per action.
+void BM_SharedStep(benchmark::State &state) {
+  const std::string name = "/chip8_bench_" + std::to_string(getpid());
+  Chip8::SharedRegion region;
+  if (Chip8::ResultType::Ok != region.create(name.c_str(), 1)) {
+    state.SkipWithError("cannot create shared memory");
+    return;
+  }
+  const std::vector<std::uint8_t> rom = Chip8::GenerateRom(1, 512);
+  std::thread emulator([&]() {
+    auto board = makeBoard();
+    board->setTimingMode(Chip8::TimingMode::Vip);
+    board->LoadBinary(rom);
+    region.serve(*board, 0, rom);
+  });
+  Chip8::SharedSlot &slot = region.slot(0);
+  slot.framesPerAction = static_cast<std::uint16_t>(state.range(0));
+  std::uint32_t seen = 0;
+  slot.waitFrame(seen);
+  seen = slot.frameSeq.load();
+  std::uint16_t keys = 0;
+  {
+    Counters counters(state);
+    for (auto _ : state) {
+      slot.act(keys++);
+      slot.waitFrame(seen);
+      seen = slot.frameSeq.load();
+      benchmark::DoNotOptimize(slot.state.regs);
+    }
+  }
+  slot.act(0, Chip8::SharedSlot::Quit);
+  emulator.join();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedStep)->Arg(1)->Arg(4)->UseRealTime();
+
+// chip8_envs_step over Arg machines, one frame each with the observations
+// written out, as an RL training loop calls it
+void BM_CApiStep(benchmark::State &state) {
+  const unsigned count = static_cast<unsigned>(state.range(0));
+  const std::vector<std::uint8_t> rom = Chip8::GenerateRom(2, 512);
+  chip8_envs *envs = chip8_envs_create(count, rom.data(), rom.size(), 1);
+  std::vector<std::uint16_t> keys(count);
+  std::vector<std::uint8_t> out(count * CHIP8_OBSERVATION_SIZE);
+  {
+    Counters counters(state);
+    for (auto _ : state) {
+      for (auto &key : keys)
+        key = static_cast<std::uint16_t>(key * 5 + 1);
+      chip8_envs_step(envs, keys.data(), 1, out.data());
+      benchmark::DoNotOptimize(out.data());
+    }
+  }
+  chip8_envs_destroy(envs);
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_CApiStep)->Arg(1)->Arg(64)->Arg(256)->UseRealTime();
+
+// BM_Rom while indexing history for time travel, bounded so the index trims
+// itself during long runs
+void BM_RomHistory(benchmark::State &state) {
+  constexpr std::uint64_t kSteps = 1000;
+  auto board = makeBoard();
+  board->setTimingMode(Chip8::TimingMode::Vip);
+  board->LoadBinary(Chip8::GenerateRom(state.range(0), 512));
+  board->setHistory(std::make_shared<Chip8::History>(1024, 1u << 20));
+  Counters counters(state);
+  for (auto _ : state) {
+    for (std::uint64_t it = 0; it < kSteps; ++it)
+      board->step();
+  }
+  counters.instructions(state.iterations() * kSteps);
+}
+BENCHMARK(BM_RomHistory)->Arg(1)->Arg(2)->Arg(3);
+
+// BM_Rom with armed breakpoints that never stop: one conditional PC
+// breakpoint, one watchpoint and one condition evaluated on every step
+void BM_RomBreakpoints(benchmark::State &state) {
+  constexpr std::uint64_t kSteps = 1000;
+  auto board = makeBoard();
+  board->setTimingMode(Chip8::TimingMode::Vip);
+  board->LoadBinary(Chip8::GenerateRom(state.range(0), 512));
+  auto breakpoints = std::make_shared<Chip8::Breakpoints>();
+  Chip8::Condition never;
+  std::string reason;
+  if (Chip8::ResultType::Ok !=
+      never.compile("V3 == 0x10 && I > 0xFFF && PC < 0x200", reason)) {
+    state.SkipWithError(reason.c_str());
+    return;
+  }
+  breakpoints->setExec(0x202, never);
+  breakpoints->setWrite(0xFFF, 0x1000);
+  breakpoints->addCondition(never);
+  board->setBreakpoints(breakpoints);
+  Counters counters(state);
+  for (auto _ : state) {
+    for (std::uint64_t it = 0; it < kSteps; ++it)
+      board->step();
+  }
+  counters.instructions(state.iterations() * kSteps);
+}
+BENCHMARK(BM_RomBreakpoints)->Arg(1)->Arg(2)->Arg(3);
+
+} // namespace
+
+int main(int argc, char **argv) {
+  // --perf is handled here, everything else by google-benchmark
+  bool perfRequested = false;
+  int kept = 1;
+  for (int it = 1; it < argc; ++it) {
+    if (0 == std::strcmp(argv[it], "--perf"))
+      perfRequested = true;
+    else
+      argv[kept++] = argv[it];
+  }
+  argc = kept;
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  std::unique_ptr<Chip8::PerfCounters> perf;
+  if (perfRequested) {
+    perf.reset(new Chip8::PerfCounters());
+    if (perf->available())
+      g_perf = perf.get();
+    else
+      std::fprintf(stderr, "perf counters unavailable (%s)\n",
+                   perf->reason().c_str());
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include "romgen.h"
+
+namespace Chip8 {
+
+namespace {
+class Generator {
+  std::uint32_t m_state;
+
+public:
+  explicit Generator(std::uint32_t seed) : m_state(seed ? seed : 1) {}
+  std::uint32_t next() {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+  std::uint16_t below(std::uint16_t limit) { return next() % limit; }
+  std::uint16_t reg() { return below(16); }
+};
+
+std::uint16_t alu(Generator &gen) {
+  static const std::uint8_t kSubtypes[] = {0x0, 0x1, 0x2, 0x3, 0x4,
+                                           0x5, 0x6, 0x7, 0xE};
+  switch (gen.below(4)) {
+  case 0: // LD Vx, NN
+    return 0x6000 | gen.reg() << 8 | gen.below(0x100);
+  case 1: // ADD Vx, NN
+    return 0x7000 | gen.reg() << 8 | gen.below(0x100);
+  case 2: // RND Vx, NN
+    return 0xC000 | gen.reg() << 8 | gen.below(0x100);
+  default: // 8XYn
+    return 0x8000 | gen.reg() << 8 | gen.reg() << 4 |
+           kSubtypes[gen.below(sizeof(kSubtypes))];
+  }
+}
+
+// Scratch area for FX33/FX55/FX65
+constexpr std::uint16_t kScratch = 0xE00;
+// LD B, Vx; LD [I], Vx; LD Vx, [I]
+const std::uint8_t kMemoryOps[] = {0x33, 0x55, 0x65};
+constexpr std::uint16_t kCallPlaceholder = 0x2000;
+} // namespace
+
+std::vector<std::uint8_t> GenerateRom(std::uint32_t seed,
+                                      std::size_t instructions) {
+  Generator gen(seed);
+  std::vector<std::uint16_t> code;
+  while (code.size() < instructions) {
+    const std::uint16_t x = gen.reg();
+    switch (gen.below(8)) {
+    case 0: // Skip over an ALU instruction
+      switch (gen.below(4)) {
+      case 0:
+        code.push_back(0x3000 | x << 8 | gen.below(0x100));
+        break;
+      case 1:
+        code.push_back(0x4000 | x << 8 | gen.below(0x100));
+        break;
+      case 2:
+        code.push_back(0x5000 | x << 8 | gen.reg() << 4);
+        break;
+      default:
+        code.push_back(0x9000 | x << 8 | gen.reg() << 4);
+        break;
+      }
+      code.push_back(alu(gen));
+      break;
+    case 1: // Memory
+      code.push_back(0xA000 | (kScratch + gen.below(0xF0)));
+      code.push_back(0xF000 | x << 8 | kMemoryOps[gen.below(3)]);
+      break;
+    case 2: // Sprite from font or program
+      if (gen.below(2))
+        code.push_back(0xA000 | (0x050 + 5 * gen.below(16)));
+      else
+        code.push_back(0xA200 | gen.below(0x100));
+      code.push_back(0xD000 | x << 8 | gen.reg() << 4 | (1 + gen.below(15)));
+      break;
+    case 3: // Timers
+      code.push_back(0xF015 | x << 8);
+      code.push_back(0xF007 | gen.reg() << 8);
+      break;
+    case 4:
+      code.push_back(kCallPlaceholder);
+      break;
+    default:
+      code.push_back(alu(gen));
+      break;
+    }
+  }
+  // Loop back, then the subroutine called from the body
+  code.push_back(0x1200);
+  const std::uint16_t subroutine = 0x200 + 2 * code.size();
+  for (auto &op : code)
+    if (kCallPlaceholder == op)
+      op = 0x2000 | subroutine;
+  code.push_back(alu(gen));
+  code.push_back(alu(gen));
+  code.push_back(0x00EE);
+
+  std::vector<std::uint8_t> rom;
+  for (auto op : code) {
+    rom.push_back(op >> 8);
+    rom.push_back(op & 0xFF);
+  }
+  return rom;
+}
+
+} // namespace Chip8
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Chip8 {
+
+// Synthetic workload: seeded mix of ALU, skip, random, memory, draw, timer
+// and subroutine instructions run in an endless loop. It never waits for a
+// key and keeps I inside the address space, so it runs in every timing mode.
+std::vector<std::uint8_t> GenerateRom(std::uint32_t seed,
+                                      std::size_t instructions);
+
+} // namespace Chip8
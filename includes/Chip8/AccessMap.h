@@ -0,0 +1,84 @@
+#pragma once
+
+namespace Chip8 {
+class AccessMap;
+} // namespace Chip8
+
+#include <Chip8/Common.h>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace Chip8 {
+
+// Binary dump layout (AccessMap::writeBinary), host byte order:
+//   AccessMapHeader
+//   std::uint64_t read[MemorySize], write[MemorySize], exec[MemorySize]
+struct AccessMapHeader {
+  char magic[4];         // "C8AM"
+  std::uint16_t version; // AccessMapVersion
+  std::uint16_t size;    // Counters per array, MemorySize
+};
+
+constexpr std::uint16_t AccessMapVersion = 1;
+
+// Per byte read, write and execute counters over the address space. Fed by
+// Board::memoryRead, Board::memoryWrite and Board::fetch once attached with
+// Board::setAccessMap. ROM loading and tool reads (Board::peek) are not
+// counted, so a byte that is both written and executed is self-modifying
+// code.
+class AccessMap {
+public:
+  enum class Kind {
+    Code,          // Executed only
+    Data,          // Read or written, never executed
+    SelfModifying, // Executed and written
+  };
+  struct Region {
+    std::uint16_t begin;
+    std::uint16_t end; // One past the last byte
+    Kind kind;
+  };
+
+private:
+  std::array<std::uint64_t, Chip8::MemorySize> m_read;
+  std::array<std::uint64_t, Chip8::MemorySize> m_write;
+  std::array<std::uint64_t, Chip8::MemorySize> m_exec;
+
+public:
+  AccessMap() { reset(); }
+  void reset();
+
+  // addr has been checked by the memory access that triggered the count
+  void read(std::uint16_t addr) { m_read[addr]++; }
+  void write(std::uint16_t addr) { m_write[addr]++; }
+  // Instruction fetch, covers both opcode bytes
+  void execute(std::uint16_t addr) {
+    m_exec[addr]++;
+    if (addr + 1 < Chip8::MemorySize)
+      m_exec[addr + 1]++;
+  }
+
+  std::uint64_t reads(std::uint16_t addr) const { return m_read[addr]; }
+  std::uint64_t writes(std::uint16_t addr) const { return m_write[addr]; }
+  std::uint64_t executions(std::uint16_t addr) const { return m_exec[addr]; }
+
+  // Executed bytes within [begin, end), e.g. the loaded ROM
+  std::size_t executed(std::uint16_t begin, std::uint16_t end) const;
+  // Maximal runs of bytes of the same Kind, untouched bytes are skipped
+  std::vector<Region> regions() const;
+  // Bytes that were both written and executed
+  std::vector<std::uint16_t> selfModifying() const;
+
+  // One character per byte, 64 bytes per line from offset:
+  //  '.' untouched  'r' read  'w' written  'm' read and written
+  //  'x' executed   'X' executed and written
+  void printGrid(std::FILE *out, std::uint16_t offset, std::size_t lines) const;
+  void printRegions(std::FILE *out) const;
+  CHIP8_WARN_UNUSED ResultType writeBinary(const char *path) const;
+
+  static const char *kindName(Kind kind);
+};
+
+} // namespace Chip8
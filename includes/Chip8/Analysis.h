@@ -0,0 +1,87 @@
+#pragma once
+
+namespace Chip8 {
+class Analysis;
+struct BasicBlock;
+} // namespace Chip8
+
+#include <Chip8/Common.h>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace Chip8 {
+
+struct BasicBlock {
+  std::uint16_t start;
+  std::uint16_t end; // One past the last instruction byte
+  // Entry of the function (call target or program entry) owning the block
+  std::uint16_t function;
+  // Control flow leaving the block, calls are not included
+  std::vector<std::uint16_t> successors;
+  // Ends with JP V0, NNN, the targets are unknown
+  bool indirect = false;
+  // Ends with an opcode the Cpu rejects
+  bool invalid = false;
+};
+
+// Static control flow recovery over a ROM image. Follows jumps, calls and
+// both ways of every skip from the entry point to split the image into
+// basic blocks, a call graph and code versus data bytes. Everything is
+// indexed by address in flat arrays, so a whole 4K image takes one pass.
+class Analysis {
+public:
+  enum ByteKind : std::uint8_t {
+    Data = 0,
+    Opcode = 1,  // First byte of an instruction
+    Operand = 2, // Second byte of an instruction
+  };
+
+private:
+  std::vector<std::uint8_t> m_image; // Whole address space, ROM at origin
+  std::uint16_t m_origin = 0;
+  std::uint16_t m_romEnd = 0;
+  std::array<std::uint8_t, Chip8::MemorySize> m_kind;
+  std::array<bool, Chip8::MemorySize> m_leader;
+  std::array<bool, Chip8::MemorySize> m_function;
+  std::vector<BasicBlock> m_blocks;
+  // Sorted, unique (caller function, callee) pairs
+  std::vector<std::pair<std::uint16_t, std::uint16_t>> m_calls;
+
+  std::uint16_t opcode(std::uint16_t addr) const {
+    return static_cast<std::uint16_t>(m_image[addr] << 8 | m_image[addr + 1]);
+  }
+  void trace(std::uint16_t entry);
+  void buildBlocks();
+  void assignFunctions();
+  void writeInstruction(std::FILE *out, std::uint16_t addr) const;
+
+public:
+  CHIP8_WARN_UNUSED ResultType
+  analyze(const std::vector<std::uint8_t> &rom,
+          std::uint16_t origin = Chip8::ProgramStartLocation);
+
+  ByteKind kind(std::uint16_t addr) const {
+    return addr < m_kind.size() ? static_cast<ByteKind>(m_kind[addr]) : Data;
+  }
+  bool isFunction(std::uint16_t addr) const {
+    return addr < m_function.size() && m_function[addr];
+  }
+  // Sorted by start address
+  const std::vector<BasicBlock> &blocks() const { return m_blocks; }
+  const std::vector<std::pair<std::uint16_t, std::uint16_t>> &calls() const {
+    return m_calls;
+  }
+  // Block containing addr, nullptr for data
+  const BasicBlock *block(std::uint16_t addr) const;
+  // ROM bytes reached as code
+  std::size_t codeBytes() const;
+
+  // Labeled listing, data runs are printed as db lines
+  void writeListing(std::FILE *out) const;
+  // Graphviz digraph, one node per block, calls as dashed edges
+  void writeDot(std::FILE *out) const;
+};
+
+} // namespace Chip8
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <Chip8/SpscQueue.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Chip8 {
+
+// Blocks filled on one producer thread are handed over lock-free to a writer
+// thread, which passes each to the write function and returns it through a
+// second queue for reuse. The producer never waits for the writer: blocks
+// that do not fit into the queue wait in a backlog on the producer side and
+// the pool grows instead. Block needs a size member, 0 meaning empty. Used
+// by TraceRecorder and FrameRecorder.
+template <typename Block> class BlockWriter {
+public:
+  using Write = std::function<bool(const Block &)>;
+  static constexpr std::size_t Depth = 64;
+
+private:
+  Write m_write;
+  std::thread m_thread;
+  // Every Block ever allocated, the queues pass raw pointers around
+  std::vector<std::unique_ptr<Block>> m_blocks;
+  SpscQueue<Block *, Depth> m_full; // Producer -> writer
+  SpscQueue<Block *, Depth> m_free; // Writer -> producer
+  Block *m_block = nullptr;
+  // Producer thread only, full blocks waiting for room in m_full
+  std::deque<Block *> m_backlog;
+  // Writer thread only, written blocks waiting for room in m_free
+  std::vector<Block *> m_spare;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::atomic<bool> m_stop{false};
+  std::atomic<bool> m_failed{false};
+
+  // Oldest first, false while the writer is still a full queue behind
+  bool flush() {
+    while (!m_backlog.empty() && m_full.push(m_backlog.front()))
+      m_backlog.pop_front();
+    return m_backlog.empty();
+  }
+
+  void loop() {
+    while (true) {
+      // Read before popping, every block queued before the stop is seen then
+      const bool stopping = m_stop;
+      Block *block;
+      if (m_full.pop(block)) {
+        if (!m_write(*block))
+          m_failed = true;
+        m_spare.push_back(block);
+        while (!m_spare.empty() && m_free.push(m_spare.back()))
+          m_spare.pop_back();
+        continue;
+      }
+      if (stopping)
+        return;
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait_for(lock, std::chrono::milliseconds(10));
+    }
+  }
+
+public:
+  BlockWriter() = default;
+  ~BlockWriter() {
+    if (running())
+      stop();
+  }
+  BlockWriter(const BlockWriter &) = delete;
+  BlockWriter &operator=(const BlockWriter &) = delete;
+
+  // write runs on the writer thread, false marks the output as failed
+  void start(Write write) {
+    m_write = std::move(write);
+    m_stop = false;
+    m_failed = false;
+    m_blocks.emplace_back(new Block());
+    m_block = m_blocks.back().get();
+    m_block->size = 0;
+    m_thread = std::thread(&BlockWriter::loop, this);
+  }
+  bool running() const { return m_thread.joinable(); }
+
+  // Block being filled on the producer thread
+  Block &block() { return *m_block; }
+  // Queues the current block and continues with an empty one
+  void submit() {
+    if (!flush() || !m_full.push(m_block))
+      m_backlog.push_back(m_block);
+    m_wake.notify_one();
+    if (!m_free.pop(m_block)) {
+      m_blocks.emplace_back(new Block());
+      m_block = m_blocks.back().get();
+    }
+    m_block->size = 0;
+  }
+  // Queues the last block, drains the queue and joins the writer. False
+  // when any write failed.
+  bool stop() {
+    if (m_block->size)
+      submit();
+    // Production is over, waiting for the writer is fine now
+    while (!flush()) {
+      m_wake.notify_one();
+      std::this_thread::yield();
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+    const bool ok = !m_failed;
+    m_blocks.clear();
+    m_block = nullptr;
+    m_spare.clear();
+    Block *block;
+    while (m_free.pop(block)) {
+    }
+    return ok;
+  }
+};
+
+template <typename Block> constexpr std::size_t BlockWriter<Block>::Depth;
+
+} // namespace Chip8
@@ -4,9 +4,16 @@ namespace Chip8 {
 class Board;
 } // namespace Chip8
 
+#include <Chip8/AccessMap.h>
 #include <Chip8/Audio.h>
+#include <Chip8/Breakpoints.h>
 #include <Chip8/Cpu.h>
+#include <Chip8/FrameRecorder.h>
+#include <Chip8/History.h>
 #include <Chip8/Memory.h>
+#include <Chip8/Profiler.h>
+#include <Chip8/State.h>
+#include <Chip8/Trace.h>
 #include <Chip8/Video.h>
 #include <memory>
 #include <vector>
@@ -18,9 +25,18 @@ class Board {
   std::shared_ptr<Memory> m_memory;
   std::shared_ptr<Video> m_video;
   std::shared_ptr<Audio> m_audio;
+  std::shared_ptr<Profiler> m_profiler;
+  std::shared_ptr<AccessMap> m_accessMap;
+  std::shared_ptr<TraceRecorder> m_tracer;
+  std::shared_ptr<FrameRecorder> m_frameRecorder;
+  std::shared_ptr<History> m_history;
+  std::shared_ptr<Breakpoints> m_breakpoints;
   std::array<bool, 16> m_keys;
   bool m_break = false;
   bool m_shutdown = false;
+  TimingMode m_timing = TimingMode::Host;
+  // Frames (timer ticks) elapsed since reset in TimingMode::Vip
+  std::uint64_t m_frame = 0;
 
   CHIP8_DEPRECATED Memory *memory();
 
@@ -34,16 +50,89 @@ public:
   CHIP8_DEPRECATED Audio *audio();
 
   void reset();
+  // Snapshot of everything that defines machine behaviour
+  void saveState(BoardState &state) const;
+  // saveState() without the memory image, state.memory is left alone
+  void saveCoreState(BoardState &state) const;
+  // An attached History restarts from the loaded state, unless it is the
+  // one loading it
+  void loadState(const BoardState &state);
+  // New machine in the same state, memory pages are shared copy-on-write.
+  // Breakpoint and shutdown flags are not carried over. After shareMemory()
+  // forking only reads this board, several threads may fork it at once.
+  std::shared_ptr<Board> fork(std::shared_ptr<Video> video,
+                              std::shared_ptr<Audio> audio);
+  void shareMemory() { m_memory->share(); }
+  // Read only views for tools, see Explorer and Condition
+  const Memory &memoryPages() const { return *m_memory; }
+  const Cpu &cpuView() const { return *m_cpu; }
   bool shutdown() const;
   void setShutdown();
   void step();
   void timerStep();
+  // TimingMode::Vip only: run instructions up to the next timer tick
+  void runFrame();
+
+  void setTimingMode(TimingMode mode) { m_timing = mode; }
+  TimingMode timingMode() const { return m_timing; }
+  std::uint64_t cycles() const { return m_cpu->cycles(); }
+  std::uint16_t pc() const { return m_cpu->pc(); }
+  std::uint64_t frame() const { return m_frame; }
+  // RNG seed, takes effect on next reset()
+  void setSeed(std::uint32_t v) { m_cpu->seed(v); }
+  std::uint32_t seed() const { return m_cpu->seed(); }
+
+  // Fed from step() only in CHIP8_ENABLE_PROFILER builds
+  void setProfiler(const std::shared_ptr<Profiler> &profiler) {
+    m_profiler = profiler;
+  }
+  const std::shared_ptr<Profiler> &profiler() const { return m_profiler; }
+
+  // Counts memory accesses from now on, nullptr detaches
+  void setAccessMap(const std::shared_ptr<AccessMap> &map) {
+    m_accessMap = map;
+  }
+  const std::shared_ptr<AccessMap> &accessMap() const { return m_accessMap; }
+
+  // Records every executed instruction, nullptr detaches
+  void setTracer(const std::shared_ptr<TraceRecorder> &tracer) {
+    m_tracer = tracer;
+  }
+  const std::shared_ptr<TraceRecorder> &tracer() const { return m_tracer; }
+
+  // Captures the screen at every timer tick, nullptr detaches
+  void setFrameRecorder(const std::shared_ptr<FrameRecorder> &recorder) {
+    m_frameRecorder = recorder;
+  }
+  const std::shared_ptr<FrameRecorder> &frameRecorder() const {
+    return m_frameRecorder;
+  }
+
+  // Indexes every step from now on for time travel, nullptr detaches
+  void setHistory(const std::shared_ptr<History> &history) {
+    m_history = history;
+    if (m_history)
+      m_history->attach(*this);
+  }
+  const std::shared_ptr<History> &history() const { return m_history; }
+
+  // Checked on every step and memory access while attached, attach only
+  // while something is armed
+  void setBreakpoints(const std::shared_ptr<Breakpoints> &breakpoints) {
+    m_breakpoints = breakpoints;
+  }
+  const std::shared_ptr<Breakpoints> &breakpoints() const {
+    return m_breakpoints;
+  }
 
   void setBreak(bool v) { m_break = v; }
   bool isBreak() const { return m_break; }
 
   void handleKey(uint8_t key, bool down);
   bool isKeyDown(uint8_t key);
+  // Blocked in LD Vx, K with both timers stopped, nothing but the cycle
+  // count changes until a key goes down
+  bool isIdleKeyWait() const;
 
   // Memory access over board
   CHIP8_WARN_UNUSED ResultType memoryWrite(std::uint16_t addr,
@@ -52,6 +141,11 @@ public:
                                           std::uint8_t &out);
   CHIP8_WARN_UNUSED ResultType memoryRead(std::uint16_t addr,
                                           std::uint16_t &out);
+  // Opcode fetch, counted as execution by the access map
+  CHIP8_WARN_UNUSED ResultType fetch(std::uint16_t addr, std::uint16_t &out);
+  // Reads for tools (debugger, profiler), never counted
+  CHIP8_WARN_UNUSED ResultType peek(std::uint16_t addr, std::uint8_t &out);
+  CHIP8_WARN_UNUSED ResultType peek(std::uint16_t addr, std::uint16_t &out);
   CHIP8_WARN_UNUSED ResultType fontPtr(uint8_t font, uint16_t &offset);
 
   // Video access over board
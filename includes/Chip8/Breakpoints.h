@@ -0,0 +1,136 @@
+#pragma once
+
+namespace Chip8 {
+class Breakpoints;
+class Condition;
+} // namespace Chip8
+
+#include <Chip8/Common.h>
+#include <bitset>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8 {
+
+class Board;
+
+// Break condition compiled once into stack machine bytecode. Grammar, lowest
+// precedence first:
+//   a || b, a && b, == != < <= > >=, |, ^, &, + -, unary ! - ~
+// Operands: numbers (decimal or 0x hex), V0-VF, I, PC, DT, ST and [expr]
+// for the memory byte at expr. Bitwise operators bind tighter than
+// comparisons, so "V0 & 1 == 1" tests the low bit.
+class Condition {
+public:
+  enum class Op : std::uint8_t {
+    Push, // Operand follows in m_operands
+    Reg,  // Register index in m_operands
+    I,
+    Pc,
+    Dt,
+    St,
+    Load, // Memory byte at top of stack
+    Neg,
+    Not,
+    Inv,
+    Add,
+    Sub,
+    And,
+    Xor,
+    Or,
+    Eq,
+    Ne,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+    LogicalAnd,
+    LogicalOr,
+  };
+
+private:
+  std::vector<Op> m_code;
+  std::vector<std::int32_t> m_operands;
+  std::string m_text;
+  std::size_t m_depth = 0; // Stack slots evaluate() needs
+
+  friend class ConditionParser;
+
+public:
+  // On error, reason holds a message with the failing position
+  CHIP8_WARN_UNUSED ResultType compile(const char *text, std::string &reason);
+  bool evaluate(const Board &board) const;
+  const std::string &text() const { return m_text; }
+  bool empty() const { return m_code.empty(); }
+};
+
+// PC breakpoints and memory watchpoints as bitsets over the address space,
+// plus conditions checked before every step. Board::step only consults
+// them while attached with Board::setBreakpoints, and the frontend keeps
+// them detached while nothing is armed.
+class Breakpoints {
+public:
+  enum class HitKind { None, Exec, Read, Write, Condition };
+  struct Hit {
+    HitKind kind = HitKind::None;
+    std::uint16_t addr = 0;
+    std::uint16_t pc = 0;
+  };
+
+private:
+  std::bitset<Chip8::MemorySize> m_exec;
+  std::bitset<Chip8::MemorySize> m_read;
+  std::bitset<Chip8::MemorySize> m_write;
+  // Optional condition for PC breakpoints
+  std::unordered_map<std::uint16_t, Condition> m_execConditions;
+  std::vector<Condition> m_conditions;
+  Hit m_hit;
+  // Position of the last stop, resuming from it must not stop again
+  std::uint16_t m_stopPc = 0;
+  std::uint64_t m_stopCycles = UINT64_MAX;
+
+public:
+  bool armed() const {
+    return m_exec.any() || m_read.any() || m_write.any() ||
+           !m_conditions.empty();
+  }
+
+  void setExec(std::uint16_t addr, const Condition &condition = Condition());
+  void setRead(std::uint16_t begin, std::uint16_t end);
+  void setWrite(std::uint16_t begin, std::uint16_t end);
+  void addCondition(const Condition &condition) {
+    m_conditions.push_back(condition);
+  }
+  // Removes every kind of stop at addr
+  void clear(std::uint16_t addr);
+  void clearExec(std::uint16_t addr);
+  void clearRead(std::uint16_t begin, std::uint16_t end);
+  void clearWrite(std::uint16_t begin, std::uint16_t end);
+  void clearConditions() { m_conditions.clear(); }
+  void clearAll();
+
+  // Before an instruction executes, true to stop in front of it
+  bool checkStep(const Board &board);
+  // During an instruction, true to stop once it completes
+  bool checkRead(std::uint16_t addr, std::uint16_t pc) {
+    return m_read[addr] && hit(HitKind::Read, addr, pc);
+  }
+  bool checkWrite(std::uint16_t addr, std::uint16_t pc) {
+    return m_write[addr] && hit(HitKind::Write, addr, pc);
+  }
+
+  bool hit(HitKind kind, std::uint16_t addr, std::uint16_t pc) {
+    m_hit.kind = kind;
+    m_hit.addr = addr;
+    m_hit.pc = pc;
+    return true;
+  }
+  const Hit &lastHit() const { return m_hit; }
+  void clearHit() { m_hit = Hit(); }
+  void list(std::FILE *out) const;
+};
+
+} // namespace Chip8
@@ -24,4 +24,16 @@ constexpr std::uint16_t MemorySize = 0x1000;
 constexpr std::uint16_t StackSize = 0x20;
 constexpr std::uint16_t ProgramStartLocation = 0x200;
 
+// Timing model used by Board.
+//  Host - instructions and timers are driven by the frontend's host clock
+//  Vip  - every instruction is charged its COSMAC VIP machine cycle cost and
+//         timers tick each VipCyclesPerFrame emulated cycles
+enum class TimingMode {
+  Host,
+  Vip,
+};
+
+// COSMAC VIP: 1.76 MHz clock, 8 clocks per machine cycle, 60 Hz display
+constexpr std::uint32_t VipCyclesPerFrame = 3668;
+
 } // namespace Chip8
@@ -7,6 +7,7 @@ class Cpu;
 
 #include <Chip8/Common.h>
 #include <Chip8/Instruction.h>
+#include <Chip8/State.h>
 #include <array>
 
 namespace Chip8 {
@@ -22,6 +23,14 @@ class Cpu {
 
   bool m_await;
   std::uint8_t m_regKey;
+  // Opcode of the last executed instruction, for tracing
+  std::uint16_t m_opcode = 0;
+
+  // Emulated VIP machine cycles since reset
+  std::uint64_t m_cycles;
+  // xorshift32 state, restarted from m_seed on reset
+  std::uint32_t m_seed = 0x2F6B1C8Du;
+  std::uint32_t m_rng;
 
   void invalid_opcode(const Instruction &instr, Board *board);
   void setAwaitKey(uint8_t reg) {
@@ -32,18 +41,35 @@ class Cpu {
     m_await = false;
     m_Regs[m_regKey] = key;
   }
+  void charge(std::uint32_t cycles) { m_cycles += cycles; }
+  // Idle until the next vertical blank (start of the next 60 Hz frame)
+  void waitVblank() {
+    m_cycles = (m_cycles / Chip8::VipCyclesPerFrame + 1) *
+               Chip8::VipCyclesPerFrame;
+  }
 
 public:
   Cpu();
 
   void reset();
+  void saveState(BoardState &state) const;
+  void loadState(const BoardState &state);
   CHIP8_WARN_UNUSED ResultType timerStep(Board *board);
   CHIP8_WARN_UNUSED ResultType step(Board *board);
   CHIP8_WARN_UNUSED ResultType keyStep(Board *board, uint8_t key);
 
   uint8_t random();
+  // Seed takes effect on next reset(), seed 0 is replaced by the default
+  void seed(std::uint32_t v) { m_seed = v ? v : 0x2F6B1C8Du; }
+  std::uint32_t seed() const { return m_seed; }
+
+  std::uint64_t cycles() const { return m_cycles; }
 
   CHIP8_WARN_UNUSED bool isKeyAwait() const { return m_await; }
+  std::uint16_t lastOpcode() const { return m_opcode; }
+  const std::array<std::uint8_t, Chip8::StdRegisterCount> &registers() const {
+    return m_Regs;
+  }
 
   CHIP8_DEPRECATED std::uint8_t Vx(std::uint8_t x) { return m_Regs[x]; }
   CHIP8_WARN_UNUSED ResultType Vx(std::uint8_t x, std::uint8_t &out) {
@@ -60,12 +86,12 @@ public:
     m_Regs[x] = v;
     return ResultType::Ok;
   }
-  CHIP8_WARN_UNUSED std::uint16_t pc() { return m_Pc; }
+  CHIP8_WARN_UNUSED std::uint16_t pc() const { return m_Pc; }
   CHIP8_WARN_UNUSED ResultType setPc(std::uint16_t v) {
     m_Pc = v;
     return ResultType::Ok;
   }
-  CHIP8_WARN_UNUSED std::uint16_t I() { return m_I; }
+  CHIP8_WARN_UNUSED std::uint16_t I() const { return m_I; }
   CHIP8_WARN_UNUSED ResultType setI(std::uint16_t v) {
     m_I = v;
     return ResultType::Ok;
@@ -101,7 +127,7 @@ public:
     m_Dt = val;
     return ResultType::Ok;
   }
-  CHIP8_WARN_UNUSED std::uint8_t Dt() { return m_Dt; }
+  CHIP8_WARN_UNUSED std::uint8_t Dt() const { return m_Dt; }
   void decDt() {
     if (0 == m_Dt)
       return;
@@ -112,7 +138,7 @@ public:
     m_St = val;
     return ResultType::Ok;
   }
-  CHIP8_WARN_UNUSED std::uint8_t St() { return m_St; }
+  CHIP8_WARN_UNUSED std::uint8_t St() const { return m_St; }
   void decSt() {
     if (0 == m_St)
       return;
@@ -0,0 +1,130 @@
+#pragma once
+
+namespace Chip8 {
+class Explorer;
+} // namespace Chip8
+
+#include <Chip8/Board.h>
+#include <Chip8/State.h>
+#include <Chip8/ThreadPool.h>
+#include <bitset>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8 {
+
+// Input applied at a decision point: key 0x0-0xF held, or no key
+constexpr std::uint8_t ExplorerNoKey = 0x10;
+constexpr std::uint8_t ExplorerInputs = 17;
+
+struct ExplorerOptions {
+  unsigned depth = 4;          // Decision points to explore
+  unsigned framesPerInput = 8; // Frames an input is held
+  unsigned threads = 0;        // 0: one per hardware thread
+  std::size_t maxStates = 1u << 15; // Frontier limit per depth
+  std::size_t batch = 256; // Parents per parallel batch, bounds children held
+  std::uint32_t seed = 0;
+};
+
+// Breadth-first exploration of reachable machine states. Every unique state
+// is kept as a Board and expanded with all ExplorerInputs inputs on a
+// thread pool, each child a copy-on-write fork of its parent. States are
+// deduplicated by a hash of the full machine state, built from per page
+// hashes so a child only rehashes the pages it wrote. Hash hits are
+// confirmed against the stored state, a collision never prunes a state.
+class Explorer {
+public:
+  struct LevelStats {
+    unsigned depth;
+    std::size_t expanded;   // Children evaluated at this depth
+    std::size_t unique;     // New unique states
+    std::size_t coverage;   // Distinct PCs executed so far
+    double seconds;
+  };
+  struct Discovery {
+    std::uint16_t pc;
+    std::vector<std::uint8_t> inputs; // Path from power-on
+  };
+
+private:
+  struct Node {
+    std::size_t parent; // Index into m_nodes, SIZE_MAX for root
+    std::uint8_t input;
+  };
+  using PageHashes = std::array<std::uint64_t, Memory::PageCount>;
+  // BoardState from seed up to memory, then the screen: everything but
+  // time and memory
+  static constexpr std::size_t CoreBegin = offsetof(BoardState, seed);
+  static constexpr std::size_t CoreSize =
+      offsetof(BoardState, memory) - CoreBegin + PackedScreenSize;
+  // Machine state without time, kept to confirm hash hits. Pages are shared
+  // with the board the state came from.
+  struct Snapshot {
+    std::array<std::uint8_t, CoreSize> core;
+    Memory::PageRefs pages;
+
+    bool operator==(const Snapshot &other) const;
+  };
+  // Unique state waiting to be expanded
+  struct Entry {
+    std::shared_ptr<Board> board;
+    std::size_t node;
+    PageHashes pageHashes;
+  };
+  struct Child {
+    std::shared_ptr<Board> board;
+    Snapshot snapshot;
+    PageHashes pageHashes;
+    std::uint64_t hash;
+    std::size_t parent;
+    std::uint8_t input;
+    std::vector<std::uint16_t> newPcs;
+  };
+
+  ExplorerOptions m_options;
+  std::vector<std::uint8_t> m_rom;
+  ThreadPool m_pool;
+  // Per worker scratch
+  std::vector<BoardState> m_states;
+  std::vector<std::bitset<Chip8::MemorySize>> m_seen;
+
+  std::vector<Node> m_nodes;
+  std::unordered_multimap<std::uint64_t, Snapshot> m_visited;
+  std::bitset<Chip8::MemorySize> m_coverage;
+  std::vector<Discovery> m_discoveries;
+  std::vector<LevelStats> m_levels;
+
+  void evaluate(const Entry &from, std::uint8_t input, unsigned worker,
+                Child &child);
+  // Stores the state unless an equal one was seen, false for a duplicate
+  bool visit(std::uint64_t hash, const Snapshot &snapshot);
+  static void takeCore(const BoardState &state,
+                       std::array<std::uint8_t, CoreSize> &core);
+  static std::uint64_t hashPage(std::uint16_t page, const std::uint8_t *data);
+  static std::uint64_t combine(const std::array<std::uint8_t, CoreSize> &core,
+                               const PageHashes &pages);
+  std::vector<std::uint8_t> path(std::size_t node) const;
+
+public:
+  Explorer(const std::vector<std::uint8_t> &rom,
+           const ExplorerOptions &options);
+
+  void run();
+
+  const std::vector<LevelStats> &levels() const { return m_levels; }
+  const std::vector<Discovery> &discoveries() const { return m_discoveries; }
+  std::size_t coverage() const { return m_coverage.count(); }
+  std::size_t uniqueStates() const { return m_visited.size(); }
+  void report(std::FILE *out) const;
+
+  // Hash of machine state, ignoring time (cycles, frame). Equal to the
+  // incremental hash the explorer keeps for the same state.
+  static std::uint64_t hashState(const BoardState &state);
+  static std::string formatPath(const std::vector<std::uint8_t> &inputs);
+};
+
+} // namespace Chip8
@@ -0,0 +1,109 @@
+#pragma once
+
+namespace Chip8 {
+class FrameRecorder;
+} // namespace Chip8
+
+#include <Chip8/BlockWriter.h>
+#include <Chip8/Common.h>
+#include <Chip8/State.h>
+#include <Chip8/Video.h>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace Chip8 {
+
+// Output of FrameRecorder.
+//  Y4m - YUV4MPEG2 stream at 60 frames/s, 4:2:0, white pixels on black.
+//        Repeated frames are written out again, the format has no other way
+//        to hold them.
+//  Raw - 8 bit gray frames, one per run of identical frames, plus a text
+//        index next to it (path + ".idx") with one "frame repeat" line per
+//        stored frame, frame being the number of the first frame of the run.
+enum class FrameFormat {
+  Y4m,
+  Raw,
+};
+
+// Records the screen once per frame. Capturing on the emulation thread only
+// compares and copies the 256 byte packed framebuffer, runs of identical
+// frames become a repeat count. Finished runs are batched into blocks that
+// are handed over lock-free to a writer thread, which scales and writes
+// them. Every frame reaches the file and capture() never waits for the disk,
+// while the writer is behind finished blocks pile up in memory.
+class FrameRecorder {
+public:
+  static constexpr unsigned MaxScale = 16;
+  static constexpr std::size_t BlockRuns = 64;
+
+private:
+  using Packed = std::array<std::uint8_t, PackedScreenSize>;
+  struct Run {
+    Packed pixels;
+    std::uint64_t first; // Frame number of the first frame
+    std::uint32_t repeat;
+  };
+  struct Block {
+    std::size_t size;
+    Run runs[BlockRuns];
+  };
+
+  FrameFormat m_format = FrameFormat::Y4m;
+  unsigned m_scale = 1;
+  std::FILE *m_file = nullptr;
+  std::FILE *m_index = nullptr;
+  BlockWriter<Block> m_writer;
+  // Writer thread only, one scaled frame
+  std::vector<std::uint8_t> m_buffer;
+
+  // Run still growing on the emulation thread
+  Run m_pending;
+  bool m_hasPending = false;
+  std::uint64_t m_frames = 0;
+  std::uint64_t m_stored = 0;
+
+  bool writeRun(const Run &run);
+
+public:
+  FrameRecorder() = default;
+  ~FrameRecorder();
+  FrameRecorder(const FrameRecorder &) = delete;
+  FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+  // Pixels are scaled by scale (1 to MaxScale) in both directions
+  CHIP8_WARN_UNUSED ResultType open(const char *path, FrameFormat format,
+                                    unsigned scale);
+  // Called by Board at every frame boundary
+  void capture(const Video &video) {
+    Packed pixels;
+    video.pack(pixels);
+    if (m_hasPending && pixels == m_pending.pixels) {
+      m_pending.repeat++;
+    } else if (!m_hasPending) {
+      m_pending.pixels = pixels;
+      m_pending.first = m_frames;
+      m_pending.repeat = 1;
+      m_hasPending = true;
+    } else {
+      Block &block = m_writer.block();
+      block.runs[block.size++] = m_pending;
+      m_stored++;
+      if (BlockRuns == block.size)
+        m_writer.submit();
+      m_pending.pixels = pixels;
+      m_pending.first = m_frames;
+      m_pending.repeat = 1;
+    }
+    m_frames++;
+  }
+  // Flushes and joins the writer, Error when any write failed
+  CHIP8_WARN_UNUSED ResultType close();
+  bool isOpen() const { return nullptr != m_file; }
+  std::uint64_t frames() const { return m_frames; }
+  // Distinct pictures handed to the writer
+  std::uint64_t stored() const { return m_stored; }
+};
+
+} // namespace Chip8
@@ -0,0 +1,119 @@
+#pragma once
+
+namespace Chip8 {
+class History;
+} // namespace Chip8
+
+#include <Chip8/Common.h>
+#include <Chip8/State.h>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace Chip8 {
+
+class Board;
+
+// Indexed execution history for time travel. Step N is the N-th Board::step
+// since the history was attached. For every register (V0-VF, I), memory
+// address and opcode class (first nibble) it keeps the sorted list of steps
+// that wrote or executed it, so "last write before step N" is a binary
+// search. Any step can be revisited by restoring the nearest snapshot and
+// re-executing, external inputs (keys, host timer ticks) are logged and
+// replayed so the result is the original machine state. Board::loadState
+// from anywhere else starts the history over from the loaded state.
+class History {
+public:
+  // Register index of I in lastRegisterWrite()
+  static constexpr unsigned RegisterI = Chip8::StdRegisterCount;
+  static constexpr std::uint64_t None = static_cast<std::uint64_t>(-1);
+
+private:
+  struct Snapshot {
+    std::uint64_t step;
+    BoardState state;
+  };
+  struct Event {
+    std::uint64_t step; // Applied before this step executes
+    std::uint8_t key;   // EventTimer or key
+    bool down;
+  };
+  static constexpr std::uint8_t EventTimer = 0xFF;
+
+  std::uint64_t m_interval;
+  std::uint64_t m_maxSteps;
+  // Steps executed, current position in history
+  std::uint64_t m_step = 0;
+  // Steps recorded, m_step < m_end after seeking back
+  std::uint64_t m_end = 0;
+  // First step that can still be restored
+  std::uint64_t m_begin = 0;
+  bool m_replaying = false;
+
+  std::vector<Snapshot> m_snapshots;
+  std::vector<Event> m_events;
+  std::array<std::vector<std::uint64_t>, Chip8::StdRegisterCount + 1>
+      m_registers;
+  std::array<std::vector<std::uint64_t>, Chip8::MemorySize> m_memory;
+  std::array<std::vector<std::uint64_t>, 16> m_classes;
+
+  // Registers before the current step
+  std::array<std::uint8_t, Chip8::StdRegisterCount> m_regs;
+  std::uint16_t m_I = 0;
+
+  void truncate();
+  void trim();
+  static std::uint64_t lastBefore(const std::vector<std::uint64_t> &steps,
+                                  std::uint64_t step);
+
+public:
+  using Registers = std::array<std::uint8_t, Chip8::StdRegisterCount>;
+
+  explicit History(std::uint64_t snapshotInterval = 1024,
+                   std::uint64_t maxSteps = 1u << 21);
+
+  // Drop everything and start recording from the current board state
+  void attach(const Board &board);
+
+  // Board hooks, all of them ignore calls made while seek() replays
+  bool replaying() const { return m_replaying; }
+  void beginStep(const Registers &regs, std::uint16_t I) {
+    if (m_replaying)
+      return;
+    if (m_step < m_end)
+      truncate();
+    m_regs = regs;
+    m_I = I;
+  }
+  void endStep(const Board &board, const Registers &regs, std::uint16_t I,
+               std::uint16_t opcode, bool executed);
+  void memoryWritten(std::uint16_t addr) {
+    if (!m_replaying)
+      m_memory[addr].push_back(m_step);
+  }
+  void keyEvent(std::uint8_t key, bool down);
+  // Registers around the key press, LD Vx, K completes outside any step
+  void keyLoaded(const Registers &before, const Registers &after);
+  void timerEvent();
+
+  std::uint64_t step() const { return m_step; }
+  std::uint64_t begin() const { return m_begin; }
+  std::uint64_t end() const { return m_end; }
+  std::size_t bytes() const;
+
+  // Latest step before `before` that wrote / executed, or None
+  std::uint64_t lastMemoryWrite(std::uint16_t addr, std::uint64_t before) const;
+  std::uint64_t lastRegisterWrite(unsigned reg, std::uint64_t before) const;
+  std::uint64_t lastOpcodeClass(std::uint8_t nibble,
+                                std::uint64_t before) const;
+
+  // Put board in the state right before step target executes, input that
+  // arrived before it included. Any new input or step drops the recorded
+  // history after it.
+  CHIP8_WARN_UNUSED ResultType seek(Board &board, std::uint64_t target);
+
+  void report(std::FILE *out) const;
+};
+
+} // namespace Chip8
@@ -4,11 +4,15 @@ namespace Chip8 {
 class Instruction;
 } // namespace Chip8
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
 namespace Chip8 {
 
+// Buffer size fitting any disassembled instruction and its terminator
+constexpr std::size_t DisasmMaxLength = 16;
+
 class Instruction {
   std::uint16_t m_code;
 
@@ -29,6 +33,12 @@ public:
   // subtype2 extracts xxTT
   std::uint8_t subtype2() const { return 0xFF & code(); }
 
+  // False for opcodes the Cpu rejects as InvalidOpcode
+  bool valid() const;
+
   std::string disasm() const;
+  // Allocation free variant, writes at most size bytes including the
+  // terminator and returns the length written
+  std::size_t disasm(char *out, std::size_t size) const;
 };
 } // namespace Chip8
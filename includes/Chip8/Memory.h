@@ -5,19 +5,73 @@ class Memory;
 } // namespace Chip8
 
 #include <Chip8/Common.h>
+#include <Chip8/State.h>
+#include <algorithm>
 #include <array>
+#include <memory>
 #include <vector>
 
 namespace Chip8 {
 
+// Address space split into pages shared copy-on-write between forks. After
+// reset() every page refers to a pristine page shared by all instances
+// (font or zeroes), so memory held scales with the pages actually written.
 class Memory {
-  std::array<uint8_t, Chip8::MemorySize> m_data;
+public:
+  static constexpr std::uint16_t PageBits = 8;
+  static constexpr std::uint16_t PageSize = 1u << PageBits;
+  static constexpr std::uint16_t PageCount = Chip8::MemorySize / PageSize;
+  using Page = std::array<uint8_t, PageSize>;
+  using PageRefs = std::array<std::shared_ptr<const Page>, PageCount>;
+
+private:
+  std::array<std::shared_ptr<Page>, PageCount> m_pages;
+  // Bit N set: page N is private to this instance and written in place
+  std::uint16_t m_owned = 0;
+  static_assert(PageCount <= 16, "m_owned holds one bit per page");
+
+  Page &own(std::uint16_t page);
 
 public:
+  Memory();
+  Memory(Memory &&) = default;
+  Memory &operator=(Memory &&) = default;
+  Memory(const Memory &) = delete;
+  Memory &operator=(const Memory &) = delete;
+
   void reset();
+  // Copy sharing every page, both sides copy a page on their next write to
+  // it. Only reads this instance once share() was called, so such a memory
+  // may be forked from several threads at once.
+  Memory fork();
+  // Marks every page shared, the next write to any of them copies it
+  void share() { m_owned = 0; }
+  // Bit N set: page N was written since reset(), fork() or share()
+  std::uint16_t dirtyPages() const { return m_owned; }
+  const Page &page(std::uint16_t page) const { return *m_pages[page]; }
+  // References to every page, they stay unchanged only after share()
+  void pages(PageRefs &out) const {
+    std::copy(m_pages.begin(), m_pages.end(), out.begin());
+  }
+  // Pages private to this instance
+  std::size_t ownedPages() const;
+  void saveState(BoardState &state) const;
+  void loadState(const BoardState &state);
   // return bytes readen/written
-  CHIP8_WARN_UNUSED ResultType read(uint16_t offset, uint8_t &data);
-  CHIP8_WARN_UNUSED ResultType write(uint16_t offset, uint8_t data);
+  CHIP8_WARN_UNUSED ResultType read(uint16_t offset, uint8_t &data) const {
+    if (offset >= Chip8::MemorySize)
+      return ResultType::OutOfRange;
+    data = (*m_pages[offset >> PageBits])[offset & (PageSize - 1)];
+    return ResultType::Ok;
+  }
+  CHIP8_WARN_UNUSED ResultType write(uint16_t offset, uint8_t data) {
+    if (offset >= Chip8::MemorySize)
+      return ResultType::OutOfRange;
+    const std::uint16_t page = offset >> PageBits;
+    Page &dst = (m_owned & (1u << page)) ? *m_pages[page] : own(page);
+    dst[offset & (PageSize - 1)] = data;
+    return ResultType::Ok;
+  }
   CHIP8_WARN_UNUSED ResultType write_bulk(uint16_t offset,
                                           const std::vector<uint8_t> &data,
                                           uint16_t &count);
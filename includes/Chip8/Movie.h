@@ -0,0 +1,87 @@
+#pragma once
+
+namespace Chip8 {
+class MovieWriter;
+class MoviePlayer;
+} // namespace Chip8
+
+#include <Chip8/Board.h>
+#include <Chip8/Common.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+// Input movie file layout (little endian, written field by field):
+//   MovieHeader
+//   events, each one a LEB128 varint of
+//     (cycle delta since previous event << 5) | (down << 4) | key
+// Cycles are emulated VIP cycles, so movies are recorded in TimingMode::Vip.
+struct MovieHeader {
+  char magic[4];          // "C8MV"
+  std::uint16_t version;  // MovieVersion
+  std::uint8_t timing;    // TimingMode the movie was recorded with
+  std::uint8_t quirks;    // Reserved for interpreter quirk profile, 0
+  std::uint32_t seed;     // Cpu RNG seed
+  std::uint32_t romHash;  // FNV-1a of loaded ROM
+  std::uint64_t frames;   // Length of the recording in frames
+  std::uint64_t events;   // Number of events following the header
+};
+static_assert(sizeof(MovieHeader) == 32, "MovieHeader must not be padded");
+
+constexpr std::uint16_t MovieVersion = 1;
+
+std::uint32_t romHash(const std::vector<uint8_t> &rom);
+
+class MovieWriter {
+  std::FILE *m_file = nullptr;
+  MovieHeader m_header;
+  std::vector<uint8_t> m_buffer;
+  std::uint64_t m_lastCycle = 0;
+
+  void flush();
+
+public:
+  MovieWriter() = default;
+  ~MovieWriter();
+  MovieWriter(const MovieWriter &) = delete;
+  MovieWriter &operator=(const MovieWriter &) = delete;
+
+  CHIP8_WARN_UNUSED ResultType open(const char *path, const Board &board,
+                                    const std::vector<uint8_t> &rom);
+  void record(std::uint64_t cycle, std::uint8_t key, bool down);
+  // Stores final frame count and flushes buffered events
+  void close(std::uint64_t frames);
+  bool isOpen() const { return nullptr != m_file; }
+};
+
+class MoviePlayer {
+  MovieHeader m_header;
+  std::vector<uint8_t> m_data;
+  std::size_t m_pos = 0;
+  std::uint64_t m_played = 0;
+  // Next pending event
+  std::uint64_t m_cycle = 0;
+  std::uint8_t m_event = 0;
+  bool m_corrupt = false;
+
+  // Decodes the next event, false on a malformed one
+  bool next();
+
+public:
+  CHIP8_WARN_UNUSED ResultType load(const char *path);
+  const MovieHeader &header() const { return m_header; }
+  // Setup board (timing, seed) and reset it for playback
+  void prepare(Board &board) const;
+  // Inject every event due at current board cycle
+  void apply(Board &board) {
+    while (!done() && m_cycle <= board.cycles())
+      inject(board);
+  }
+  void inject(Board &board);
+  bool done() const { return m_played >= m_header.events; }
+  // Playback stopped early on a truncated or malformed event
+  bool corrupt() const { return m_corrupt; }
+};
+} // namespace Chip8
@@ -0,0 +1,103 @@
+#pragma once
+
+namespace Chip8 {
+class Profiler;
+} // namespace Chip8
+
+#include <Chip8/Common.h>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace Chip8 {
+
+// Execution profile fed by Board::step when built with
+// CHIP8_ENABLE_PROFILER. Costs are emulated cycles (see Cpu), so a profile
+// shows where the ROM spends machine time, independent of the host.
+class Profiler {
+public:
+  struct Counter {
+    std::uint64_t count = 0;
+    std::uint64_t cycles = 0;
+  };
+  struct HotSpot {
+    std::uint16_t pc;
+    Counter counter;
+  };
+
+private:
+  // CALL/RET tree, node 0 is the code outside any subroutine
+  struct Node {
+    std::uint16_t entry;
+    std::uint32_t parent;
+    std::uint64_t cycles; // Self cycles
+    std::vector<std::uint32_t> children;
+  };
+
+  std::array<Counter, Chip8::MemorySize> m_pc;
+  // Indexed by the first opcode nibble
+  std::array<Counter, 16> m_class;
+  Counter m_draw;
+  Counter m_keyWait;
+  std::uint64_t m_cycles = 0;
+  std::vector<Node> m_nodes;
+  std::uint32_t m_node = 0;
+  // Calls entered while the tree was full, attributed to m_node
+  std::uint32_t m_folded = 0;
+
+  void writeStack(std::FILE *out, std::uint32_t node) const;
+
+public:
+  Profiler();
+
+  void reset();
+  // One Board::step: instruction at pc took cycles. awaitKey is set for
+  // steps spent waiting in LD Vx, K, opcode is not executed then.
+  void record(std::uint16_t pc, std::uint16_t opcode, std::uint32_t cycles,
+              bool awaitKey) {
+    m_cycles += cycles;
+    m_nodes[m_node].cycles += cycles;
+    if (awaitKey) {
+      m_keyWait.count++;
+      m_keyWait.cycles += cycles;
+      return;
+    }
+    Counter &pcCounter = m_pc[pc % Chip8::MemorySize];
+    pcCounter.count++;
+    pcCounter.cycles += cycles;
+    Counter &classCounter = m_class[opcode >> 12];
+    classCounter.count++;
+    classCounter.cycles += cycles;
+    if (0x2000 == (opcode & 0xF000))
+      enter(opcode & 0x0FFF);
+    else if (0x00EE == opcode)
+      leave();
+    else if (0xD000 == (opcode & 0xF000)) {
+      m_draw.count++;
+      m_draw.cycles += cycles;
+    }
+  }
+  void enter(std::uint16_t entry);
+  void leave();
+
+  std::uint64_t cycles() const { return m_cycles; }
+  const Counter &pc(std::uint16_t addr) const { return m_pc[addr]; }
+  const Counter &opcodeClass(std::uint8_t nibble) const {
+    return m_class[nibble & 0xF];
+  }
+  const Counter &draw() const { return m_draw; }
+  const Counter &keyWait() const { return m_keyWait; }
+  // Most expensive PCs by cycles
+  std::vector<HotSpot> hot(std::size_t count) const;
+
+  void report(std::FILE *out) const;
+  // Collapsed stacks ("main;sub_2A0;sub_310 CYCLES" per line) for
+  // flamegraph.pl, speedscope and similar tools
+  CHIP8_WARN_UNUSED ResultType writeCollapsed(const char *path) const;
+  void writeCollapsed(std::FILE *out) const;
+
+  static const char *className(std::uint8_t nibble);
+};
+
+} // namespace Chip8
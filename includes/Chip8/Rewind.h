@@ -0,0 +1,59 @@
+#pragma once
+
+namespace Chip8 {
+class RewindBuffer;
+} // namespace Chip8
+
+#include <Chip8/State.h>
+#include <cstddef>
+#include <vector>
+
+namespace Chip8 {
+
+// Ring buffer of per-frame BoardState snapshots. Every keyframeInterval
+// captures a keyframe is stored, every other capture is stored as XOR delta
+// against the latest keyframe. Both are run-length encoded, so unchanged
+// bytes cost nearly nothing.
+class RewindBuffer {
+  struct Entry {
+    std::vector<std::uint8_t> data;
+    bool keyframe = false;
+  };
+  std::vector<Entry> m_entries;
+  std::size_t m_tail = 0; // Oldest entry
+  std::size_t m_count = 0;
+  std::size_t m_keyframeInterval;
+
+  // Latest keyframe, reference for new deltas
+  BoardState m_keyframe;
+  bool m_hasKeyframe = false;
+  std::size_t m_keyIndex = 0;
+  std::size_t m_sinceKeyframe = 0;
+
+  std::size_t index(std::size_t offset) const {
+    return (m_tail + offset) % m_entries.size();
+  }
+  void evictOldest();
+
+public:
+  RewindBuffer(std::size_t frames, std::size_t keyframeInterval = 60);
+
+  void clear();
+  void capture(const BoardState &state);
+  // Pop newest snapshot, false when history is empty
+  bool rewind(BoardState &state);
+
+  std::size_t size() const { return m_count; }
+  std::size_t capacity() const { return m_entries.size(); }
+  // Encoded bytes held by the buffer
+  std::size_t bytes() const;
+
+  // RLE of (data XOR ref), ref may be null for plain RLE
+  static void encode(const std::uint8_t *data, const std::uint8_t *ref,
+                     std::size_t size, std::vector<std::uint8_t> &out);
+  // XOR decoded runs into data, false on malformed input
+  static bool decode(const std::vector<std::uint8_t> &in, std::uint8_t *data,
+                     std::size_t size);
+};
+
+} // namespace Chip8
@@ -0,0 +1,59 @@
+#pragma once
+
+namespace Chip8 {
+class RunAhead;
+} // namespace Chip8
+
+#include <Chip8/Board.h>
+#include <Chip8/State.h>
+#include <cstdio>
+#include <memory>
+
+namespace Chip8 {
+
+// Run-ahead input latency reduction. Each frame the real board state is
+// copied into a second board, which runs frames() frames ahead with the
+// current input and draws into the presented Video. The real board itself
+// can stay headless.
+class RunAhead {
+  std::shared_ptr<Board> m_ahead;
+  unsigned m_frames;
+  BoardState m_state;
+
+  // Cost of running ahead
+  std::uint64_t m_presented = 0;
+  double m_seconds = 0;
+
+  // Latency probe: frames between key press and first changed picture, for
+  // the real board and for the presented run-ahead board. Presses that
+  // change nothing within a second, or before the next press, are counted
+  // apart so they do not bias the average.
+  BoardState m_shown;
+  std::array<std::uint8_t, PackedScreenSize> m_lastReal;
+  std::array<std::uint8_t, PackedScreenSize> m_lastShown;
+  bool m_armed = false;
+  std::uint64_t m_pressed = 0;
+  std::int64_t m_realLatency = -1;
+  std::int64_t m_shownLatency = -1;
+  std::uint64_t m_samples = 0;
+  std::uint64_t m_realTotal = 0;
+  std::uint64_t m_shownTotal = 0;
+  std::uint64_t m_unanswered = 0;
+
+public:
+  // Frames drawn by the run-ahead board go to video
+  RunAhead(std::shared_ptr<Video> video, unsigned frames);
+
+  unsigned frames() const { return m_frames; }
+  void setFrames(unsigned frames) { m_frames = frames; }
+
+  // Call once per presented frame, after the real board ran its frame
+  void present(const Board &board);
+  void keyPressed();
+  // Presses measured, and presses without a visible reaction
+  std::uint64_t samples() const { return m_samples; }
+  std::uint64_t unanswered() const { return m_unanswered; }
+  void report(std::FILE *out) const;
+};
+
+} // namespace Chip8
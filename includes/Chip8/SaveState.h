@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Chip8/Board.h>
+#include <Chip8/Common.h>
+#include <Chip8/State.h>
+
+namespace Chip8 {
+
+// Save state file layout:
+//   SaveStateHeader
+//   BoardState, raw host layout, 8 byte aligned
+// Loader maps the file and restores BoardState in place, so the header
+// carries everything needed to reject an incompatible file up front.
+struct SaveStateHeader {
+  char magic[4];            // "C8SS"
+  std::uint16_t version;    // SaveStateVersion
+  std::uint16_t headerSize; // sizeof(SaveStateHeader)
+  std::uint32_t stateSize;  // sizeof(BoardState)
+  std::uint32_t byteOrder;  // SaveStateByteOrder as written by host
+  std::uint32_t checksum;   // FNV-1a of BoardState bytes
+  std::uint8_t timing;      // TimingMode
+  std::uint8_t reserved[3];
+};
+static_assert(sizeof(SaveStateHeader) % 8 == 0,
+              "BoardState after header must stay 8 byte aligned");
+
+constexpr std::uint16_t SaveStateVersion = 1;
+constexpr std::uint32_t SaveStateByteOrder = 0x01020304;
+
+// Written to a temporary file and renamed, an existing checkpoint is never
+// left half written.
+CHIP8_WARN_UNUSED ResultType saveStateFile(const char *path,
+                                           const Board &board);
+CHIP8_WARN_UNUSED ResultType loadStateFile(const char *path, Board &board);
+
+} // namespace Chip8
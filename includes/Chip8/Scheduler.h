@@ -0,0 +1,144 @@
+#pragma once
+
+namespace Chip8 {
+class Task;
+class Scheduler;
+class Signal;
+} // namespace Chip8
+
+// C++20 only, built when the compiler supports coroutines
+// (CHIP8_HAVE_COROUTINES)
+#include <Chip8/Board.h>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <vector>
+
+namespace Chip8 {
+
+// Coroutine run by a Scheduler. Starts suspended, spawn() hands it over.
+class Task {
+public:
+  struct promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    void await_suspend(Handle handle) noexcept;
+    void await_resume() noexcept {}
+  };
+
+  struct promise_type {
+    Scheduler *scheduler = nullptr;
+    std::size_t index = 0; // Position in Scheduler::m_tasks
+
+    Task get_return_object() { return Task(Handle::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  Task(Task &&other) noexcept : m_handle(other.m_handle) {
+    other.m_handle = nullptr;
+  }
+  ~Task() {
+    if (m_handle)
+      m_handle.destroy();
+  }
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+
+private:
+  friend class Scheduler;
+  Handle m_handle;
+
+  explicit Task(Handle handle) : m_handle(handle) {}
+};
+
+// Cooperative single threaded scheduler counting in frames. Every tick
+// resumes the coroutines due in that frame, each one runs until its next
+// co_await, so a suspended machine costs a heap frame and a resume is a
+// function call. Run one scheduler per core to use more of them.
+class Scheduler {
+  friend struct Task::FinalAwaiter;
+
+  std::vector<Task::Handle> m_tasks;
+  // Resumed in the current tick, includes wake() calls made meanwhile
+  std::vector<std::coroutine_handle<>> m_ready;
+  std::vector<std::coroutine_handle<>> m_running;
+  std::vector<std::coroutine_handle<>> m_nextFrame;
+  std::map<std::uint64_t, std::vector<std::coroutine_handle<>>> m_sleeping;
+  std::vector<Task::Handle> m_finished;
+  std::uint64_t m_frame = 0;
+  std::uint64_t m_resumes = 0;
+
+  void finish(Task::Handle handle) { m_finished.push_back(handle); }
+  void reap();
+
+public:
+  struct Sleep {
+    Scheduler &scheduler;
+    std::uint64_t frames;
+
+    bool await_ready() const noexcept { return 0 == frames; }
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept {}
+  };
+
+  Scheduler() = default;
+  ~Scheduler();
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  // Starts task in the next tick
+  void spawn(Task task);
+  // co_await frames(N) resumes N ticks later, frames(0) does not suspend
+  Sleep frames(std::uint64_t count) { return Sleep{*this, count}; }
+  // Resumes handle in the running tick, or the next one between ticks
+  void wake(std::coroutine_handle<> handle) { m_ready.push_back(handle); }
+
+  void tick();
+  // Ticks until every task finished, maxFrames passed or every task waits
+  // on a Signal nobody can raise. Returns the ticks run.
+  std::uint64_t run(std::uint64_t maxFrames);
+
+  std::uint64_t frame() const { return m_frame; }
+  std::size_t alive() const { return m_tasks.size(); }
+  std::uint64_t resumes() const { return m_resumes; }
+};
+
+// Wakes every coroutine awaiting it on notify(), e.g. input for machines
+// parked on a key wait
+class Signal {
+  Scheduler &m_scheduler;
+  std::vector<std::coroutine_handle<>> m_waiters;
+
+public:
+  struct Awaiter {
+    Signal &signal;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      signal.m_waiters.push_back(handle);
+    }
+    void await_resume() const noexcept {}
+  };
+
+  explicit Signal(Scheduler &scheduler) : m_scheduler(scheduler) {}
+  Signal(const Signal &) = delete;
+  Signal &operator=(const Signal &) = delete;
+
+  Awaiter operator co_await() { return Awaiter{*this}; }
+  void notify();
+  std::size_t waiting() const { return m_waiters.size(); }
+};
+
+// Runs board for frames frames, one per scheduler tick. While the program
+// waits for a key with its timers stopped, the machine parks on input
+// instead of burning frames; its emulated clock stands still meanwhile.
+Task runBoard(Scheduler &scheduler, Board &board, Signal &input,
+              std::uint64_t frames);
+
+} // namespace Chip8
@@ -0,0 +1,101 @@
+#pragma once
+
+namespace Chip8 {
+struct SharedSlot;
+class SharedRegion;
+} // namespace Chip8
+
+#include <Chip8/Common.h>
+#include <Chip8/State.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+class Board;
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "shared handoff words must be lock-free");
+
+// One emulator instance in a shared memory region. The emulator owns state
+// and status, the agent owns keys, framesPerAction and control. Each side
+// publishes by bumping its sequence word, the other side spins on it for a
+// while and only then sleeps in FUTEX_WAIT, so a busy agent drives the
+// machine without a system call per step. Both sequences start at 0, the
+// first frame is published before the first action is awaited.
+//
+// Handoff:
+//   emulator: writes state, frameSeq++          agent: waits frameSeq change
+//   agent:    reads state, writes keys,         emulator: waits actionSeq
+//             actionSeq++                                 change, applies keys
+//                                                         and runs frames
+struct alignas(64) SharedSlot {
+  enum Status : std::uint32_t { Running, Break, Shutdown };
+  enum Control : std::uint32_t { Step, Reset, Quit };
+
+  std::atomic<std::uint32_t> frameSeq;
+  std::atomic<std::uint32_t> actionSeq;
+  // Threads of either process blocked in FUTEX_WAIT on this slot
+  std::atomic<std::uint32_t> sleepers;
+  std::uint32_t status;          // Status after the published frame
+  std::uint32_t control;         // Control applied with the next action
+  std::uint16_t keys;            // Bit N set while key N is held
+  std::uint16_t framesPerAction; // Frames run per action, 0 counts as 1
+  BoardState state;
+
+  // Emulator side
+  void publishFrame();
+  // False once the agent asked to quit
+  bool waitAction(std::uint32_t seen);
+
+  // Agent side
+  void waitFrame(std::uint32_t seen);
+  void act(std::uint16_t keysDown, Control what = Step);
+};
+
+// Header of the region, followed by the slots
+struct SharedHeader {
+  char magic[4]; // "C8SM"
+  std::uint16_t version;
+  std::uint16_t reserved;
+  std::uint32_t slotSize; // sizeof(SharedSlot)
+  std::uint32_t slots;
+};
+
+constexpr std::uint16_t SharedVersion = 1;
+
+// POSIX shared memory object holding SharedHeader and an array of
+// SharedSlot. The emulator creates it, agents open it by name.
+class SharedRegion {
+  void *m_base = nullptr;
+  std::size_t m_size = 0;
+  std::string m_name;
+  bool m_owner = false;
+
+  static std::size_t slotOffset();
+
+public:
+  SharedRegion() = default;
+  ~SharedRegion();
+  SharedRegion(const SharedRegion &) = delete;
+  SharedRegion &operator=(const SharedRegion &) = delete;
+
+  // name as for shm_open, e.g. "/chip8". An existing object is replaced.
+  CHIP8_WARN_UNUSED ResultType create(const char *name, std::uint32_t slots);
+  CHIP8_WARN_UNUSED ResultType open(const char *name);
+  // Unmaps, and unlinks the object when this side created it
+  void close();
+  bool isOpen() const { return nullptr != m_base; }
+
+  std::uint32_t slots() const;
+  SharedSlot &slot(std::uint32_t index);
+
+  // Runs board for the agent on slot index until it quits. Reset requests
+  // reload rom.
+  void serve(Board &board, std::uint32_t index,
+             const std::vector<std::uint8_t> &rom);
+};
+
+} // namespace Chip8
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Chip8 {
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// push() and pop() never block, they report full / empty instead.
+template <typename T, std::size_t Capacity> class SpscQueue {
+  static_assert(Capacity && 0 == (Capacity & (Capacity - 1)),
+                "Capacity must be a power of two");
+
+  std::array<T, Capacity> m_items;
+  // Indices grow forever and wrap through the mask, kept on separate cache
+  // lines so producer and consumer do not share one
+  alignas(64) std::atomic<std::size_t> m_head{0}; // Next to pop
+  alignas(64) std::atomic<std::size_t> m_tail{0}; // Next to push
+
+public:
+  // Producer side
+  bool push(const T &item) {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+      return false;
+    m_items[tail & (Capacity - 1)] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool pop(T &item) {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire))
+      return false;
+    item = m_items[head & (Capacity - 1)];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return m_head.load(std::memory_order_acquire) ==
+           m_tail.load(std::memory_order_acquire);
+  }
+};
+
+} // namespace Chip8
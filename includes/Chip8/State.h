@@ -0,0 +1,45 @@
+#pragma once
+
+namespace Chip8 {
+struct BoardState;
+} // namespace Chip8
+
+#include <Chip8/Common.h>
+#include <array>
+
+namespace Chip8 {
+
+constexpr std::uint16_t ScreenWidth = 64;
+constexpr std::uint16_t ScreenHeight = 32;
+// Framebuffer packed 1 bit per pixel, MSB is leftmost pixel
+constexpr std::uint16_t PackedScreenSize = ScreenWidth * ScreenHeight / 8;
+
+// Complete machine state as a flat, fixed layout block. Fields are ordered by
+// size so the struct has no padding and can be copied or XORed as raw bytes.
+struct BoardState {
+  std::uint64_t cycles;
+  std::uint64_t frame;
+  std::uint32_t seed;
+  std::uint32_t rng;
+  std::array<std::uint16_t, Chip8::StackSize> stack;
+  std::uint16_t pc;
+  std::uint16_t I;
+  std::uint16_t keys; // Bit N set when key N is down
+  std::array<std::uint8_t, Chip8::StdRegisterCount> regs;
+  std::uint8_t sp;
+  std::uint8_t dt;
+  std::uint8_t st;
+  std::uint8_t await;
+  std::uint8_t regKey;
+  std::uint8_t beep;
+  std::array<std::uint8_t, 4> reserved;
+  std::array<std::uint8_t, Chip8::MemorySize> memory;
+  std::array<std::uint8_t, PackedScreenSize> screen;
+};
+
+static_assert(sizeof(BoardState) == 8 + 8 + 4 + 4 + 2 * Chip8::StackSize +
+                                        3 * 2 + Chip8::StdRegisterCount + 10 +
+                                        Chip8::MemorySize + PackedScreenSize,
+              "BoardState must not be padded");
+
+} // namespace Chip8
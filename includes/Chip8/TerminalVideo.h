@@ -0,0 +1,67 @@
+#pragma once
+
+namespace Chip8 {
+class TerminalVideo;
+} // namespace Chip8
+
+#include <Chip8/Video.h>
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace Chip8 {
+
+// Draws the screen on a VT100 compatible terminal. Every character cell
+// covers a block of pixels, 2x2 with quadrant block glyphs or 2x4 with
+// braille. A frame emits only the cells that changed since the previous one,
+// with cursor moves in between, and goes out with a single write().
+class TerminalVideo : public Chip8::Video {
+public:
+  enum class Glyphs { Quadrant, Braille };
+
+private:
+  // Pattern of a cell not drawn yet, never equal to a real one
+  static constexpr std::uint16_t Unknown = 0x100;
+  // Enough cells for the smallest glyph, 2x2 pixels
+  static constexpr std::size_t MaxCells = 64 / 2 * 32 / 2;
+
+  int m_fd;
+  Glyphs m_glyphs;
+  std::array<std::uint16_t, MaxCells> m_cells;
+  std::string m_frame;
+  bool m_started = false;
+  std::uint64_t m_bytes = 0;
+  std::uint64_t m_frames = 0;
+
+  std::uint16_t cellWidth() const { return 2; }
+  std::uint16_t cellHeight() const {
+    return Glyphs::Braille == m_glyphs ? 4 : 2;
+  }
+  std::uint16_t pattern(std::uint16_t column, std::uint16_t row) const;
+  void putGlyph(std::uint16_t pattern);
+  void moveTo(std::uint16_t column, std::uint16_t row);
+
+public:
+  explicit TerminalVideo(int fd = 1, Glyphs glyphs = Glyphs::Braille);
+  ~TerminalVideo();
+  TerminalVideo(const TerminalVideo &) = delete;
+  TerminalVideo &operator=(const TerminalVideo &) = delete;
+
+  std::uint16_t columns() const { return 64 / cellWidth(); }
+  std::uint16_t rows() const { return 32 / cellHeight(); }
+  // Bytes for the next frame, the changes against the last rendered one
+  const std::string &render();
+  // Renders and writes the frame to the terminal
+  void update();
+  // Redraws every cell on the next frame, e.g. after the terminal was
+  // cleared or resized
+  void invalidate() { m_cells.fill(Unknown); }
+  // Moves the cursor below the picture and shows it again, the next frame
+  // starts over on a cleared terminal
+  void close();
+
+  std::uint64_t bytesWritten() const { return m_bytes; }
+  std::uint64_t framesWritten() const { return m_frames; }
+};
+
+} // namespace Chip8
@@ -0,0 +1,47 @@
+#pragma once
+
+namespace Chip8 {
+class ThreadPool;
+} // namespace Chip8
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Chip8 {
+
+// Fixed set of worker threads running one parallel loop at a time
+class ThreadPool {
+  using Job = std::function<void(std::size_t index, unsigned worker)>;
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  const Job *m_job = nullptr;
+  std::size_t m_count = 0;
+  std::atomic<std::size_t> m_next{0};
+  unsigned m_busy = 0;
+  std::uint64_t m_generation = 0;
+  bool m_stop = false;
+
+  void worker(unsigned id);
+
+public:
+  // 0 threads means one per hardware thread
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(m_threads.size()); }
+  // Run job(index, worker) for every index in [0, count), blocks until done.
+  // worker is in [0, size()) and identifies per thread scratch data.
+  void parallelFor(std::size_t count, const Job &job);
+};
+
+} // namespace Chip8
@@ -0,0 +1,181 @@
+#pragma once
+
+namespace Chip8 {
+class TraceRecorder;
+class TraceReader;
+} // namespace Chip8
+
+#include <Chip8/BlockWriter.h>
+#include <Chip8/Common.h>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace Chip8 {
+
+// Execution trace file layout (little endian):
+//   TraceHeader
+//   records, one per executed instruction:
+//     pc (2 bytes), opcode (2 bytes),
+//     LEB128 varint mask of values changed since the previous record
+//       (bit N: VN, bit TraceChangedI: I, bit TraceFetchFailed: the
+//       instruction could not be fetched, opcode is 0 and meaningless),
+//     new value of every changed register (1 byte) in bit order, then I
+//     (2 bytes) when changed
+// Values start from the reset state (all zero).
+struct TraceHeader {
+  char magic[4];         // "C8TR"
+  std::uint16_t version; // TraceVersion
+  std::uint16_t reserved;
+};
+static_assert(sizeof(TraceHeader) == 8, "TraceHeader must not be padded");
+
+constexpr std::uint16_t TraceVersion = 1;
+constexpr std::uint32_t TraceChangedI = 1u << Chip8::StdRegisterCount;
+constexpr std::uint32_t TraceFetchFailed = TraceChangedI << 1;
+
+// Machine state after one instruction
+struct TraceRecord {
+  std::uint16_t pc;
+  std::uint16_t opcode;
+  std::uint32_t changed; // Mask as stored in the file
+  std::array<std::uint8_t, Chip8::StdRegisterCount> regs;
+  std::uint16_t I;
+};
+
+// Records are encoded into 64 KiB blocks on the emulation thread and handed
+// over lock-free to a writer thread, which writes each block with a single
+// fwrite. An instance belongs to one emulation thread.
+class TraceRecorder {
+public:
+  static constexpr std::size_t BlockSize = 64 * 1024;
+
+private:
+  // pc, opcode, 3 byte mask, every register and I
+  static constexpr std::size_t MaxRecordSize =
+      2 + 2 + 3 + Chip8::StdRegisterCount + 2;
+
+  struct Block {
+    std::size_t size;
+    std::uint8_t data[BlockSize];
+  };
+
+  std::FILE *m_file = nullptr;
+  BlockWriter<Block> m_writer;
+
+  std::array<std::uint8_t, Chip8::StdRegisterCount> m_regs;
+  std::uint16_t m_I = 0;
+  std::uint64_t m_records = 0;
+
+
+  static void put16(std::uint8_t *&out, std::uint16_t v) {
+    *out++ = v & 0xFF;
+    *out++ = v >> 8;
+  }
+  // Bit N set when byte N of a and b differs
+  static std::uint32_t changedBytes(const std::uint8_t *a,
+                                    const std::uint8_t *b) {
+    std::uint32_t mask = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (unsigned half = 0; half < 2; ++half) {
+      std::uint64_t wa, wb;
+      std::memcpy(&wa, a + 8 * half, 8);
+      std::memcpy(&wb, b + 8 * half, 8);
+      const std::uint64_t x = wa ^ wb;
+      // High bit of every non zero byte, then gathered into the top byte
+      const std::uint64_t high =
+          (((x & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | x) &
+          0x8080808080808080ull;
+      mask |= static_cast<std::uint32_t>(
+                  ((high >> 7) * 0x0102040810204080ull) >> 56)
+              << (8 * half);
+    }
+#else
+    for (unsigned it = 0; it < Chip8::StdRegisterCount; ++it)
+      mask |= (a[it] != b[it] ? 1u : 0u) << it;
+#endif
+    return mask;
+  }
+
+  void put(std::uint16_t pc, std::uint16_t opcode, std::uint32_t flags,
+           const std::array<std::uint8_t, Chip8::StdRegisterCount> &regs,
+           std::uint16_t I) {
+    if (BlockSize - m_writer.block().size < MaxRecordSize)
+      m_writer.submit();
+    Block &block = m_writer.block();
+    std::uint32_t changed = changedBytes(regs.data(), m_regs.data()) | flags;
+    if (I != m_I)
+      changed |= TraceChangedI;
+
+    std::uint8_t *out = block.data + block.size;
+    put16(out, pc);
+    put16(out, opcode);
+    std::uint32_t mask = changed;
+    do {
+      std::uint8_t byte = mask & 0x7F;
+      mask >>= 7;
+      *out++ = mask ? (byte | 0x80) : byte;
+    } while (mask);
+    for (std::uint32_t bits = changed & 0xFFFF; bits; bits &= bits - 1)
+      *out++ = regs[__builtin_ctz(bits)];
+    if (changed & TraceChangedI)
+      put16(out, I);
+    block.size = out - block.data;
+    m_regs = regs;
+    m_I = I;
+    m_records++;
+  }
+
+public:
+  TraceRecorder() = default;
+  ~TraceRecorder();
+  TraceRecorder(const TraceRecorder &) = delete;
+  TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+  CHIP8_WARN_UNUSED ResultType open(const char *path);
+  // State after the instruction at pc, called by Board::step
+  void record(std::uint16_t pc, std::uint16_t opcode,
+              const std::array<std::uint8_t, Chip8::StdRegisterCount> &regs,
+              std::uint16_t I) {
+    put(pc, opcode, 0, regs, I);
+  }
+  // Step at pc whose fetch failed, there is no opcode to record
+  void recordFetchFailure(
+      std::uint16_t pc,
+      const std::array<std::uint8_t, Chip8::StdRegisterCount> &regs,
+      std::uint16_t I) {
+    put(pc, 0, TraceFetchFailed, regs, I);
+  }
+  // Flushes and joins the writer, Error when any write failed
+  CHIP8_WARN_UNUSED ResultType close();
+  bool isOpen() const { return nullptr != m_file; }
+  std::uint64_t records() const { return m_records; }
+};
+
+class TraceReader {
+  std::vector<std::uint8_t> m_data;
+  std::size_t m_pos = 0;
+  TraceRecord m_state;
+
+public:
+  CHIP8_WARN_UNUSED ResultType open(const char *path);
+  // False at the end of the trace or on a truncated record
+  bool next(TraceRecord &record);
+};
+
+struct TraceDivergence {
+  std::uint64_t index; // Records before the first difference
+  bool endA;           // Trace A ended first
+  bool endB;
+  TraceRecord a;
+  TraceRecord b;
+};
+
+// Error when a file cannot be read. Otherwise diverged tells whether the
+// traces differ, and divergence describes the first difference.
+CHIP8_WARN_UNUSED ResultType compareTraces(const char *pathA,
+                                           const char *pathB, bool &diverged,
+                                           TraceDivergence &divergence);
+
+} // namespace Chip8
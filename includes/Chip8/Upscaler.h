@@ -0,0 +1,71 @@
+#pragma once
+
+namespace Chip8 {
+class Upscaler;
+} // namespace Chip8
+
+#include <Chip8/State.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Chip8 {
+
+enum class UpscaleFilter {
+  Nearest, // Integer nearest neighbour
+  Scale2x, // EPX to 128x64 first, then nearest by half the scale
+};
+
+enum class SimdLevel { Scalar, Sse2, Avx2 };
+
+// Effect flags for Upscaler
+constexpr unsigned UpscaleScanlines = 1u << 0; // Dim the lower quarter rows
+constexpr unsigned UpscaleGrid = 1u << 1;      // Dim pixel cell borders
+
+// Turns the 64x32 LED buffer into an ARGB8888 picture scale times larger.
+// Every distinct output row is built once in a cached buffer and then
+// copied, so the destination (a locked streaming texture, usually write
+// combined memory) is only ever written to. Row kernels use SSE2 or AVX2
+// when the host has them.
+class Upscaler {
+  using Row = void (*)(std::uint32_t *dst, const std::uint32_t *src,
+                       unsigned count);
+  using Fill = void (*)(std::uint32_t *dst, std::uint32_t value,
+                        unsigned count);
+
+  UpscaleFilter m_filter;
+  unsigned m_scale;
+  unsigned m_effects;
+  SimdLevel m_simd = SimdLevel::Scalar;
+  Fill m_fill = nullptr;
+  Row m_dim = nullptr;
+  // Scale2x output, 2 * ScreenWidth by 2 * ScreenHeight
+  std::vector<std::uint8_t> m_epx;
+  // Output rows, padded for the overlapping vector stores
+  std::vector<std::uint32_t> m_bright;
+  std::vector<std::uint32_t> m_dimmed;
+
+public:
+  using Leds = std::array<std::array<std::uint8_t, ScreenWidth>, ScreenHeight>;
+
+  // Scale2x rounds scale down to an even number, at least 2
+  Upscaler(unsigned scale, UpscaleFilter filter = UpscaleFilter::Nearest,
+           unsigned effects = 0);
+
+  // Best level the host supports
+  static SimdLevel detectSimd();
+  // Clamped to detectSimd(), tests and benchmarks compare the kernels
+  void setSimd(SimdLevel level);
+  SimdLevel simd() const { return m_simd; }
+
+  unsigned scale() const { return m_scale; }
+  unsigned width() const { return ScreenWidth * m_scale; }
+  unsigned height() const { return ScreenHeight * m_scale; }
+
+  // Writes width() x height() pixels, pitch in bytes
+  void run(const Leds &leds, std::uint32_t *out, std::size_t pitch);
+};
+
+const char *simdName(SimdLevel level);
+
+} // namespace Chip8
@@ -4,6 +4,7 @@ namespace Chip8 {
 class Video;
 } // namespace Chip8
 
+#include <Chip8/State.h>
 #include <array>
 #include <cstdint>
 
@@ -14,7 +15,7 @@ protected:
   // There should be actual pixel data stored
   std::array<std::array<bool, 64>, 32> m_screen;
   // To implement pixel fadeout, store current value in buffer.
-  // Updated in update() method
+  // Updated in updateLeds() method
   std::array<std::array<uint8_t, 64>, 32> m_ledBuffer;
 
 public:
@@ -23,6 +24,20 @@ public:
   bool flipSprite(uint8_t x, uint8_t y, uint8_t v);
   bool flipBit(uint8_t x, uint8_t y, bool v);
   void dump();
+  // Fade m_ledBuffer one frame towards m_screen, frontends call it once per
+  // presented frame
+  void updateLeds();
+  const std::array<std::array<uint8_t, 64>, 32> &leds() const {
+    return m_ledBuffer;
+  }
+  void copyScreen(const Video &other) { m_screen = other.m_screen; }
+  // Screen as ScreenWidth * ScreenHeight bytes, row after row, 1 when lit
+  void copyPixels(std::uint8_t *out) const;
+  // Screen packed 1 bit per pixel as in BoardState::screen
+  void pack(std::array<std::uint8_t, PackedScreenSize> &packed) const;
+
+  void saveState(BoardState &state) const;
+  void loadState(const BoardState &state);
 };
 
 } // namespace Chip8
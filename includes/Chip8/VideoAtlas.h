@@ -0,0 +1,57 @@
+#pragma once
+
+namespace Chip8 {
+class VideoAtlas;
+} // namespace Chip8
+
+#include <Chip8/Video.h>
+#include <cstdint>
+#include <vector>
+
+namespace Chip8 {
+
+// Packs the LED buffers of many machines into one ARGB8888 picture, one
+// 64x32 tile per machine in a grid. Tracks which tile rows changed so the
+// frontend uploads a single band of the atlas per frame.
+class VideoAtlas {
+  std::size_t m_count;
+  unsigned m_columns;
+  unsigned m_rows;
+  std::vector<std::uint32_t> m_pixels;
+  // LED values last written into each tile
+  std::vector<std::uint8_t> m_leds;
+  // Changed tile rows since clearDirty(), [m_dirtyBegin, m_dirtyEnd)
+  unsigned m_dirtyBegin;
+  unsigned m_dirtyEnd = 0;
+  std::size_t m_changedTiles = 0;
+
+public:
+  static constexpr unsigned TileWidth = 64;
+  static constexpr unsigned TileHeight = 32;
+
+  // 0 columns picks the grid closest to a square window
+  explicit VideoAtlas(std::size_t count, unsigned columns = 0);
+
+  std::size_t count() const { return m_count; }
+  unsigned columns() const { return m_columns; }
+  unsigned rows() const { return m_rows; }
+  unsigned width() const { return m_columns * TileWidth; }
+  unsigned height() const { return m_rows * TileHeight; }
+  // Bytes per atlas row
+  unsigned pitch() const { return width() * sizeof(std::uint32_t); }
+  const std::uint32_t *pixels() const { return m_pixels.data(); }
+
+  // Copies the LED buffer of machine index into its tile, returns true when
+  // the tile changed. Call updateLeds() on the video first.
+  bool update(std::size_t index, const Video &video);
+  bool dirty() const { return m_dirtyBegin < m_dirtyEnd; }
+  // Pixel rows to upload, covers every changed tile
+  unsigned dirtyTop() const { return m_dirtyBegin * TileHeight; }
+  unsigned dirtyHeight() const {
+    return dirty() ? (m_dirtyEnd - m_dirtyBegin) * TileHeight : 0;
+  }
+  std::size_t changedTiles() const { return m_changedTiles; }
+  void clearDirty();
+};
+
+} // namespace Chip8
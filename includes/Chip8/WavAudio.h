@@ -0,0 +1,59 @@
+#pragma once
+
+namespace Chip8 {
+class WavAudio;
+} // namespace Chip8
+
+#include <Chip8/Audio.h>
+#include <Chip8/Common.h>
+#include <cstdint>
+#include <vector>
+
+namespace Chip8 {
+
+class Board;
+
+// Headless audio sink. Records the emulated cycle of every beep start and
+// stop and renders the square wave tone offline, at any sample rate. The
+// timeline is the attached board's cycle count, so it is only meaningful
+// with TimingMode::Vip, where transitions land exactly on timer ticks.
+// Restoring an earlier state rewrites the recorded future.
+class WavAudio : public Audio {
+  const Board *m_board = nullptr;
+  // Beep start cycles at even, stop cycles at odd indices
+  std::vector<std::uint64_t> m_transitions;
+  unsigned m_toneHz = 440;
+  std::int16_t m_amplitude = 0x2000;
+
+  void record(bool on);
+
+protected:
+  virtual void beginBeep();
+  virtual void endBeep();
+
+public:
+  void attach(const Board &board) { m_board = &board; }
+  virtual void reset();
+  // Forgets the recording, the current beep restarts at the current cycle
+  void clear();
+  void setTone(unsigned hz, std::int16_t amplitude) {
+    m_toneHz = hz;
+    m_amplitude = amplitude;
+  }
+
+  const std::vector<std::uint64_t> &transitions() const {
+    return m_transitions;
+  }
+  // Emulated cycles spent beeping before end
+  std::uint64_t beepCycles(std::uint64_t end) const;
+  // Sample index of an emulated cycle at rate
+  static std::uint64_t sampleAt(std::uint64_t cycle, unsigned rate);
+  // Mono 16 bit samples [first, first + count) of the recording
+  void render(unsigned rate, std::uint64_t first, std::size_t count,
+              std::int16_t *out) const;
+  // Renders everything up to cycle end as a mono 16 bit PCM WAV file
+  CHIP8_WARN_UNUSED ResultType writeWav(const char *path, unsigned rate,
+                                        std::uint64_t end) const;
+};
+
+} // namespace Chip8
@@ -0,0 +1,69 @@
+/* libchip8: C ABI over many Chip8 machines stepped together.
+ *
+ * Every machine runs with cycle accurate COSMAC VIP timing, one frame is one
+ * 60 Hz timer tick. Stepping runs the machines in parallel on a pool with
+ * one thread per core. Observations are written to one caller provided
+ * buffer, machine after machine, so bindings can hand it out as an array
+ * without copying.
+ *
+ * The ABI only changes with CHIP8_ABI_VERSION. Handles are not thread safe,
+ * use one per thread or serialize calls.
+ */
+#ifndef CHIP8_H
+#define CHIP8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(CHIP8_BUILDING_LIBRARY)
+#define CHIP8_API __attribute__((visibility("default")))
+#else
+#define CHIP8_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8_ABI_VERSION 1
+
+/* Bytes of one observation: the 64x32 screen, row after row, one byte per
+ * pixel, 1 when lit. */
+#define CHIP8_OBSERVATION_SIZE (64 * 32)
+
+/* Values of chip8_envs_status() */
+#define CHIP8_STATUS_RUNNING 0
+#define CHIP8_STATUS_BREAK 1 /* stopped on an invalid opcode */
+
+typedef struct chip8_envs chip8_envs;
+
+CHIP8_API unsigned chip8_abi_version(void);
+
+/* n machines running rom, machine i seeded with seed + i. NULL when n is 0,
+ * the ROM does not fit or memory runs out. */
+CHIP8_API chip8_envs *chip8_envs_create(unsigned n, const uint8_t *rom,
+                                        size_t rom_size, uint32_t seed);
+CHIP8_API void chip8_envs_destroy(chip8_envs *envs);
+CHIP8_API unsigned chip8_envs_count(const chip8_envs *envs);
+
+/* Holds keys[i] (bit N: key N down) on machine i and runs frames frames.
+ * With out not NULL the observations are written as by chip8_envs_observe.
+ * Returns 0, or -1 on bad arguments. */
+CHIP8_API int chip8_envs_step(chip8_envs *envs, const uint16_t *keys,
+                              unsigned frames, uint8_t *out);
+
+/* Writes n * CHIP8_OBSERVATION_SIZE bytes to out */
+CHIP8_API int chip8_envs_observe(const chip8_envs *envs, uint8_t *out);
+
+/* Restarts machine i where mask[i] is not 0, every machine when mask is
+ * NULL. Keys are released. */
+CHIP8_API int chip8_envs_reset(chip8_envs *envs, const uint8_t *mask);
+
+/* Writes n CHIP8_STATUS_* bytes to out */
+CHIP8_API int chip8_envs_status(const chip8_envs *envs, uint8_t *out);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* CHIP8_H */
@@ -0,0 +1,108 @@
+#include <Chip8/AccessMap.h>
+
+namespace Chip8 {
+
+namespace {
+constexpr std::size_t kGridWidth = 64;
+} // namespace
+
+void AccessMap::reset() {
+  m_read.fill(0);
+  m_write.fill(0);
+  m_exec.fill(0);
+}
+
+std::size_t AccessMap::executed(std::uint16_t begin, std::uint16_t end) const {
+  std::size_t count = 0;
+  for (std::size_t addr = begin; addr < end && addr < m_exec.size(); ++addr)
+    count += m_exec[addr] ? 1 : 0;
+  return count;
+}
+
+std::vector<AccessMap::Region> AccessMap::regions() const {
+  std::vector<Region> regions;
+  for (std::size_t addr = 0; addr < m_exec.size(); ++addr) {
+    Kind kind;
+    if (m_exec[addr])
+      kind = m_write[addr] ? Kind::SelfModifying : Kind::Code;
+    else if (m_read[addr] || m_write[addr])
+      kind = Kind::Data;
+    else
+      continue;
+    if (!regions.empty() && regions.back().end == addr &&
+        regions.back().kind == kind) {
+      regions.back().end++;
+    } else {
+      regions.push_back({static_cast<std::uint16_t>(addr),
+                         static_cast<std::uint16_t>(addr + 1), kind});
+    }
+  }
+  return regions;
+}
+
+std::vector<std::uint16_t> AccessMap::selfModifying() const {
+  std::vector<std::uint16_t> addrs;
+  for (std::uint16_t addr = 0; addr < m_exec.size(); ++addr)
+    if (m_exec[addr] && m_write[addr])
+      addrs.push_back(addr);
+  return addrs;
+}
+
+void AccessMap::printGrid(std::FILE *out, std::uint16_t offset,
+                          std::size_t lines) const {
+  for (; lines && offset < m_exec.size(); --lines) {
+    std::fprintf(out, "0x%.3x\t", offset);
+    for (std::size_t it = 0; it < kGridWidth && offset < m_exec.size();
+         ++it, ++offset) {
+      char c = '.';
+      if (m_exec[offset])
+        c = m_write[offset] ? 'X' : 'x';
+      else if (m_read[offset] && m_write[offset])
+        c = 'm';
+      else if (m_write[offset])
+        c = 'w';
+      else if (m_read[offset])
+        c = 'r';
+      std::fputc(c, out);
+    }
+    std::fputc('\n', out);
+  }
+}
+
+void AccessMap::printRegions(std::FILE *out) const {
+  for (const auto &region : regions()) {
+    std::fprintf(out, "0x%.3X-0x%.3X %5u  %s\n", region.begin, region.end - 1,
+                 region.end - region.begin, kindName(region.kind));
+  }
+}
+
+ResultType AccessMap::writeBinary(const char *path) const {
+  std::FILE *out = std::fopen(path, "wb");
+  if (!out)
+    return ResultType::Error;
+  AccessMapHeader header = {{'C', '8', 'A', 'M'},
+                            AccessMapVersion,
+                            Chip8::MemorySize};
+  bool ok = 1 == std::fwrite(&header, sizeof(header), 1, out);
+  for (const auto *counters : {&m_read, &m_write, &m_exec}) {
+    ok = ok && counters->size() == std::fwrite(counters->data(),
+                                               sizeof(std::uint64_t),
+                                               counters->size(), out);
+  }
+  ok = (0 == std::fclose(out)) && ok;
+  return ok ? ResultType::Ok : ResultType::Error;
+}
+
+const char *AccessMap::kindName(Kind kind) {
+  switch (kind) {
+  case Kind::Code:
+    return "code";
+  case Kind::Data:
+    return "data";
+  case Kind::SelfModifying:
+    return "self-modifying code";
+  }
+  return "?";
+}
+
+} // namespace Chip8
@@ -0,0 +1,259 @@
+#include <Chip8/Analysis.h>
+#include <Chip8/Instruction.h>
+#include <algorithm>
+
+namespace Chip8 {
+
+namespace {
+
+bool isSkip(const Instruction &instr) {
+  switch (instr.type()) {
+  case 0x3:
+  case 0x4:
+  case 0x5:
+  case 0x9:
+  case 0xe:
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+ResultType Analysis::analyze(const std::vector<std::uint8_t> &rom,
+                             std::uint16_t origin) {
+  if (origin + rom.size() > Chip8::MemorySize)
+    return ResultType::OutOfRange;
+  // One spare byte so the last address can be decoded as an opcode
+  m_image.assign(Chip8::MemorySize + 1, 0);
+  std::copy(rom.begin(), rom.end(), m_image.begin() + origin);
+  m_origin = origin;
+  m_romEnd = static_cast<std::uint16_t>(origin + rom.size());
+  m_kind.fill(Data);
+  m_leader.fill(false);
+  m_function.fill(false);
+  m_blocks.clear();
+  m_calls.clear();
+
+  m_function[origin] = true;
+  m_leader[origin] = true;
+  trace(origin);
+  buildBlocks();
+  assignFunctions();
+  return ResultType::Ok;
+}
+
+void Analysis::trace(std::uint16_t entry) {
+  std::vector<std::uint16_t> pending(1, entry);
+  while (!pending.empty()) {
+    std::uint32_t addr = pending.back();
+    pending.pop_back();
+    // Code is only followed inside the ROM image, until a visited byte
+    while (addr >= m_origin && addr + 2 <= m_romEnd &&
+           Opcode != m_kind[addr]) {
+      m_kind[addr] = Opcode;
+      if (Data == m_kind[addr + 1])
+        m_kind[addr + 1] = Operand;
+      const Instruction instr(opcode(addr));
+      const std::uint16_t next = addr + 2;
+      if (!instr.valid() || 0x00EE == instr.code() || 0xb == instr.type())
+        break;
+      if (0x1 == instr.type()) {
+        m_leader[instr.NNN()] = true;
+        pending.push_back(instr.NNN());
+        break;
+      }
+      if (0x2 == instr.type()) {
+        m_function[instr.NNN()] = true;
+        m_leader[instr.NNN()] = true;
+        pending.push_back(instr.NNN());
+      } else if (isSkip(instr) && next + 2 < Chip8::MemorySize) {
+        m_leader[next] = true;
+        m_leader[next + 2] = true;
+        pending.push_back(next + 2);
+      }
+      addr = next;
+    }
+  }
+}
+
+void Analysis::buildBlocks() {
+  // Index of the open block the next instruction falls into
+  std::size_t open = SIZE_MAX;
+  std::uint32_t addr = m_origin;
+  while (addr + 2 <= m_romEnd) {
+    if (Opcode != m_kind[addr]) {
+      open = SIZE_MAX;
+      addr++;
+      continue;
+    }
+    if (SIZE_MAX != open && m_leader[addr]) {
+      m_blocks[open].successors.push_back(addr);
+      open = SIZE_MAX;
+    }
+    if (SIZE_MAX == open) {
+      open = m_blocks.size();
+      m_blocks.emplace_back();
+      m_blocks[open].start = addr;
+      m_blocks[open].function = addr;
+    }
+    BasicBlock &block = m_blocks[open];
+    block.end = addr + 2;
+    const Instruction instr(opcode(addr));
+    if (!instr.valid()) {
+      block.invalid = true;
+      open = SIZE_MAX;
+    } else if (0x00EE == instr.code()) {
+      open = SIZE_MAX;
+    } else if (0x1 == instr.type()) {
+      block.successors.push_back(instr.NNN());
+      open = SIZE_MAX;
+    } else if (0xb == instr.type()) {
+      block.indirect = true;
+      open = SIZE_MAX;
+    } else if (isSkip(instr)) {
+      block.successors.push_back(addr + 2);
+      block.successors.push_back(addr + 4);
+      open = SIZE_MAX;
+    }
+    addr += 2;
+  }
+}
+
+void Analysis::assignFunctions() {
+  std::vector<int> blockAt(Chip8::MemorySize, -1);
+  for (std::size_t it = 0; it < m_blocks.size(); ++it)
+    blockAt[m_blocks[it].start] = static_cast<int>(it);
+  // Program entry first, then callees by address, first owner wins
+  std::vector<std::uint16_t> entries(1, m_origin);
+  for (std::uint32_t addr = 0; addr < m_function.size(); ++addr) {
+    if (m_function[addr] && addr != m_origin)
+      entries.push_back(addr);
+  }
+  std::vector<bool> owned(m_blocks.size(), false);
+  std::vector<int> pending;
+  for (std::uint16_t entry : entries) {
+    if (blockAt[entry] < 0 || owned[blockAt[entry]])
+      continue;
+    pending.assign(1, blockAt[entry]);
+    owned[blockAt[entry]] = true;
+    while (!pending.empty()) {
+      BasicBlock &block = m_blocks[pending.back()];
+      pending.pop_back();
+      block.function = entry;
+      for (std::uint16_t succ : block.successors) {
+        const int index = succ < blockAt.size() ? blockAt[succ] : -1;
+        if (index >= 0 && !owned[index]) {
+          owned[index] = true;
+          pending.push_back(index);
+        }
+      }
+    }
+  }
+  for (const BasicBlock &block : m_blocks) {
+    for (std::uint32_t addr = block.start; addr < block.end; addr += 2) {
+      const Instruction instr(opcode(addr));
+      if (0x2 == instr.type())
+        m_calls.emplace_back(block.function, instr.NNN());
+    }
+  }
+  std::sort(m_calls.begin(), m_calls.end());
+  m_calls.erase(std::unique(m_calls.begin(), m_calls.end()), m_calls.end());
+}
+
+const BasicBlock *Analysis::block(std::uint16_t addr) const {
+  auto it = std::upper_bound(
+      m_blocks.begin(), m_blocks.end(), addr,
+      [](std::uint16_t addr, const BasicBlock &b) { return addr < b.start; });
+  if (it == m_blocks.begin())
+    return nullptr;
+  --it;
+  return addr < it->end ? &*it : nullptr;
+}
+
+std::size_t Analysis::codeBytes() const {
+  return std::count_if(m_kind.begin() + m_origin, m_kind.begin() + m_romEnd,
+                       [](std::uint8_t kind) { return Data != kind; });
+}
+
+void Analysis::writeInstruction(std::FILE *out, std::uint16_t addr) const {
+  const Instruction instr(opcode(addr));
+  char text[DisasmMaxLength];
+  instr.disasm(text, sizeof(text));
+  std::fprintf(out, "  0x%.3X  %.4X  ", addr, instr.code());
+  if (0x1 == instr.type() || 0x2 == instr.type()) {
+    const std::uint16_t target = instr.NNN();
+    if (Opcode != kind(target))
+      std::fprintf(out, "%-16s; -> 0x%.3X, not code\n", text, target);
+    else
+      std::fprintf(out, "%-16s; -> %s_%.3X\n", text,
+                   isFunction(target) ? "sub" : "loc", target);
+  } else if (0xb == instr.type()) {
+    std::fprintf(out, "%-16s; indirect\n", text);
+  } else {
+    std::fprintf(out, "%s\n", text);
+  }
+}
+
+void Analysis::writeListing(std::FILE *out) const {
+  std::fprintf(out,
+               "; origin 0x%.3X, %u bytes, %zu code bytes, %zu blocks, "
+               "%zu calls\n",
+               m_origin, static_cast<unsigned>(m_romEnd - m_origin),
+               codeBytes(), m_blocks.size(), m_calls.size());
+  std::uint32_t addr = m_origin;
+  while (addr < m_romEnd) {
+    if (Opcode == m_kind[addr] && addr + 2 <= m_romEnd) {
+      if (m_function[addr])
+        std::fprintf(out, "sub_%.3X:\n", addr);
+      else if (m_leader[addr])
+        std::fprintf(out, "loc_%.3X:\n", addr);
+      writeInstruction(out, addr);
+      addr += 2;
+      continue;
+    }
+    // Data run up to 8 bytes, never swallowing an instruction start
+    std::fprintf(out, "  0x%.3X  db", addr);
+    const char *separator = " ";
+    for (unsigned count = 0;
+         count < 8 && addr < m_romEnd &&
+         (0 == count || Opcode != m_kind[addr]);
+         ++count, ++addr) {
+      std::fprintf(out, "%s0x%.2X", separator, m_image[addr]);
+      separator = ", ";
+    }
+    std::fprintf(out, "\n");
+  }
+}
+
+void Analysis::writeDot(std::FILE *out) const {
+  std::fprintf(out, "digraph chip8 {\n"
+                    "  node [shape=box fontname=\"monospace\"];\n");
+  char text[DisasmMaxLength];
+  for (const BasicBlock &block : m_blocks) {
+    std::fprintf(out, "  b%.3X [label=\"%s_%.3X:\\l", block.start,
+                 isFunction(block.start) ? "sub" : "loc", block.start);
+    for (std::uint32_t addr = block.start; addr < block.end; addr += 2) {
+      Instruction(opcode(addr)).disasm(text, sizeof(text));
+      std::fprintf(out, "0x%.3X  %s\\l", addr, text);
+    }
+    std::fprintf(out, "\"%s];\n",
+                 block.indirect  ? " color=orange"
+                 : block.invalid ? " color=red"
+                                 : "");
+    for (std::uint16_t succ : block.successors) {
+      if (Opcode == kind(succ))
+        std::fprintf(out, "  b%.3X -> b%.3X;\n", block.start, succ);
+    }
+    for (std::uint32_t addr = block.start; addr < block.end; addr += 2) {
+      const Instruction instr(opcode(addr));
+      if (0x2 == instr.type() && Opcode == kind(instr.NNN()))
+        std::fprintf(out, "  b%.3X -> b%.3X [style=dashed];\n", block.start,
+                     instr.NNN());
+    }
+  }
+  std::fprintf(out, "}\n");
+}
+
+} // namespace Chip8
@@ -20,24 +20,148 @@ void Board::reset() {
   m_memory->reset();
   m_cpu->reset();
   m_audio->reset();
+  m_frame = 0;
   std::fill(m_keys.begin(), m_keys.end(), false);
 }
 
+void Board::saveState(BoardState &state) const {
+  saveCoreState(state);
+  m_memory->saveState(state);
+}
+
+void Board::saveCoreState(BoardState &state) const {
+  m_cpu->saveState(state);
+  m_video->saveState(state);
+  state.frame = m_frame;
+  state.keys = 0;
+  for (std::size_t key = 0; key < m_keys.size(); ++key)
+    state.keys |= m_keys[key] ? (1u << key) : 0;
+  state.beep = m_audio->beep() ? 1 : 0;
+  state.reserved.fill(0);
+}
+
+void Board::loadState(const BoardState &state) {
+  m_cpu->loadState(state);
+  m_memory->loadState(state);
+  m_video->loadState(state);
+  m_frame = state.frame;
+  for (std::size_t key = 0; key < m_keys.size(); ++key)
+    m_keys[key] = 0 != (state.keys & (1u << key));
+  if (state.beep)
+    m_audio->startBeep();
+  else
+    m_audio->stopBeep();
+  if (m_history && !m_history->replaying())
+    m_history->attach(*this);
+}
+
+std::shared_ptr<Board> Board::fork(std::shared_ptr<Video> video,
+                                   std::shared_ptr<Audio> audio) {
+  auto board = std::make_shared<Board>(video, audio);
+  *board->m_cpu = *m_cpu;
+  *board->m_memory = m_memory->fork();
+  board->m_video->copyScreen(*m_video);
+  board->m_keys = m_keys;
+  board->m_timing = m_timing;
+  board->m_frame = m_frame;
+  if (m_audio->beep())
+    board->m_audio->startBeep();
+  return board;
+}
+
 bool Board::shutdown() const { return m_shutdown; }
 
 void Board::setShutdown() { m_shutdown = true; }
 
-void Board::step() { cpu()->step(this); }
+void Board::step() {
+  if (m_breakpoints && m_breakpoints->checkStep(*this)) {
+    // Stop in front of the instruction, it runs on the next step
+    m_break = true;
+    return;
+  }
+  // Steps spent waiting for a key execute nothing and are not traced
+  const bool executed = !m_cpu->isKeyAwait();
+  const bool traced = m_tracer && executed;
+  const std::uint16_t tracedPc = m_cpu->pc();
+  // Fetching is side effect free, a failure is recorded as such instead of
+  // repeating the previous opcode
+  std::uint16_t tracedOpcode = 0;
+  const bool fetched =
+      traced && ResultType::Ok == peek(tracedPc, tracedOpcode);
+  if (m_history)
+    m_history->beginStep(m_cpu->registers(), m_cpu->I());
+#ifdef CHIP8_ENABLE_PROFILER
+  if (m_profiler) {
+    const std::uint16_t pc = m_cpu->pc();
+    const bool awaitKey = m_cpu->isKeyAwait();
+    std::uint16_t opcode = 0;
+    if (!awaitKey && ResultType::Ok != peek(pc, opcode))
+      opcode = 0;
+    const std::uint64_t before = cycles();
+    cpu()->step(this);
+    m_profiler->record(pc, opcode, cycles() - before, awaitKey);
+  } else
+#endif
+    cpu()->step(this);
+  if (fetched)
+    m_tracer->record(tracedPc, tracedOpcode, m_cpu->registers(), m_cpu->I());
+  else if (traced)
+    m_tracer->recordFetchFailure(tracedPc, m_cpu->registers(), m_cpu->I());
+  if (TimingMode::Vip == m_timing) {
+    // Timers are derived from the emulated cycle count
+    while (cycles() >= (m_frame + 1) * Chip8::VipCyclesPerFrame) {
+      m_frame++;
+      // Not an external event, replays derive it from cycles again
+      if (ResultType::Ok != m_cpu->timerStep(this))
+        m_break = true;
+      if (m_frameRecorder)
+        m_frameRecorder->capture(*m_video);
+    }
+  }
+  if (m_history)
+    m_history->endStep(*this, m_cpu->registers(), m_cpu->I(),
+                       m_cpu->lastOpcode(), executed);
+}
+
+void Board::runFrame() {
+  if (TimingMode::Vip != m_timing) {
+    // Host timing has no notion of frame length, mirror one host tick
+    timerStep();
+    step();
+    return;
+  }
+  const std::uint64_t frame = m_frame;
+  while (frame == m_frame && !isBreak() && !shutdown()) {
+    step();
+  }
+}
 
-void Board::timerStep() { cpu()->timerStep(this); }
+void Board::timerStep() {
+  if (m_history)
+    m_history->timerEvent();
+  if (ResultType::Ok != m_cpu->timerStep(this))
+    m_break = true;
+  if (m_frameRecorder)
+    m_frameRecorder->capture(*m_video);
+}
 
 void Board::handleKey(uint8_t key, bool down) {
+  if (m_history)
+    m_history->keyEvent(key, down);
   m_keys[key] = down;
   if (down) {
-    cpu()->keyStep(this, key);
+    const History::Registers before = m_cpu->registers();
+    if (ResultType::Ok != m_cpu->keyStep(this, key))
+      m_break = true;
+    if (m_history)
+      m_history->keyLoaded(before, m_cpu->registers());
   }
 }
 
+bool Board::isIdleKeyWait() const {
+  return m_cpu->isKeyAwait() && 0 == m_cpu->Dt() && 0 == m_cpu->St();
+}
+
 bool Board::isKeyDown(uint8_t key) {
   // bool rv = m_keys[key];
   // m_keys[key] = false;
@@ -46,11 +170,27 @@ bool Board::isKeyDown(uint8_t key) {
 }
 
 ResultType Board::memoryWrite(uint16_t addr, uint8_t val) {
-  return memory()->write(addr, val);
+  ResultType rv = memory()->write(addr, val);
+  if (ResultType::Ok != rv)
+    return rv;
+  if (m_accessMap)
+    m_accessMap->write(addr);
+  if (m_history)
+    m_history->memoryWritten(addr);
+  if (m_breakpoints && m_breakpoints->checkWrite(addr, m_cpu->pc()))
+    m_break = true;
+  return rv;
 }
 
 ResultType Board::memoryRead(uint16_t addr, uint8_t &out) {
-  return memory()->read(addr, out);
+  ResultType rv = memory()->read(addr, out);
+  if (ResultType::Ok != rv)
+    return rv;
+  if (m_accessMap)
+    m_accessMap->read(addr);
+  if (m_breakpoints && m_breakpoints->checkRead(addr, m_cpu->pc()))
+    m_break = true;
+  return rv;
 }
 
 ResultType Board::memoryRead(uint16_t addr, uint16_t &out) {
@@ -65,6 +205,30 @@ ResultType Board::memoryRead(uint16_t addr, uint16_t &out) {
   return ResultType::Ok;
 }
 
+ResultType Board::fetch(uint16_t addr, uint16_t &out) {
+  ResultType rv = peek(addr, out);
+  CHIP8_CHECK_RESULT(rv);
+  if (m_accessMap)
+    m_accessMap->execute(addr);
+  return ResultType::Ok;
+}
+
+ResultType Board::peek(uint16_t addr, uint8_t &out) {
+  return memory()->read(addr, out);
+}
+
+ResultType Board::peek(uint16_t addr, uint16_t &out) {
+  ResultType rv;
+  uint8_t top;
+  uint8_t bottom;
+  rv = peek(addr, top);
+  CHIP8_CHECK_RESULT(rv);
+  rv = peek(addr + 1, bottom);
+  CHIP8_CHECK_RESULT(rv);
+  out = (top << 8) | bottom;
+  return ResultType::Ok;
+}
+
 ResultType Board::fontPtr(uint8_t font, uint16_t &offset) {
   return memory()->font_ptr(font, offset);
 }
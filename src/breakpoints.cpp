@@ -0,0 +1,415 @@
+#include <Chip8/Board.h>
+#include <Chip8/Breakpoints.h>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace Chip8 {
+
+namespace {
+// Evaluation stack lives on the C++ stack, deeper expressions are rejected
+constexpr std::size_t MaxDepth = 32;
+} // namespace
+
+// Recursive descent over the condition text emitting postfix bytecode
+class ConditionParser {
+  using Op = Condition::Op;
+
+  Condition &m_out;
+  const char *m_text;
+  const char *m_pos;
+  std::string m_error;
+  std::size_t m_depth = 0;
+
+  void skip() {
+    while (std::isspace(static_cast<unsigned char>(*m_pos)))
+      ++m_pos;
+  }
+  // Matches token, but not as the prefix of a longer operator
+  bool accept(const char *token, char notFollowedBy = '\0') {
+    skip();
+    const std::size_t length = std::strlen(token);
+    if (0 != std::strncmp(m_pos, token, length))
+      return false;
+    if (notFollowedBy && notFollowedBy == m_pos[length])
+      return false;
+    m_pos += length;
+    return true;
+  }
+  bool fail(const char *message) {
+    if (m_error.empty())
+      m_error = std::string(message) + " at column " +
+                std::to_string(m_pos - m_text + 1);
+    return false;
+  }
+  void emit(Op op, int stackChange) {
+    m_out.m_code.push_back(op);
+    m_depth += stackChange;
+    if (m_depth > m_out.m_depth)
+      m_out.m_depth = m_depth;
+  }
+  void push(Op op, std::int32_t operand) {
+    m_out.m_operands.push_back(operand);
+    emit(op, 1);
+  }
+
+  bool primary() {
+    skip();
+    if (accept("(")) {
+      if (!logicalOr())
+        return false;
+      return accept(")") || fail("expected )");
+    }
+    if (accept("[")) {
+      if (!logicalOr())
+        return false;
+      emit(Op::Load, 0);
+      return accept("]") || fail("expected ]");
+    }
+    if (std::isdigit(static_cast<unsigned char>(*m_pos))) {
+      char *end;
+      const long value = std::strtol(m_pos, &end, 0);
+      m_pos = end;
+      push(Op::Push, static_cast<std::int32_t>(value));
+      return true;
+    }
+    std::string name;
+    while (std::isalnum(static_cast<unsigned char>(*m_pos)))
+      name += static_cast<char>(std::toupper(*m_pos++));
+    if (2 == name.size() && 'V' == name[0] &&
+        std::isxdigit(static_cast<unsigned char>(name[1]))) {
+      push(Op::Reg, std::strtol(name.c_str() + 1, nullptr, 16));
+    } else if ("I" == name) {
+      emit(Op::I, 1);
+    } else if ("PC" == name) {
+      emit(Op::Pc, 1);
+    } else if ("DT" == name) {
+      emit(Op::Dt, 1);
+    } else if ("ST" == name) {
+      emit(Op::St, 1);
+    } else {
+      return fail("expected operand");
+    }
+    return true;
+  }
+  bool unary() {
+    if (accept("!", '='))
+      return unary() && (emit(Op::Not, 0), true);
+    if (accept("-"))
+      return unary() && (emit(Op::Neg, 0), true);
+    if (accept("~"))
+      return unary() && (emit(Op::Inv, 0), true);
+    return primary();
+  }
+  bool additive() {
+    if (!unary())
+      return false;
+    while (true) {
+      if (accept("+")) {
+        if (!unary())
+          return false;
+        emit(Op::Add, -1);
+      } else if (accept("-")) {
+        if (!unary())
+          return false;
+        emit(Op::Sub, -1);
+      } else {
+        return true;
+      }
+    }
+  }
+  bool bitAnd() {
+    if (!additive())
+      return false;
+    while (accept("&", '&')) {
+      if (!additive())
+        return false;
+      emit(Op::And, -1);
+    }
+    return true;
+  }
+  bool bitXor() {
+    if (!bitAnd())
+      return false;
+    while (accept("^")) {
+      if (!bitAnd())
+        return false;
+      emit(Op::Xor, -1);
+    }
+    return true;
+  }
+  bool bitOr() {
+    if (!bitXor())
+      return false;
+    while (accept("|", '|')) {
+      if (!bitXor())
+        return false;
+      emit(Op::Or, -1);
+    }
+    return true;
+  }
+  bool comparison() {
+    if (!bitOr())
+      return false;
+    static const struct {
+      const char *token;
+      Op op;
+    } kOperators[] = {{"==", Op::Eq}, {"!=", Op::Ne}, {"<=", Op::Le},
+                      {">=", Op::Ge}, {"<", Op::Lt},  {">", Op::Gt}};
+    for (const auto &entry : kOperators) {
+      if (accept(entry.token)) {
+        if (!bitOr())
+          return false;
+        emit(entry.op, -1);
+        return true;
+      }
+    }
+    return true;
+  }
+  bool logicalAnd() {
+    if (!comparison())
+      return false;
+    while (accept("&&")) {
+      if (!comparison())
+        return false;
+      emit(Op::LogicalAnd, -1);
+    }
+    return true;
+  }
+  bool logicalOr() {
+    if (!logicalAnd())
+      return false;
+    while (accept("||")) {
+      if (!logicalAnd())
+        return false;
+      emit(Op::LogicalOr, -1);
+    }
+    return true;
+  }
+
+public:
+  ConditionParser(Condition &out, const char *text)
+      : m_out(out), m_text(text), m_pos(text) {}
+
+  ResultType parse(std::string &reason) {
+    bool ok = logicalOr();
+    skip();
+    if (ok && '\0' != *m_pos)
+      ok = fail("unexpected input");
+    if (ok && m_out.m_depth > MaxDepth)
+      ok = fail("expression too deep");
+    if (ok)
+      return ResultType::Ok;
+    reason = m_error;
+    return ResultType::Error;
+  }
+};
+
+ResultType Condition::compile(const char *text, std::string &reason) {
+  m_code.clear();
+  m_operands.clear();
+  m_depth = 0;
+  m_text = text;
+  ResultType rv = ConditionParser(*this, text).parse(reason);
+  if (ResultType::Ok != rv) {
+    m_code.clear();
+    m_operands.clear();
+    m_text.clear();
+  }
+  return rv;
+}
+
+bool Condition::evaluate(const Board &board) const {
+  const Cpu &cpu = board.cpuView();
+  const Memory &memory = board.memoryPages();
+  std::int32_t stack[MaxDepth];
+  std::size_t sp = 0;
+  std::size_t operand = 0;
+  for (Op op : m_code) {
+    switch (op) {
+    case Op::Push:
+      stack[sp++] = m_operands[operand++];
+      break;
+    case Op::Reg:
+      stack[sp++] = cpu.registers()[m_operands[operand++]];
+      break;
+    case Op::I:
+      stack[sp++] = cpu.I();
+      break;
+    case Op::Pc:
+      stack[sp++] = cpu.pc();
+      break;
+    case Op::Dt:
+      stack[sp++] = cpu.Dt();
+      break;
+    case Op::St:
+      stack[sp++] = cpu.St();
+      break;
+    case Op::Load: {
+      std::uint8_t byte = 0;
+      const std::int32_t addr = stack[sp - 1];
+      if (addr < 0 || ResultType::Ok != memory.read(addr, byte))
+        byte = 0;
+      stack[sp - 1] = byte;
+      break;
+    }
+    case Op::Neg:
+      stack[sp - 1] = -stack[sp - 1];
+      break;
+    case Op::Not:
+      stack[sp - 1] = !stack[sp - 1];
+      break;
+    case Op::Inv:
+      stack[sp - 1] = ~stack[sp - 1];
+      break;
+    default: {
+      const std::int32_t rhs = stack[--sp];
+      std::int32_t &lhs = stack[sp - 1];
+      switch (op) {
+      case Op::Add:
+        lhs += rhs;
+        break;
+      case Op::Sub:
+        lhs -= rhs;
+        break;
+      case Op::And:
+        lhs &= rhs;
+        break;
+      case Op::Xor:
+        lhs ^= rhs;
+        break;
+      case Op::Or:
+        lhs |= rhs;
+        break;
+      case Op::Eq:
+        lhs = lhs == rhs;
+        break;
+      case Op::Ne:
+        lhs = lhs != rhs;
+        break;
+      case Op::Lt:
+        lhs = lhs < rhs;
+        break;
+      case Op::Le:
+        lhs = lhs <= rhs;
+        break;
+      case Op::Gt:
+        lhs = lhs > rhs;
+        break;
+      case Op::Ge:
+        lhs = lhs >= rhs;
+        break;
+      case Op::LogicalAnd:
+        lhs = lhs && rhs;
+        break;
+      case Op::LogicalOr:
+        lhs = lhs || rhs;
+        break;
+      default:
+        break;
+      }
+      break;
+    }
+    }
+  }
+  return sp > 0 && 0 != stack[sp - 1];
+}
+
+void Breakpoints::setExec(std::uint16_t addr, const Condition &condition) {
+  if (addr >= Chip8::MemorySize)
+    return;
+  m_exec.set(addr);
+  if (condition.empty())
+    m_execConditions.erase(addr);
+  else
+    m_execConditions[addr] = condition;
+}
+
+void Breakpoints::setRead(std::uint16_t begin, std::uint16_t end) {
+  for (std::uint32_t addr = begin; addr < end && addr < Chip8::MemorySize;
+       ++addr)
+    m_read.set(addr);
+}
+
+void Breakpoints::setWrite(std::uint16_t begin, std::uint16_t end) {
+  for (std::uint32_t addr = begin; addr < end && addr < Chip8::MemorySize;
+       ++addr)
+    m_write.set(addr);
+}
+
+void Breakpoints::clear(std::uint16_t addr) {
+  if (addr >= Chip8::MemorySize)
+    return;
+  m_exec.reset(addr);
+  m_read.reset(addr);
+  m_write.reset(addr);
+  m_execConditions.erase(addr);
+}
+
+void Breakpoints::clearExec(std::uint16_t addr) {
+  if (addr >= Chip8::MemorySize)
+    return;
+  m_exec.reset(addr);
+  m_execConditions.erase(addr);
+}
+
+void Breakpoints::clearRead(std::uint16_t begin, std::uint16_t end) {
+  for (std::uint32_t addr = begin; addr < end && addr < Chip8::MemorySize;
+       ++addr)
+    m_read.reset(addr);
+}
+
+void Breakpoints::clearWrite(std::uint16_t begin, std::uint16_t end) {
+  for (std::uint32_t addr = begin; addr < end && addr < Chip8::MemorySize;
+       ++addr)
+    m_write.reset(addr);
+}
+
+void Breakpoints::clearAll() {
+  m_exec.reset();
+  m_read.reset();
+  m_write.reset();
+  m_execConditions.clear();
+  m_conditions.clear();
+}
+
+bool Breakpoints::checkStep(const Board &board) {
+  const std::uint16_t pc = board.pc();
+  if (pc == m_stopPc && board.cycles() == m_stopCycles)
+    return false;
+  bool stop = false;
+  if (pc < Chip8::MemorySize && m_exec[pc]) {
+    auto condition = m_execConditions.find(pc);
+    stop = m_execConditions.end() == condition ||
+           condition->second.evaluate(board);
+    if (stop)
+      hit(HitKind::Exec, pc, pc);
+  }
+  for (std::size_t it = 0; !stop && it < m_conditions.size(); ++it) {
+    stop = m_conditions[it].evaluate(board);
+    if (stop)
+      hit(HitKind::Condition, static_cast<std::uint16_t>(it), pc);
+  }
+  if (stop) {
+    m_stopPc = pc;
+    m_stopCycles = board.cycles();
+  }
+  return stop;
+}
+
+void Breakpoints::list(std::FILE *out) const {
+  for (std::size_t addr = 0; addr < Chip8::MemorySize; ++addr) {
+    if (!m_exec[addr] && !m_read[addr] && !m_write[addr])
+      continue;
+    std::fprintf(out, "0x%.3zX %s%s%s", addr, m_exec[addr] ? "x" : "-",
+                 m_read[addr] ? "r" : "-", m_write[addr] ? "w" : "-");
+    auto condition = m_execConditions.find(addr);
+    if (m_execConditions.end() != condition)
+      std::fprintf(out, " if %s", condition->second.text().c_str());
+    std::fprintf(out, "\n");
+  }
+  for (std::size_t it = 0; it < m_conditions.size(); ++it)
+    std::fprintf(out, "#%zu when %s\n", it, m_conditions[it].text().c_str());
+}
+
+} // namespace Chip8
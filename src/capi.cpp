@@ -0,0 +1,124 @@
+#include <Chip8/Board.h>
+#include <Chip8/ThreadPool.h>
+#include <chip8.h>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace {
+
+struct Env {
+  std::shared_ptr<Chip8::Video> video;
+  std::shared_ptr<Chip8::Board> board;
+  std::uint16_t keys = 0;
+};
+
+} // namespace
+
+// Nothing may throw across the C ABI, allocation failures surface as NULL
+struct chip8_envs {
+  std::vector<std::uint8_t> rom;
+  std::uint32_t seed = 0;
+  std::vector<Env> envs;
+  Chip8::ThreadPool pool;
+
+  void reset(std::size_t index) {
+    Env &env = envs[index];
+    env.board->setSeed(seed + static_cast<std::uint32_t>(index));
+    // Board::reset keeps the screen and break flag, a new episode does not
+    env.board->reset();
+    env.board->setBreak(false);
+    env.video->reset();
+    env.board->LoadBinary(rom);
+    env.keys = 0;
+  }
+  void observe(std::size_t index, std::uint8_t *out) const {
+    envs[index].video->copyPixels(out + index * CHIP8_OBSERVATION_SIZE);
+  }
+};
+
+static_assert(CHIP8_OBSERVATION_SIZE ==
+                  Chip8::ScreenWidth * Chip8::ScreenHeight,
+              "observation is one byte per pixel");
+
+unsigned chip8_abi_version(void) { return CHIP8_ABI_VERSION; }
+
+chip8_envs *chip8_envs_create(unsigned n, const uint8_t *rom,
+                              size_t rom_size, uint32_t seed) {
+  if (0 == n || (!rom && rom_size) ||
+      rom_size > Chip8::MemorySize - Chip8::ProgramStartLocation)
+    return nullptr;
+  try {
+    std::unique_ptr<chip8_envs> envs(new chip8_envs());
+    envs->rom.assign(rom, rom + rom_size);
+    envs->seed = seed;
+    envs->envs.resize(n);
+    for (unsigned index = 0; index < n; ++index) {
+      Env &env = envs->envs[index];
+      env.video = std::make_shared<Chip8::Video>();
+      env.board = std::make_shared<Chip8::Board>(
+          env.video, std::make_shared<Chip8::Audio>());
+      env.board->setTimingMode(Chip8::TimingMode::Vip);
+      envs->reset(index);
+    }
+    return envs.release();
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void chip8_envs_destroy(chip8_envs *envs) { delete envs; }
+
+unsigned chip8_envs_count(const chip8_envs *envs) {
+  return envs ? static_cast<unsigned>(envs->envs.size()) : 0;
+}
+
+int chip8_envs_step(chip8_envs *envs, const uint16_t *keys, unsigned frames,
+                    uint8_t *out) {
+  if (!envs || !keys)
+    return -1;
+  envs->pool.parallelFor(envs->envs.size(), [&](std::size_t index,
+                                                unsigned) {
+    Env &env = envs->envs[index];
+    Chip8::Board &board = *env.board;
+    for (std::uint16_t changed = env.keys ^ keys[index]; changed;
+         changed &= changed - 1) {
+      const std::uint8_t key = __builtin_ctz(changed);
+      board.handleKey(key, 0 != (keys[index] & (1u << key)));
+    }
+    env.keys = keys[index];
+    for (unsigned frame = 0;
+         frame < frames && !board.isBreak() && !board.shutdown(); ++frame)
+      board.runFrame();
+    // Written while the machine is still hot in this core's cache
+    if (out)
+      envs->observe(index, out);
+  });
+  return 0;
+}
+
+int chip8_envs_observe(const chip8_envs *envs, uint8_t *out) {
+  if (!envs || !out)
+    return -1;
+  for (std::size_t index = 0; index < envs->envs.size(); ++index)
+    envs->observe(index, out);
+  return 0;
+}
+
+int chip8_envs_reset(chip8_envs *envs, const uint8_t *mask) {
+  if (!envs)
+    return -1;
+  for (std::size_t index = 0; index < envs->envs.size(); ++index)
+    if (!mask || mask[index])
+      envs->reset(index);
+  return 0;
+}
+
+int chip8_envs_status(const chip8_envs *envs, uint8_t *out) {
+  if (!envs || !out)
+    return -1;
+  for (std::size_t index = 0; index < envs->envs.size(); ++index)
+    out[index] = envs->envs[index].board->isBreak() ? CHIP8_STATUS_BREAK
+                                                    : CHIP8_STATUS_RUNNING;
+  return 0;
+}
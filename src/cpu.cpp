@@ -16,6 +16,38 @@ void Cpu::reset() {
   std::fill(m_Stack.begin(), m_Stack.end(), 0);
   m_await = false;
   m_regKey = 0;
+  m_cycles = 0;
+  m_rng = m_seed;
+}
+
+void Cpu::saveState(BoardState &state) const {
+  state.cycles = m_cycles;
+  state.seed = m_seed;
+  state.rng = m_rng;
+  state.stack = m_Stack;
+  state.pc = m_Pc;
+  state.I = m_I;
+  state.regs = m_Regs;
+  state.sp = m_Sp;
+  state.dt = m_Dt;
+  state.st = m_St;
+  state.await = m_await ? 1 : 0;
+  state.regKey = m_regKey;
+}
+
+void Cpu::loadState(const BoardState &state) {
+  m_cycles = state.cycles;
+  m_seed = state.seed;
+  m_rng = state.rng;
+  m_Stack = state.stack;
+  m_Pc = state.pc;
+  m_I = state.I;
+  m_Regs = state.regs;
+  m_Sp = state.sp;
+  m_Dt = state.dt;
+  m_St = state.st;
+  m_await = 0 != state.await;
+  m_regKey = state.regKey & 0xF;
 }
 
 ResultType Cpu::timerStep(Board *board) {
@@ -26,6 +58,7 @@ ResultType Cpu::timerStep(Board *board) {
   } else {
     board->stopBeep();
   }
+  return ResultType::Ok;
 }
 
 void Cpu::invalid_opcode(const Instruction &instr, Board *board) {
@@ -38,29 +71,46 @@ void Cpu::invalid_opcode(const Instruction &instr, Board *board) {
 
 Cpu::Cpu() { reset(); }
 
+// Cycle costs below are COSMAC VIP machine cycles (8 clocks each) as spent by
+// the original interpreter. Every instruction additionally pays the fetch and
+// decode overhead. They are charged in every timing mode, but only
+// TimingMode::Vip derives timers from them and waits for vblank in DRW.
+namespace {
+constexpr std::uint32_t kFetchCycles = 40;
+constexpr std::uint32_t kSkipCycles = 4;
+} // namespace
+
 ResultType Cpu::step(Board *board) {
+  const bool vip = TimingMode::Vip == board->timingMode();
   if (m_await) {
+    // LD Vx, K: interpreter spins in its key scan loop
+    if (vip)
+      waitVblank();
     return ResultType::Ok;
   }
   ResultType rv;
   // Perform single instruction
   std::uint16_t opcode;
-  rv = board->memoryRead(pc(), opcode);
+  rv = board->fetch(pc(), opcode);
   CHIP8_CHECK_RESULT(rv);
+  m_opcode = opcode;
 
   Instruction instr(opcode);
+  charge(kFetchCycles);
   // printf("\t%.3X: %.4X\t%s\n", pc(), opcode, instr.disasm().c_str());
 
   switch (instr.type()) {
   case 0x0: {
     switch (instr.code()) {
     case 0x00E0: // CLS
+      charge(24);
       board->clearScreen();
       setPc(pc() + 2);
       return ResultType::Ok;
     case 0x00EE: // RET
     {
       uint16_t tmp;
+      charge(10);
       decSp();
       SpVal(tmp);
       setPc(tmp);
@@ -74,40 +124,51 @@ ResultType Cpu::step(Board *board) {
     break;
   }
   case 0x1: // JP addr
+    charge(12);
     setPc(instr.NNN());
     return ResultType::Ok;
   case 0x2: // CALL addr
+    charge(26);
     SetSpVal(pc() + 2);
     addSp();
     setPc(instr.NNN());
     return ResultType::Ok;
   case 0x3: // SE Vx, byte // Skip if Vx == byte
+    charge(10);
     if (Vx(instr.X()) == instr.NN()) {
+      charge(kSkipCycles);
       setPc(pc() + 2);
     }
     setPc(pc() + 2);
     return ResultType::Ok;
   case 0x4: // SE Vx, byte // Skip if Vx == byte
+    charge(10);
     if (Vx(instr.X()) != instr.NN()) {
+      charge(kSkipCycles);
       setPc(pc() + 2);
     }
     setPc(pc() + 2);
     return ResultType::Ok;
   case 0x5: // SE Vx, Vy, skip if Vx = Vy
+    charge(14);
     if (Vx(instr.X()) == Vx(instr.Y())) {
+      charge(kSkipCycles);
       setPc(pc() + 2);
     }
     setPc(pc() + 2);
     return ResultType::Ok;
   case 0x6: // LD Vx, byte
+    charge(6);
     setVx(instr.X(), instr.NN());
     setPc(pc() + 2);
     return ResultType::Ok;
   case 0x7: // ADD Vx, byte
+    charge(10);
     setVx(instr.X(), instr.NN() + Vx(instr.X()));
     setPc(pc() + 2);
     return ResultType::Ok;
   case 0x8:
+    charge(44);
     switch (instr.subtype1()) {
     case 0x0: // LD Vx, Vy
       setVx(instr.X(), Vx(instr.Y()));
@@ -116,7 +177,6 @@ ResultType Cpu::step(Board *board) {
     case 0x1: // OR Vx, Vy
       setVx(instr.X(), Vx(instr.X()) | Vx(instr.Y()));
       setPc(pc() + 2);
-      invalid_opcode(instr, board);
       return ResultType::Ok;
     case 0x2: // AND Vx, Vy
       setVx(instr.X(), Vx(instr.X()) & Vx(instr.Y()));
@@ -177,19 +237,24 @@ ResultType Cpu::step(Board *board) {
     }
     break;
   case 0x9: // SNE Vx, Vy, skip if Vx != Vy
+    charge(14);
     if (Vx(instr.X()) != Vx(instr.Y())) {
+      charge(kSkipCycles);
       setPc(pc() + 2);
     }
     setPc(pc() + 2);
     return ResultType::Ok;
   case 0xa: // LD I, addr
+    charge(12);
     setI(instr.NNN());
     setPc(pc() + 2);
     return ResultType::Ok;
   case 0xb: // JP V0, addr // Jump to V0 + addr
+    charge(22);
     setPc(Vx(0) + instr.NNN());
     return ResultType::Ok;
   case 0xc: // RND Vx, byte
+    charge(36);
     setVx(instr.X(), random() & instr.NN());
     setPc(pc() + 2);
     return ResultType::Ok;
@@ -198,6 +263,7 @@ ResultType Cpu::step(Board *board) {
     // TODO: Collision
     bool VF = false;
     bool res = false;
+    charge(22 + 30 * instr.N());
     for (uint8_t it = 0; it < instr.N(); ++it) {
       // Display n-byte sprite starting at memory location I at (Vx, Vy), set
       // VF
@@ -209,13 +275,18 @@ ResultType Cpu::step(Board *board) {
     }
     setVx(0xF, VF ? 1 : 0);
     setPc(pc() + 2);
+    // VIP interpreter draws in sync with the display interrupt
+    if (vip)
+      waitVblank();
     return ResultType::Ok;
   }
   case 0xe: {
+    charge(14);
     switch (instr.subtype2()) {
     case 0x9E: // SKP Vx, skip next instr if Vx PRESSED
     {
       if (board->isKeyDown(Vx(instr.X()))) {
+        charge(kSkipCycles);
         setPc(pc() + 2);
       }
       setPc(pc() + 2);
@@ -223,6 +294,7 @@ ResultType Cpu::step(Board *board) {
     }
     case 0xA1: // SKNP Vx, skip next instr if Vx NOT PRESSED
       if (!board->isKeyDown(Vx(instr.X()))) {
+        charge(kSkipCycles);
         setPc(pc() + 2);
       }
       setPc(pc() + 2);
@@ -236,22 +308,27 @@ ResultType Cpu::step(Board *board) {
   case 0xf: {
     switch (instr.subtype2()) {
     case 0x07: // LD Vx, DT
+      charge(10);
       setVx(instr.X(), Dt());
       setPc(pc() + 2);
       return ResultType::Ok;
     case 0x0A: // LD Vx, K
+      charge(10);
       setAwaitKey(instr.X());
       setPc(pc() + 2);
       return ResultType::Ok;
     case 0x15: // LD DT, Vx
+      charge(10);
       SetDt(Vx(instr.X()));
       setPc(pc() + 2);
       return ResultType::Ok;
     case 0x18: // LD ST, Vx
+      charge(10);
       SetSt(Vx(instr.X()));
       setPc(pc() + 2);
       return ResultType::Ok;
     case 0x1E: // ADD I, Vx
+      charge(16);
       setI(I() + Vx(instr.X()));
       setPc(pc() + 2);
       return ResultType::Ok;
@@ -259,6 +336,7 @@ ResultType Cpu::step(Board *board) {
     {
       // Set I = location of sprite for digit Vx.
       std::uint16_t offset;
+      charge(16);
       board->fontPtr(Vx(instr.X()), offset);
       setI(offset);
       setPc(pc() + 2);
@@ -269,6 +347,7 @@ ResultType Cpu::step(Board *board) {
       // 1) split [Vx] into B0, B1, B2
       // Store mem[i] <- B0, mem[i+1] <- B1...
       std::uint8_t value = Vx(instr.X());
+      charge(80 + 16 * (value / 100 + (value / 10) % 10 + value % 10));
       board->memoryWrite(I() + 0,
                          static_cast<std::uint8_t>((value / 100) % 10));
       board->memoryWrite(I() + 1, static_cast<std::uint8_t>((value / 10) % 10));
@@ -283,6 +362,7 @@ ResultType Cpu::step(Board *board) {
       return ResultType::Ok;
     }
     case 0x55: {
+      charge(14 + 14 * (instr.X() + 1));
       for (uint8_t it = 0; it <= instr.X(); ++it) {
         uint8_t value = Vx(it);
         board->memoryWrite(I(), value);
@@ -292,6 +372,7 @@ ResultType Cpu::step(Board *board) {
       return ResultType::Ok;
     }
     case 0x65: {
+      charge(14 + 14 * (instr.X() + 1));
       for (uint8_t it = 0; it <= instr.X(); ++it) {
         uint8_t value;
         board->memoryRead(I(), value);
@@ -324,8 +405,11 @@ ResultType Cpu::keyStep(Board * /*board*/, uint8_t key) {
 }
 
 uint8_t Cpu::random() {
-  // TODO: Better random
-  return rand() % 255;
+  // xorshift32, deterministic for a given seed
+  m_rng ^= m_rng << 13;
+  m_rng ^= m_rng >> 17;
+  m_rng ^= m_rng << 5;
+  return static_cast<uint8_t>(m_rng >> 24);
 }
 
 } // namespace Chip8
@@ -1,17 +1,23 @@
 #include "debugger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <poll.h>
 #include <readline/history.h>
 #include <readline/readline.h>
+#include <unistd.h>
+#include <vector>
 
 namespace Chip8 {
 
-Debugger::Debugger(const std::shared_ptr<Board> &board) : m_board(board) {}
+namespace {
 
-Board *Debugger::board() { return m_board.get(); }
+// Display commands run on the console thread from the last snapshot the
+// emulation thread sent back, they never touch the board
 
-void Debugger::dumpMemory(std::uint16_t offset, size_t size) {
+void dumpMemory(const BoardState &state, std::uint16_t offset, size_t size) {
   size_t dump_line = size / 16;
   // Display 16 bytes of memory
-  uint8_t byte = 0;
   for (; dump_line; dump_line--) {
     std::printf("0x%.3x\t", offset);
     size_t dump_size = 16;
@@ -22,53 +28,52 @@ void Debugger::dumpMemory(std::uint16_t offset, size_t size) {
       if (dump_size % 2 == 0) {
         std::printf("  ");
       }
-      if (ResultType::Ok == board()->memoryRead(offset++, byte)) {
-        std::printf("%.2x ", byte);
+      if (offset < state.memory.size()) {
+        std::printf("%.2x ", state.memory[offset]);
       }
+      offset++;
     }
     std::printf("\n");
   }
   std::printf("\n");
 }
 
-void Debugger::dumpDisasm(std::uint16_t offset, size_t count) {
-  for (; count > 0; --count, offset += 2) {
-    std::uint16_t opcode;
-    if (ResultType::Ok == board()->memoryRead(offset, opcode)) {
-      Instruction instr(opcode);
-      std::printf("0x%.3X\t%.4X\t%s\n", offset, opcode, instr.disasm().c_str());
-    }
+void dumpDisasm(const BoardState &state, std::uint16_t offset, size_t count) {
+  for (; count > 0 && offset + 1u < state.memory.size();
+       --count, offset += 2) {
+    const std::uint16_t opcode =
+        state.memory[offset] << 8 | state.memory[offset + 1];
+    char text[DisasmMaxLength];
+    Instruction(opcode).disasm(text, sizeof(text));
+    std::printf("0x%.3X\t%.4X\t%s\n", offset, opcode, text);
   }
 }
 
-void Debugger::dumpCpu() {
-  std::printf("PC: %.4x\n", board()->cpu()->pc());
-  std::printf("SP: %.4x\n", board()->cpu()->Sp());
-  std::printf("I: %.4x", board()->cpu()->I());
+void dumpCpu(const BoardState &state) {
+  std::printf("PC: %.4x\n", state.pc);
+  std::printf("SP: %.4x\n", state.sp);
+  std::printf("I: %.4x", state.I);
   for (size_t rId = 0; rId < 16; ++rId) {
     if (rId % 4 == 0)
       std::printf("\n");
-    std::printf("V%lX: %.2x %3i  ", rId, board()->cpu()->Vx(rId),
-                board()->cpu()->Vx(rId));
+    std::printf("V%lX: %.2x %3i  ", rId, state.regs[rId], state.regs[rId]);
   }
   std::printf("\n");
-  std::printf("TIMERS: Dt: %.3x %i St: %.3x %i\n", board()->cpu()->Dt(),
-              board()->cpu()->Dt(), board()->cpu()->St(), board()->cpu()->St());
+  std::printf("TIMERS: Dt: %.3x %i St: %.3x %i\n", state.dt, state.dt,
+              state.st, state.st);
   std::printf("Stack:\n");
   for (size_t rId = 0; rId < 16; ++rId) {
-    uint16_t out16;
     if (rId % 4 == 0)
       std::printf("\n\t");
-    board()->cpu()->SpVal(rId, out16);
-    std::printf("%.4x  ", out16);
+    std::printf("%.4x  ", state.stack[rId]);
   }
   std::printf("\n");
 }
 
-void Debugger::dumpSpriteLine(std::uint16_t offset) {
-  uint8_t sprite;
-  if (ResultType::Ok != board()->memoryRead(offset, sprite))
+void dumpSpriteLine(const BoardState &state, std::uint16_t offset) {
+  if (offset >= state.memory.size())
     return;
+  const uint8_t sprite = state.memory[offset];
   std::string line;
   line.resize(8);
   for (uint it = 0; it < 8; ++it) {
@@ -78,89 +83,551 @@ void Debugger::dumpSpriteLine(std::uint16_t offset) {
   std::printf("0x%.3X\t%.2X\t[%s]\n", offset, sprite, line.c_str());
 }
 
-void Debugger::debugger_loop() {
+bool isDisplayCommand(const char *name) {
+  return 0 == strcmp(name, "cpu") || 0 == strcmp(name, "da") ||
+         0 == strcmp(name, "d") || 0 == strcmp(name, "i");
+}
+
+// Returns false when line is not a display command
+bool display(char *line, const BoardState &state) {
   int rv;
-  while (true) {
-    char *line = readline("> ");
+  char *save = nullptr;
+  line = strtok_r(line, " ", &save);
+  if (nullptr == line || !isDisplayCommand(line)) {
+    return false;
+  }
+  if (0 == strcmp(line, "cpu")) {
+    dumpCpu(state);
+  } else if (0 == strcmp(line, "da")) {
+    std::fprintf(stderr, "Disasm\n");
+    uint32_t offset = state.pc;
+    const size_t instrCount = 8;
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line) {
+      rv = std::sscanf(line, "0x%x", &offset);
+      if (rv != 1) {
+        rv = std::sscanf(line, "%u", &offset);
+      }
+    }
+    dumpDisasm(state, offset, instrCount);
+  } else if (0 == strcmp(line, "d")) {
+    line = strtok_r(nullptr, " ", &save);
     if (nullptr == line) {
-      std::fprintf(stderr, "single cpu step\n");
-      return;
+      std::fprintf(stderr, "USAGE: d OFFSET\n");
+      return true;
+    }
+    uint32_t offset = 0;
+    rv = std::sscanf(line, "0x%x", &offset);
+    if (rv != 1) {
+      rv = std::sscanf(line, "%u", &offset);
     }
+    dumpMemory(state, offset, 16 * 16);
+  } else if (0 == strcmp(line, "i")) {
+    std::fprintf(stderr, "Print image line\n");
+    uint32_t offset = state.I;
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line) {
+      rv = std::sscanf(line, "0x%x", &offset);
+      if (rv != 1) {
+        rv = std::sscanf(line, "%u", &offset);
+      }
+    }
+    dumpSpriteLine(state, offset);
+  }
+  return true;
+}
+
+// readline callbacks carry no user pointer, one console per process
+Debugger *g_console = nullptr;
+
+} // namespace
 
-    if (0 == strlen(line)) {
-      std::fprintf(stderr, "single cpu step\n");
+Debugger::Debugger(const std::shared_ptr<Board> &board)
+    : m_board(board), m_breakpoints(std::make_shared<Breakpoints>()) {}
+
+Board *Debugger::board() { return m_board.get(); }
+
+void Debugger::rewind(size_t frames) {
+  if (!m_rewind) {
+    std::fprintf(stderr, "Rewind history disabled\n");
+    return;
+  }
+  BoardState state;
+  size_t done = 0;
+  for (; done < frames && m_rewind->rewind(state); ++done) {
+  }
+  if (done > 0) {
+    board()->loadState(state);
+  }
+  std::printf("Rewound %zu frames, %zu left (%zu bytes)\n", done,
+              m_rewind->size(), m_rewind->bytes());
+}
+
+void Debugger::dumpProfile() {
+  const auto &profiler = board()->profiler();
+  if (!profiler) {
+    std::fprintf(stderr, "Profiler disabled, build with "
+                         "CHIP8_PROFILER_ENABLED\n");
+    return;
+  }
+  profiler->report(stdout);
+}
+
+void Debugger::dumpHot(size_t count) {
+  const auto &profiler = board()->profiler();
+  if (!profiler) {
+    std::fprintf(stderr, "Profiler disabled, build with "
+                         "CHIP8_PROFILER_ENABLED\n");
+    return;
+  }
+  const double total = profiler->cycles() ? profiler->cycles() : 1;
+  for (const auto &spot : profiler->hot(count)) {
+    std::uint16_t opcode = 0;
+    if (ResultType::Ok != board()->peek(spot.pc, opcode))
+      opcode = 0;
+    char text[DisasmMaxLength];
+    Instruction(opcode).disasm(text, sizeof(text));
+    std::printf("0x%.3X\t%.4X\t%-16s %10llu %12llu %6.2f%%\n", spot.pc, opcode,
+                text,
+                static_cast<unsigned long long>(spot.counter.count),
+                static_cast<unsigned long long>(spot.counter.cycles),
+                100.0 * spot.counter.cycles / total);
+  }
+}
+
+void Debugger::dumpAccessMap(std::uint16_t offset, size_t lines) {
+  const auto &map = board()->accessMap();
+  if (!map) {
+    std::fprintf(stderr, "Access map disabled, enable with: map on\n");
+    return;
+  }
+  map->printGrid(stdout, offset, lines);
+  std::printf("\n");
+  map->printRegions(stdout);
+}
+
+void Debugger::dumpHistoryStep(const char *what, std::uint64_t step) {
+  const auto &history = board()->history();
+  if (History::None == step) {
+    std::printf("%s: not in history\n", what);
+    return;
+  }
+  std::printf("%s: step %llu (%llu steps ago), goto %llu to inspect\n", what,
+              static_cast<unsigned long long>(step),
+              static_cast<unsigned long long>(history->step() - step),
+              static_cast<unsigned long long>(step));
+}
+
+void Debugger::seekHistory(std::uint64_t step) {
+  const auto &history = board()->history();
+  if (ResultType::Ok != history->seek(*board(), step)) {
+    std::fprintf(stderr, "Step %llu out of history\n",
+                 static_cast<unsigned long long>(step));
+    return;
+  }
+  history->report(stdout);
+}
+
+void Debugger::reportHit() {
+  const Breakpoints::Hit hit = m_breakpoints->lastHit();
+  m_breakpoints->clearHit();
+  switch (hit.kind) {
+  case Breakpoints::HitKind::Exec:
+    std::fprintf(stderr, "Breakpoint at 0x%.3X\n", hit.addr);
+    break;
+  case Breakpoints::HitKind::Read:
+    std::fprintf(stderr, "Read of 0x%.3X by 0x%.3X\n", hit.addr, hit.pc);
+    break;
+  case Breakpoints::HitKind::Write:
+    std::fprintf(stderr, "Write of 0x%.3X by 0x%.3X\n", hit.addr, hit.pc);
+    break;
+  case Breakpoints::HitKind::Condition:
+    std::fprintf(stderr, "Condition #%u true at 0x%.3X\n", hit.addr, hit.pc);
+    break;
+  default:
+    break;
+  }
+}
+
+void Debugger::syncBreakpoints() {
+  // Nothing armed costs nothing in Board::step
+  board()->setBreakpoints(m_breakpoints->armed() ? m_breakpoints : nullptr);
+}
+
+void Debugger::execute(char *line) {
+  int rv;
+  char *save = nullptr;
+  line = strtok_r(line, " ", &save);
+  if (nullptr == line) {
+    return;
+  }
+
+  if (false) {
+  } else if (0 == strcmp(line, "q")) {
+    std::fprintf(stderr, "Quit\n");
+    board()->setShutdown();
+    board()->setBreak(false);
+  } else if (0 == strcmp(line, "s")) {
+    uint32_t count = 1;
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line) {
+      rv = std::sscanf(line, "%u", &count);
+    }
+    step(count);
+  } else if (0 == strcmp(line, "c")) {
+    std::fprintf(stderr, "Continue\n");
+    board()->setBreak(false);
+  } else if (0 == strcmp(line, "p")) {
+    board()->setBreak(true);
+  } else if (isDisplayCommand(line)) {
+    // Answered by the console from the snapshot sent back
+  } else if (0 == strcmp(line, "rw")) {
+    uint32_t frames = 1;
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line) {
+      rv = std::sscanf(line, "%u", &frames);
+    }
+    rewind(frames);
+  } else if (0 == strcmp(line, "prof")) {
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line && 0 == strcmp(line, "reset") &&
+        board()->profiler()) {
+      board()->profiler()->reset();
       return;
     }
-
-    line = strtok(line, " ");
+    dumpProfile();
+  } else if (0 == strcmp(line, "hot")) {
+    uint32_t count = 10;
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line) {
+      rv = std::sscanf(line, "%u", &count);
+    }
+    dumpHot(count);
+  } else if (0 == strcmp(line, "flame")) {
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
     if (nullptr == line) {
-      continue;
+      std::fprintf(stderr, "USAGE: flame FILE\n");
+      return;
     }
-
-    if (false) {
-    } else if (0 == strcmp(line, "q")) {
-      std::fprintf(stderr, "Quit\n");
-      board()->setShutdown();
-      board()->setBreak(false);
+    if (!board()->profiler() ||
+        ResultType::Ok != board()->profiler()->writeCollapsed(line)) {
+      std::fprintf(stderr, "Unable to write %s\n", line);
+    }
+  } else if (0 == strcmp(line, "map")) {
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr == line) {
+      dumpAccessMap(0, Chip8::MemorySize / 64);
       return;
-    } else if (0 == strcmp(line, "cpu")) {
-      dumpCpu();
-    } else if (0 == strcmp(line, "s")) {
-      std::fprintf(stderr, "single cpu step\n");
+    }
+    if (0 == strcmp(line, "on")) {
+      if (!board()->accessMap())
+        board()->setAccessMap(std::make_shared<AccessMap>());
       return;
-    } else if (0 == strcmp(line, "c")) {
-      std::fprintf(stderr, "Continue\n");
-      board()->setBreak(false);
+    }
+    if (0 == strcmp(line, "off")) {
+      board()->setAccessMap(nullptr);
       return;
-    } else if (0 == strcmp(line, "da")) {
-      std::fprintf(stderr, "Disasm\n");
-      uint32_t offset = board()->cpu()->pc();
-      const size_t instrCount = 8;
-      line += strlen(line);
-      line = strtok(NULL, " ");
-      if (nullptr == line) {
-        dumpDisasm(offset, instrCount);
-        continue;
-      }
-      rv = std::sscanf(line, "0x%x", &offset);
-      if (rv != 1) {
-        rv = std::sscanf(line, "%u", &offset);
-      }
-      dumpDisasm(offset, instrCount);
-    } else if (0 == strcmp(line, "d")) {
-      line += strlen(line);
-      line = strtok(NULL, " ");
-      if (nullptr == line) {
-        std::fprintf(stderr, "USAGE: d OFFSET\n");
-        continue;
-      }
-      uint32_t offset = 0;
-      rv = std::sscanf(line, "0x%x", &offset);
-      if (rv != 1) {
-        rv = std::sscanf(line, "%u", &offset);
+    }
+    if (0 == strcmp(line, "reset")) {
+      if (board()->accessMap())
+        board()->accessMap()->reset();
+      return;
+    }
+    uint32_t offset = 0;
+    rv = std::sscanf(line, "0x%x", &offset);
+    if (rv != 1) {
+      rv = std::sscanf(line, "%u", &offset);
+    }
+    dumpAccessMap(offset, 16);
+  } else if (0 == strcmp(line, "hist")) {
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line && 0 == strcmp(line, "on")) {
+      if (!board()->history())
+        board()->setHistory(std::make_shared<History>());
+    } else if (nullptr != line && 0 == strcmp(line, "off")) {
+      board()->setHistory(nullptr);
+    }
+    if (board()->history())
+      board()->history()->report(stdout);
+    else
+      std::fprintf(stderr, "History disabled, enable with: hist on\n");
+  } else if (!board()->history() &&
+             (0 == strcmp(line, "lw") || 0 == strcmp(line, "lr") ||
+              0 == strcmp(line, "rs") || 0 == strcmp(line, "rc") ||
+              0 == strcmp(line, "goto"))) {
+    std::fprintf(stderr, "History disabled, enable with: hist on\n");
+  } else if (0 == strcmp(line, "lw")) {
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr == line) {
+      std::fprintf(stderr, "USAGE: lw ADDR\n");
+      return;
+    }
+    uint32_t offset = 0;
+    rv = std::sscanf(line, "0x%x", &offset);
+    if (rv != 1) {
+      rv = std::sscanf(line, "%u", &offset);
+    }
+    const auto &history = board()->history();
+    dumpHistoryStep("Last write",
+                    history->lastMemoryWrite(offset, history->step()));
+  } else if (0 == strcmp(line, "lr")) {
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    unsigned reg = 0;
+    if (nullptr != line && 0 == strcmp(line, "I")) {
+      reg = History::RegisterI;
+    } else if (nullptr == line || 1 != std::sscanf(line, "V%x", &reg)) {
+      std::fprintf(stderr, "USAGE: lr Vx|I\n");
+      return;
+    }
+    const auto &history = board()->history();
+    dumpHistoryStep("Last change",
+                    history->lastRegisterWrite(reg, history->step()));
+  } else if (0 == strcmp(line, "rs")) {
+    uint32_t count = 1;
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line) {
+      rv = std::sscanf(line, "%u", &count);
+    }
+    const std::uint64_t step = board()->history()->step();
+    seekHistory(step > count ? step - count : 0);
+  } else if (0 == strcmp(line, "rc")) {
+    // Reverse to previous instruction of a class, DXYN by default
+    uint32_t nibble = 0xD;
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line) {
+      rv = std::sscanf(line, "%x", &nibble);
+    }
+    const auto &history = board()->history();
+    const std::uint64_t step =
+        history->lastOpcodeClass(nibble, history->step());
+    if (History::None == step) {
+      std::fprintf(stderr, "No %X class instruction in history\n", nibble);
+      return;
+    }
+    seekHistory(step);
+  } else if (0 == strcmp(line, "goto")) {
+    line += strlen(line);
+    line = strtok_r(nullptr, " ", &save);
+    unsigned long long step = 0;
+    if (nullptr == line || 1 != std::sscanf(line, "%llu", &step)) {
+      std::fprintf(stderr, "USAGE: goto STEP\n");
+      return;
+    }
+    seekHistory(step);
+  } else if (0 == strcmp(line, "b")) {
+    // b ADDR [if EXPR]
+    line = strtok_r(nullptr, " ", &save);
+    char *rest = strtok_r(nullptr, "", &save);
+    uint32_t offset = 0;
+    if (nullptr == line || (1 != std::sscanf(line, "0x%x", &offset) &&
+                            1 != std::sscanf(line, "%u", &offset))) {
+      std::fprintf(stderr, "USAGE: b ADDR [if EXPR]\n");
+      return;
+    }
+    Condition condition;
+    std::string reason;
+    if (nullptr != rest) {
+      while (' ' == *rest)
+        ++rest;
+      if (0 != strncmp(rest, "if ", 3) ||
+          ResultType::Ok != condition.compile(rest + 3, reason)) {
+        std::fprintf(stderr, "Bad condition: %s\n", reason.c_str());
+        return;
       }
-      dumpMemory(offset, 16 * 16);
-    } else if (0 == strcmp(line, "i")) {
-      std::fprintf(stderr, "Print image line\n");
-      uint32_t offset = board()->cpu()->I();
-      line += strlen(line);
-      line = strtok(NULL, " ");
-      if (nullptr == line) {
-        dumpSpriteLine(offset);
-        continue;
+    }
+    m_breakpoints->setExec(offset, condition);
+    syncBreakpoints();
+  } else if (0 == strcmp(line, "wr") || 0 == strcmp(line, "ww")) {
+    // wr|ww ADDR [LEN]
+    const bool write = 'w' == line[1];
+    line = strtok_r(nullptr, " ", &save);
+    uint32_t offset = 0;
+    uint32_t length = 1;
+    if (nullptr == line || (1 != std::sscanf(line, "0x%x", &offset) &&
+                            1 != std::sscanf(line, "%u", &offset))) {
+      std::fprintf(stderr, "USAGE: wr|ww ADDR [LEN]\n");
+      return;
+    }
+    line = strtok_r(nullptr, " ", &save);
+    if (nullptr != line) {
+      rv = std::sscanf(line, "%u", &length);
+    }
+    const uint32_t end = std::min<uint32_t>(offset + length, 0xFFFF);
+    if (write)
+      m_breakpoints->setWrite(offset, end);
+    else
+      m_breakpoints->setRead(offset, end);
+    syncBreakpoints();
+  } else if (0 == strcmp(line, "bc")) {
+    // bc EXPR, stop before any instruction once EXPR holds
+    char *rest = strtok_r(nullptr, "", &save);
+    Condition condition;
+    std::string reason = "missing expression";
+    if (nullptr == rest ||
+        ResultType::Ok != condition.compile(rest, reason)) {
+      std::fprintf(stderr, "Bad condition: %s\n", reason.c_str());
+      return;
+    }
+    m_breakpoints->addCondition(condition);
+    syncBreakpoints();
+  } else if (0 == strcmp(line, "del")) {
+    // del ADDR|cond|all
+    line = strtok_r(nullptr, " ", &save);
+    uint32_t offset = 0;
+    if (nullptr != line && 0 == strcmp(line, "all")) {
+      m_breakpoints->clearAll();
+    } else if (nullptr != line && 0 == strcmp(line, "cond")) {
+      m_breakpoints->clearConditions();
+    } else if (nullptr != line && (1 == std::sscanf(line, "0x%x", &offset) ||
+                                   1 == std::sscanf(line, "%u", &offset))) {
+      m_breakpoints->clear(offset);
+    } else {
+      std::fprintf(stderr, "USAGE: del ADDR|cond|all\n");
+      return;
+    }
+    syncBreakpoints();
+  } else if (0 == strcmp(line, "bl")) {
+    m_breakpoints->list(stdout);
+  } else if (0 == strcmp(line, "v")) {
+    std::fprintf(stderr, "dump video\n");
+    board()->video()->dump();
+  } else {
+    std::fprintf(stderr, "Unknown command [%s]\n", line);
+  }
+}
+
+void Debugger::step(std::uint32_t count) {
+  // Stays stopped, a breakpoint on the way ends the run early
+  board()->setBreak(true);
+  for (; count > 0 && !board()->shutdown(); --count) {
+    board()->step();
+    if (m_breakpoints->lastHit().kind != Breakpoints::HitKind::None) {
+      reportHit();
+      break;
+    }
+  }
+}
+
+void Debugger::publish(bool answer) {
+  Reply reply;
+  board()->saveState(reply.state);
+  reply.paused = board()->isBreak();
+  reply.answer = answer;
+  if (!m_replies.push(reply))
+    std::fprintf(stderr, "Debugger console is not keeping up\n");
+}
+
+bool Debugger::send(const char *line) {
+  Command command;
+  std::snprintf(command.line, sizeof(command.line), "%s", line);
+  return m_commands.push(command);
+}
+
+void Debugger::poll() {
+  const bool paused = board()->isBreak();
+  if (paused && !m_wasBreak) {
+    // SIGINT, invalid opcode, breakpoint or watchpoint
+    std::fprintf(stderr, "Debugger enabled\n");
+    reportHit();
+    if (!m_console.joinable())
+      m_console = std::thread(&Debugger::consoleLoop, this);
+    publish(false);
+  }
+  Command command;
+  while (m_commands.pop(command)) {
+    execute(command.line);
+    publish(true);
+  }
+  m_wasBreak = board()->isBreak();
+}
+
+void Debugger::showPrompt(bool show) {
+  if (show == m_prompt)
+    return;
+  m_prompt = show;
+  if (show)
+    rl_callback_handler_install("> ", [](char *line) {
+      g_console->showPrompt(false);
+      // EOF continues and leaves the board running
+      if (nullptr == line)
+        g_console->m_eof = true;
+      std::string text = line ? line : "c";
+      std::free(line);
+      // Empty line repeats a single step, as it always did
+      if (text.empty())
+        text = "s";
+      else
+        add_history(text.c_str());
+      if (!g_console->send(text.c_str())) {
+        std::fprintf(stderr, "Command queue full\n");
+        g_console->showPrompt(true);
+        return;
       }
-      rv = std::sscanf(line, "0x%x", &offset);
-      if (rv != 1) {
-        rv = std::sscanf(line, "%u", &offset);
+      g_console->m_pending.push_back(text);
+    });
+  else
+    rl_callback_handler_remove();
+}
+
+void Debugger::showReply(const Reply &reply) {
+  std::string line;
+  if (reply.answer && !m_pending.empty()) {
+    line = m_pending.front();
+    m_pending.pop_front();
+  }
+  std::vector<char> text(line.begin(), line.end());
+  text.push_back('\0');
+  if (display(text.data(), reply.state))
+    return;
+  // Show where the machine stands after stops and moves through time
+  const std::string name = line.substr(0, line.find(' '));
+  if (reply.paused && (!reply.answer || "s" == name || "rs" == name ||
+                       "rc" == name || "goto" == name))
+    dumpDisasm(reply.state, reply.state.pc, 1);
+}
+
+void Debugger::consoleLoop() {
+  g_console = this;
+  // SIGINT stays with the frontend, it means "stop the machine"
+  rl_catch_signals = 0;
+  while (!m_stop.load(std::memory_order_relaxed)) {
+    Reply reply;
+    bool shown = false;
+    while (receive(reply)) {
+      if (!shown && m_prompt && !reply.answer) {
+        // Unprompted stop while the prompt is open, redraw below it
+        showPrompt(false);
+        std::printf("\n");
       }
-      dumpSpriteLine(offset);
-    } else if (0 == strcmp(line, "v")) {
-      std::fprintf(stderr, "dump video\n");
-      board()->video()->dump();
-    } else {
-      std::fprintf(stderr, "Unknown command [%s]\n", line);
+      showReply(reply);
+      shown = true;
     }
+    if (m_pending.empty() && !m_eof)
+      showPrompt(true);
+    pollfd fd = {STDIN_FILENO, POLLIN, 0};
+    if (m_prompt && ::poll(&fd, 1, 20) > 0)
+      rl_callback_read_char();
+    else if (!m_prompt)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
   }
+  showPrompt(false);
+  g_console = nullptr;
+}
+
+Debugger::~Debugger() {
+  m_stop = true;
+  if (m_console.joinable())
+    m_console.join();
 }
 
 } // namespace Chip8
@@ -1,27 +1,91 @@
 #pragma once
 
 #include <Chip8/Board.h>
+#include <Chip8/Rewind.h>
+#include <Chip8/SpscQueue.h>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <thread>
 
 namespace Chip8 {
 
+// Interactive debugger split over two threads. The console thread owns the
+// terminal (readline) and sends each command line to the emulation thread
+// through a lock-free queue. The emulation thread runs them from poll()
+// between frames and answers every command with a snapshot of the machine,
+// which the console uses for register, memory and disassembly dumps. The
+// window keeps rendering while the prompt is open.
 class Debugger {
+public:
+  struct Reply {
+    BoardState state;
+    bool paused;
+    bool answer; // Reply to a command, otherwise an unprompted stop
+  };
+
+private:
+  struct Command {
+    char line[256];
+  };
+
   std::shared_ptr<Board> m_board;
+  std::shared_ptr<RewindBuffer> m_rewind;
+  // Attached to the board only while armed
+  std::shared_ptr<Breakpoints> m_breakpoints;
+
+  SpscQueue<Command, 16> m_commands;
+  SpscQueue<Reply, 8> m_replies;
+  std::thread m_console;
+  std::atomic<bool> m_stop{false};
+
+  // Emulation thread only
+  bool m_wasBreak = false;
+
+  // Console thread only
+  std::deque<std::string> m_pending; // Sent, not answered yet
+  bool m_prompt = false;
+  bool m_eof = false;
 
   Board *board();
+  void execute(char *line);
+  void step(std::uint32_t count);
+  void publish(bool answer);
+
+  void consoleLoop();
+  void showReply(const Reply &reply);
+  void showPrompt(bool show);
 
 public:
   Debugger(const std::shared_ptr<Board> &board);
-  ~Debugger() = default;
+  ~Debugger();
   Debugger(const Debugger &) = delete;
   Debugger &operator=(const Debugger &) = delete;
 
-  void dumpMemory(std::uint16_t offset, size_t size);
-  void dumpDisasm(std::uint16_t offset, size_t count);
-  void dumpCpu();
-  // void dumpSprite(std::uint16_t offset, size_t count);
-  void dumpSpriteLine(std::uint16_t offset);
+  void rewind(size_t frames);
+  void dumpProfile();
+  void dumpHot(size_t count);
+  void dumpAccessMap(std::uint16_t offset, size_t lines);
+  void dumpHistoryStep(const char *what, std::uint64_t step);
+  void seekHistory(std::uint64_t step);
+  void reportHit();
+  void syncBreakpoints();
+
+  const std::shared_ptr<Breakpoints> &breakpoints() const {
+    return m_breakpoints;
+  }
+  void setRewind(const std::shared_ptr<RewindBuffer> &rewind) {
+    m_rewind = rewind;
+  }
 
-  void debugger_loop();
+  // Emulation thread, once per main loop iteration: opens the console on
+  // the first stop, then runs queued commands. Cheap while nothing is
+  // queued and the board is running.
+  void poll();
+  // Console thread: queue a command line, false when the queue is full
+  bool send(const char *line);
+  // Console thread: next snapshot published by poll(), false when none
+  bool receive(Reply &reply) { return m_replies.pop(reply); }
 };
 
 } // namespace Chip8
@@ -0,0 +1,61 @@
+#include "fileutil.h"
+#include <Chip8/Analysis.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Static disassembler: recovers control flow from the program entry and
+// prints a labeled listing or a Graphviz graph of the basic blocks.
+
+namespace {
+
+void usage(const char *name) {
+  std::fprintf(stderr,
+               "Usage %s [OPTIONS] ROM\n"
+               "  --dot          print a Graphviz digraph instead of a "
+               "listing\n"
+               "  --origin ADDR  load address and entry point (default "
+               "0x200)\n",
+               name);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool dot = false;
+  unsigned long origin = Chip8::ProgramStartLocation;
+  const char *path = nullptr;
+  for (int it = 1; it < argc; ++it) {
+    if (0 == std::strcmp(argv[it], "--dot")) {
+      dot = true;
+    } else if (0 == std::strcmp(argv[it], "--origin") && it + 1 < argc) {
+      origin = std::strtoul(argv[++it], nullptr, 0);
+    } else if (nullptr == path && '-' != argv[it][0]) {
+      path = argv[it];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (nullptr == path || origin >= Chip8::MemorySize) {
+    usage(argv[0]);
+    return 1;
+  }
+  const std::vector<uint8_t> rom = Chip8::LoadFile(path);
+  if (rom.empty()) {
+    std::fprintf(stderr, "Unable to read %s\n", path);
+    return 1;
+  }
+  Chip8::Analysis analysis;
+  if (Chip8::ResultType::Ok != analysis.analyze(rom, origin)) {
+    std::fprintf(stderr, "%s does not fit in memory at 0x%.3lX\n", path,
+                 origin);
+    return 1;
+  }
+  if (dot)
+    analysis.writeDot(stdout);
+  else
+    analysis.writeListing(stdout);
+  return 0;
+}
@@ -0,0 +1,251 @@
+#include <Chip8/Explorer.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+namespace Chip8 {
+
+namespace {
+constexpr std::size_t kRoot = static_cast<std::size_t>(-1);
+
+std::uint64_t mix(std::uint64_t hash, std::uint64_t word) {
+  hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+  return hash ^ (hash >> 32);
+}
+
+// Word wise multiply-xorshift
+std::uint64_t hashBytes(std::uint64_t hash, const std::uint8_t *data,
+                        std::size_t size) {
+  std::size_t it = 0;
+  for (; it + 8 <= size; it += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data + it, 8);
+    hash = mix(hash, word);
+  }
+  for (; it < size; ++it)
+    hash = (hash ^ data[it]) * 0x100000001B3ull;
+  return hash;
+}
+} // namespace
+
+constexpr std::size_t Explorer::CoreBegin;
+constexpr std::size_t Explorer::CoreSize;
+
+bool Explorer::Snapshot::operator==(const Snapshot &other) const {
+  if (core != other.core)
+    return false;
+  for (std::size_t page = 0; page < pages.size(); ++page) {
+    if (pages[page] != other.pages[page] && *pages[page] != *other.pages[page])
+      return false;
+  }
+  return true;
+}
+
+Explorer::Explorer(const std::vector<std::uint8_t> &rom,
+                   const ExplorerOptions &options)
+    : m_options(options), m_rom(rom), m_pool(options.threads) {
+  if (0 == m_options.batch)
+    m_options.batch = 1;
+  m_states.resize(m_pool.size());
+  m_seen.resize(m_pool.size());
+}
+
+void Explorer::takeCore(const BoardState &state,
+                        std::array<std::uint8_t, CoreSize> &core) {
+  // Time fields are skipped so equal machines reached at different moments
+  // collapse into one state
+  const auto *data = reinterpret_cast<const std::uint8_t *>(&state);
+  const std::size_t registers = offsetof(BoardState, memory) - CoreBegin;
+  std::memcpy(core.data(), data + CoreBegin, registers);
+  std::memcpy(core.data() + registers, state.screen.data(),
+              state.screen.size());
+}
+
+std::uint64_t Explorer::hashPage(std::uint16_t page,
+                                 const std::uint8_t *data) {
+  return hashBytes(0x9E3779B97F4A7C15ull + page, data, Memory::PageSize);
+}
+
+std::uint64_t Explorer::combine(const std::array<std::uint8_t, CoreSize> &core,
+                                const PageHashes &pages) {
+  std::uint64_t hash = hashBytes(0x9E3779B97F4A7C15ull, core.data(), CoreSize);
+  for (auto page : pages)
+    hash = mix(hash, page);
+  return hash;
+}
+
+std::uint64_t Explorer::hashState(const BoardState &state) {
+  std::array<std::uint8_t, CoreSize> core;
+  takeCore(state, core);
+  PageHashes pages;
+  for (std::uint16_t page = 0; page < Memory::PageCount; ++page)
+    pages[page] =
+        hashPage(page, state.memory.data() + page * Memory::PageSize);
+  return combine(core, pages);
+}
+
+bool Explorer::visit(std::uint64_t hash, const Snapshot &snapshot) {
+  auto range = m_visited.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == snapshot)
+      return false;
+  }
+  m_visited.emplace(hash, snapshot);
+  return true;
+}
+
+std::string Explorer::formatPath(const std::vector<std::uint8_t> &inputs) {
+  static const char kNames[] = "0123456789ABCDEF.";
+  std::string out;
+  for (auto input : inputs)
+    out.push_back(kNames[input < ExplorerInputs ? input : ExplorerNoKey]);
+  return out;
+}
+
+std::vector<std::uint8_t> Explorer::path(std::size_t node) const {
+  std::vector<std::uint8_t> inputs;
+  for (; kRoot != node; node = m_nodes[node].parent) {
+    if (kRoot != m_nodes[node].parent)
+      inputs.push_back(m_nodes[node].input);
+  }
+  return std::vector<std::uint8_t>(inputs.rbegin(), inputs.rend());
+}
+
+void Explorer::evaluate(const Entry &from, std::uint8_t input,
+                        unsigned worker, Child &child) {
+  // Parents are shared before a batch, forking them is read only
+  child.board =
+      from.board->fork(std::make_shared<Video>(), std::make_shared<Audio>());
+  Board &board = *child.board;
+  if (ExplorerNoKey != input)
+    board.handleKey(input, true);
+  child.newPcs.clear();
+  auto &seen = m_seen[worker];
+  seen.reset();
+  const std::uint64_t lastFrame = board.frame() + m_options.framesPerInput;
+  while (board.frame() < lastFrame && !board.isBreak()) {
+    // Global coverage is read only while a batch is expanded
+    const std::uint16_t pc = board.pc() % Chip8::MemorySize;
+    if (!m_coverage[pc] && !seen[pc]) {
+      seen[pc] = true;
+      child.newPcs.push_back(pc);
+    }
+    board.step();
+  }
+  if (ExplorerNoKey != input)
+    board.handleKey(input, false);
+  BoardState &state = m_states[worker];
+  board.saveCoreState(state);
+  takeCore(state, child.snapshot.core);
+  // Only pages written since the fork changed
+  const Memory &memory = board.memoryPages();
+  child.pageHashes = from.pageHashes;
+  for (std::uint16_t dirty = memory.dirtyPages(); dirty; dirty &= dirty - 1) {
+    const std::uint16_t page = __builtin_ctz(dirty);
+    child.pageHashes[page] = hashPage(page, memory.page(page).data());
+  }
+  child.hash = combine(child.snapshot.core, child.pageHashes);
+  child.parent = from.node;
+  child.input = input;
+}
+
+void Explorer::run() {
+  m_nodes.clear();
+  m_visited.clear();
+  m_coverage.reset();
+  m_discoveries.clear();
+  m_levels.clear();
+
+  // Root: power-on state
+  auto root = std::make_shared<Board>(std::make_shared<Video>(),
+                                      std::make_shared<Audio>());
+  root->setTimingMode(TimingMode::Vip);
+  root->setSeed(m_options.seed);
+  root->reset();
+  root->LoadBinary(m_rom);
+  root->shareMemory();
+  std::vector<Entry> frontier(1);
+  frontier[0].board = root;
+  frontier[0].node = 0;
+  m_nodes.push_back({kRoot, ExplorerNoKey});
+  Snapshot snapshot;
+  root->saveState(m_states[0]);
+  takeCore(m_states[0], snapshot.core);
+  root->memoryPages().pages(snapshot.pages);
+  for (std::uint16_t page = 0; page < Memory::PageCount; ++page)
+    frontier[0].pageHashes[page] =
+        hashPage(page, root->memoryPages().page(page).data());
+  visit(combine(snapshot.core, frontier[0].pageHashes), snapshot);
+
+  std::vector<Child> children;
+  for (unsigned depth = 1; depth <= m_options.depth && !frontier.empty();
+       ++depth) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Entry> next;
+    std::size_t expanded = 0;
+    std::size_t unique = 0;
+    for (std::size_t batch = 0; batch < frontier.size();
+         batch += m_options.batch) {
+      const std::size_t parents =
+          std::min(m_options.batch, frontier.size() - batch);
+      children.resize(parents * ExplorerInputs);
+      expanded += children.size();
+      m_pool.parallelFor(children.size(), [&](std::size_t index,
+                                              unsigned worker) {
+        const std::size_t from = batch + index / ExplorerInputs;
+        evaluate(frontier[from],
+                 static_cast<std::uint8_t>(index % ExplorerInputs), worker,
+                 children[index]);
+      });
+      // Merge in a fixed order so results do not depend on thread timing
+      for (auto &child : children) {
+        std::size_t node = kRoot;
+        for (auto pc : child.newPcs) {
+          if (m_coverage[pc])
+            continue;
+          m_coverage[pc] = true;
+          if (kRoot == node) {
+            node = m_nodes.size();
+            m_nodes.push_back({child.parent, child.input});
+          }
+          m_discoveries.push_back({pc, path(node)});
+        }
+        std::shared_ptr<Board> board = std::move(child.board);
+        // Pages stored in the snapshot must not change under it
+        board->shareMemory();
+        board->memoryPages().pages(child.snapshot.pages);
+        if (!visit(child.hash, child.snapshot))
+          continue;
+        unique++;
+        if (next.size() >= m_options.maxStates)
+          continue;
+        if (kRoot == node) {
+          node = m_nodes.size();
+          m_nodes.push_back({child.parent, child.input});
+        }
+        next.push_back({std::move(board), node, child.pageHashes});
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+    m_levels.push_back({depth, expanded, unique, m_coverage.count(),
+                        std::chrono::duration<double>(end - start).count()});
+    frontier.swap(next);
+  }
+}
+
+void Explorer::report(std::FILE *out) const {
+  std::fprintf(out, "depth  expanded    unique  coverage  states/s\n");
+  for (const auto &level : m_levels) {
+    std::fprintf(out, "%5u  %8zu  %8zu  %8zu  %8.0f\n", level.depth,
+                 level.expanded, level.unique, level.coverage,
+                 level.seconds > 0 ? level.unique / level.seconds : 0.0);
+  }
+  std::fprintf(out, "new PCs (input path from power-on, '.' is no key):\n");
+  for (const auto &found : m_discoveries) {
+    std::fprintf(out, "  0x%.3X  %s\n", found.pc,
+                 formatPath(found.inputs).c_str());
+  }
+}
+
+} // namespace Chip8
@@ -0,0 +1,18 @@
+#include "fileutil.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace Chip8 {
+
+std::vector<uint8_t> LoadFile(const char *file) {
+  std::ifstream f{file, std::ios::binary};
+  if (!f) {
+    std::fprintf(stderr, "Unable open file %s\n", file);
+    return {};
+  }
+  return std::vector<uint8_t>((std::istreambuf_iterator<char>(f)),
+                              std::istreambuf_iterator<char>());
+}
+
+} // namespace Chip8
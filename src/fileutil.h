@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Chip8 {
+
+// Read whole file, empty vector on failure
+std::vector<uint8_t> LoadFile(const char *file);
+
+} // namespace Chip8
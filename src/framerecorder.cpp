@@ -0,0 +1,128 @@
+#include <Chip8/FrameRecorder.h>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+constexpr unsigned FrameRecorder::MaxScale;
+constexpr std::size_t FrameRecorder::BlockRuns;
+
+namespace {
+// Studio swing luma of lit and dark pixels, chroma is neutral
+constexpr std::uint8_t LumaOn = 235;
+constexpr std::uint8_t LumaOff = 16;
+constexpr std::uint8_t ChromaNeutral = 128;
+const char kFrameTag[] = "FRAME\n";
+constexpr std::size_t FrameTagLength = sizeof(kFrameTag) - 1;
+} // namespace
+
+FrameRecorder::~FrameRecorder() {
+  if (isOpen() && ResultType::Ok != close())
+    std::fprintf(stderr, "Video file could not be completed\n");
+}
+
+ResultType FrameRecorder::open(const char *path, FrameFormat format,
+                               unsigned scale) {
+  if (isOpen() || 0 == scale || scale > MaxScale)
+    return ResultType::Error;
+  m_file = std::fopen(path, "wb");
+  if (nullptr == m_file)
+    return ResultType::Error;
+  bool ok = true;
+  if (FrameFormat::Y4m == format) {
+    ok = 0 < std::fprintf(m_file, "YUV4MPEG2 W%u H%u F60:1 Ip A1:1 C420jpeg\n",
+                          ScreenWidth * scale, ScreenHeight * scale);
+  } else {
+    m_index = std::fopen((std::string(path) + ".idx").c_str(), "w");
+    ok = nullptr != m_index &&
+         0 < std::fprintf(m_index, "# %ux%u gray8, frame repeat\n",
+                          ScreenWidth * scale, ScreenHeight * scale);
+  }
+  if (!ok) {
+    std::fclose(m_file);
+    m_file = nullptr;
+    if (m_index)
+      std::fclose(m_index);
+    m_index = nullptr;
+    return ResultType::Error;
+  }
+  m_format = format;
+  m_scale = scale;
+  m_hasPending = false;
+  m_frames = 0;
+  m_stored = 0;
+  const std::size_t width = ScreenWidth * scale;
+  const std::size_t height = ScreenHeight * scale;
+  m_buffer.assign(FrameTagLength + width * height +
+                      2 * (width / 2) * (height / 2),
+                  ChromaNeutral);
+  // Everything but the luma plane is the same for every frame
+  std::memcpy(m_buffer.data(), kFrameTag, FrameTagLength);
+  m_writer.start([this](const Block &block) {
+    bool ok = true;
+    for (std::size_t it = 0; it < block.size; ++it)
+      ok = writeRun(block.runs[it]) && ok;
+    return ok;
+  });
+  return ResultType::Ok;
+}
+
+bool FrameRecorder::writeRun(const Run &run) {
+  std::uint8_t *buffer = m_buffer.data();
+  const std::size_t width = ScreenWidth * m_scale;
+  const std::size_t height = ScreenHeight * m_scale;
+  const std::size_t lumaSize = width * height;
+  const std::size_t chromaSize = 2 * (width / 2) * (height / 2);
+  std::uint8_t *luma = buffer;
+  if (FrameFormat::Y4m == m_format)
+    luma += FrameTagLength;
+  // One scaled row from the packed bits, then repeated scale times
+  for (std::size_t y = 0; y < ScreenHeight; ++y) {
+    std::uint8_t *row = luma + y * m_scale * width;
+    const std::uint8_t *bits = run.pixels.data() + y * ScreenWidth / 8;
+    std::uint8_t *out = row;
+    for (std::size_t x = 0; x < ScreenWidth; ++x) {
+      const bool on = 0 != (bits[x / 8] & (0x80 >> (x % 8)));
+      std::memset(out, on ? LumaOn : LumaOff, m_scale);
+      out += m_scale;
+    }
+    for (unsigned copy = 1; copy < m_scale; ++copy)
+      std::memcpy(row + copy * width, row, width);
+  }
+  if (FrameFormat::Raw == m_format) {
+    if (lumaSize != std::fwrite(luma, 1, lumaSize, m_file))
+      return false;
+    return 0 < std::fprintf(m_index, "%llu %u\n",
+                            static_cast<unsigned long long>(run.first),
+                            run.repeat);
+  }
+  // Y4M has no repeat, the finished frame goes out once per frame
+  const std::size_t frameSize = FrameTagLength + lumaSize + chromaSize;
+  for (std::uint32_t it = 0; it < run.repeat; ++it)
+    if (frameSize != std::fwrite(buffer, 1, frameSize, m_file))
+      return false;
+  return true;
+}
+
+ResultType FrameRecorder::close() {
+  if (!isOpen())
+    return ResultType::Error;
+  // The last run is complete now
+  if (m_hasPending) {
+    // capture() submits full blocks, there is room for it
+    Block &block = m_writer.block();
+    block.runs[block.size++] = m_pending;
+    m_stored++;
+    m_hasPending = false;
+  }
+  bool ok = m_writer.stop();
+  ok = (0 == std::fclose(m_file)) && ok;
+  m_file = nullptr;
+  if (m_index) {
+    ok = (0 == std::fclose(m_index)) && ok;
+    m_index = nullptr;
+  }
+  return ok ? ResultType::Ok : ResultType::Error;
+}
+
+} // namespace Chip8
@@ -0,0 +1,535 @@
+#include "gdbstub.h"
+#include <Chip8/State.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Chip8 {
+
+namespace {
+
+constexpr unsigned RegisterCount = 21;
+
+const char kTargetXml[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+    "<target version=\"1.0\">\n"
+    "<feature name=\"org.chip8.core\">\n"
+    "<reg name=\"v0\" bitsize=\"8\" type=\"uint8\" regnum=\"0\"/>\n"
+    "<reg name=\"v1\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"v2\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"v3\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"v4\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"v5\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"v6\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"v7\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"v8\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"v9\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"va\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"vb\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"vc\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"vd\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"ve\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"vf\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>\n"
+    "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+    "<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"dt\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "<reg name=\"st\" bitsize=\"8\" type=\"uint8\"/>\n"
+    "</feature>\n"
+    "</target>\n";
+
+const char kHex[] = "0123456789abcdef";
+
+void putHex(std::string &out, std::uint8_t byte) {
+  out += kHex[byte >> 4];
+  out += kHex[byte & 0xF];
+}
+
+int hexDigit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Decodes hex pairs from text, false on malformed input
+bool getHex(const char *text, std::size_t count, std::uint8_t *out) {
+  for (std::size_t it = 0; it < count; ++it) {
+    const int hi = hexDigit(text[2 * it]);
+    const int lo = hi < 0 ? -1 : hexDigit(text[2 * it + 1]);
+    if (lo < 0)
+      return false;
+    out[it] = static_cast<std::uint8_t>(hi << 4 | lo);
+  }
+  return true;
+}
+
+// Register bytes in target order, 16 bit registers little endian
+std::size_t registerBytes(const BoardState &state, unsigned reg,
+                          std::uint8_t *out) {
+  if (reg < Chip8::StdRegisterCount) {
+    out[0] = state.regs[reg];
+    return 1;
+  }
+  switch (reg) {
+  case 16:
+  case 17: {
+    const std::uint16_t value = 16 == reg ? state.I : state.pc;
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    return 2;
+  }
+  case 18:
+    out[0] = state.sp;
+    return 1;
+  case 19:
+    out[0] = state.dt;
+    return 1;
+  case 20:
+    out[0] = state.st;
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+void setRegister(BoardState &state, unsigned reg, const std::uint8_t *in) {
+  if (reg < Chip8::StdRegisterCount) {
+    state.regs[reg] = in[0];
+    return;
+  }
+  switch (reg) {
+  case 16:
+    state.I = (in[0] | in[1] << 8) & 0xFFF;
+    break;
+  case 17:
+    state.pc = (in[0] | in[1] << 8) & 0xFFF;
+    break;
+  case 18:
+    state.sp = in[0] < Chip8::StackSize ? in[0] : state.sp;
+    break;
+  case 19:
+    state.dt = in[0];
+    break;
+  case 20:
+    state.st = in[0];
+    break;
+  default:
+    break;
+  }
+}
+
+std::string hexNumber(unsigned value) {
+  char text[16];
+  std::snprintf(text, sizeof(text), "%x", value);
+  return text;
+}
+
+} // namespace
+
+GdbServer::GdbServer(const std::shared_ptr<Board> &board,
+                     const std::shared_ptr<Breakpoints> &breakpoints)
+    : m_board(board), m_breakpoints(breakpoints) {}
+
+GdbServer::~GdbServer() {
+  disconnect();
+  if (m_listen >= 0)
+    close(m_listen);
+}
+
+ResultType GdbServer::listen(std::uint16_t port) {
+  m_listen = socket(AF_INET, SOCK_STREAM, 0);
+  if (m_listen < 0)
+    return ResultType::Error;
+  const int one = 1;
+  setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  // Loopback only, the protocol has no authentication
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  socklen_t length = sizeof(addr);
+  if (0 != bind(m_listen, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) ||
+      0 != ::listen(m_listen, 1) ||
+      0 != fcntl(m_listen, F_SETFL, O_NONBLOCK) ||
+      0 != getsockname(m_listen, reinterpret_cast<sockaddr *>(&addr),
+                       &length)) {
+    close(m_listen);
+    m_listen = -1;
+    return ResultType::Error;
+  }
+  m_port = ntohs(addr.sin_port);
+  return ResultType::Ok;
+}
+
+void GdbServer::accept() {
+  const int client = ::accept(m_listen, nullptr, nullptr);
+  if (client < 0)
+    return;
+  const int one = 1;
+  setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (0 != fcntl(client, F_SETFL, O_NONBLOCK)) {
+    close(client);
+    return;
+  }
+  m_client = client;
+  m_in.clear();
+  m_out.clear();
+  m_noAck = false;
+  m_running = false;
+  m_interrupted = false;
+  // GDB expects a stopped target on attach
+  m_board->setBreak(true);
+  m_breakpoints->clearHit();
+}
+
+void GdbServer::disconnect() {
+  if (m_client < 0)
+    return;
+  close(m_client);
+  m_client = -1;
+  m_running = false;
+  m_board->setBreak(false);
+}
+
+void GdbServer::poll() {
+  if (m_listen < 0)
+    return;
+  if (m_client < 0) {
+    accept();
+    if (m_client < 0)
+      return;
+  }
+  receive();
+  if (m_client >= 0 && m_running && m_board->isBreak()) {
+    m_running = false;
+    reply(stopReply());
+  }
+  flush();
+}
+
+void GdbServer::receive() {
+  char buffer[4096];
+  while (true) {
+    const ssize_t count = recv(m_client, buffer, sizeof(buffer), 0);
+    if (count > 0) {
+      m_in.append(buffer, count);
+      continue;
+    }
+    if (0 == count || (EAGAIN != errno && EWOULDBLOCK != errno &&
+                       EINTR != errno)) {
+      disconnect();
+      return;
+    }
+    break;
+  }
+  while (!m_in.empty() && m_client >= 0) {
+    if ('\x03' == m_in[0]) {
+      // Interrupt request, reported once the board has stopped
+      m_in.erase(0, 1);
+      if (m_running) {
+        m_interrupted = true;
+        m_board->setBreak(true);
+      }
+      continue;
+    }
+    if ('$' != m_in[0]) {
+      // Acks and line noise
+      m_in.erase(0, 1);
+      continue;
+    }
+    const std::size_t end = m_in.find('#');
+    if (std::string::npos == end || end + 3 > m_in.size())
+      return;
+    const std::string packet = m_in.substr(1, end - 1);
+    std::uint8_t sum = 0;
+    for (char c : packet)
+      sum += static_cast<std::uint8_t>(c);
+    std::uint8_t expected;
+    const bool valid =
+        getHex(m_in.c_str() + end + 1, 1, &expected) && expected == sum;
+    m_in.erase(0, end + 3);
+    if (!m_noAck)
+      m_out += valid ? '+' : '-';
+    if (valid)
+      handle(packet);
+  }
+}
+
+void GdbServer::flush() {
+  while (m_client >= 0 && !m_out.empty()) {
+    const ssize_t count =
+        send(m_client, m_out.data(), m_out.size(), MSG_NOSIGNAL);
+    if (count > 0) {
+      m_out.erase(0, count);
+    } else {
+      if (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno)
+        disconnect();
+      return;
+    }
+  }
+}
+
+void GdbServer::reply(const std::string &payload) {
+  std::uint8_t sum = 0;
+  for (char c : payload)
+    sum += static_cast<std::uint8_t>(c);
+  m_out += '$';
+  m_out += payload;
+  m_out += '#';
+  putHex(m_out, sum);
+}
+
+std::string GdbServer::stopReply() {
+  const Breakpoints::Hit hit = m_breakpoints->lastHit();
+  m_breakpoints->clearHit();
+  if (m_interrupted) {
+    m_interrupted = false;
+    return "T02";
+  }
+  switch (hit.kind) {
+  case Breakpoints::HitKind::Exec:
+    return "T05swbreak:;";
+  case Breakpoints::HitKind::Write:
+    return "T05watch:" + hexNumber(hit.addr) + ";";
+  case Breakpoints::HitKind::Read:
+    return "T05rwatch:" + hexNumber(hit.addr) + ";";
+  default:
+    return "T05";
+  }
+}
+
+void GdbServer::syncBreakpoints() {
+  m_board->setBreakpoints(m_breakpoints->armed() ? m_breakpoints : nullptr);
+}
+
+void GdbServer::handle(const std::string &packet) {
+  const char *args = packet.c_str() + 1;
+  BoardState state;
+  switch (packet.empty() ? '\0' : packet[0]) {
+  case '?':
+    reply("S05");
+    return;
+  case 'g': {
+    m_board->saveState(state);
+    std::string out;
+    std::uint8_t bytes[2];
+    for (unsigned reg = 0; reg < RegisterCount; ++reg) {
+      const std::size_t count = registerBytes(state, reg, bytes);
+      for (std::size_t it = 0; it < count; ++it)
+        putHex(out, bytes[it]);
+    }
+    reply(out);
+    return;
+  }
+  case 'G': {
+    m_board->saveState(state);
+    std::uint8_t bytes[2] = {0, 0};
+    const char *pos = args;
+    for (unsigned reg = 0; reg < RegisterCount; ++reg) {
+      const std::size_t count = registerBytes(state, reg, bytes);
+      if (std::strlen(pos) < 2 * count || !getHex(pos, count, bytes)) {
+        reply("E01");
+        return;
+      }
+      setRegister(state, reg, bytes);
+      pos += 2 * count;
+    }
+    m_board->loadState(state);
+    reply("OK");
+    return;
+  }
+  case 'p': {
+    m_board->saveState(state);
+    std::uint8_t bytes[2];
+    const std::size_t count =
+        registerBytes(state, std::strtoul(args, nullptr, 16), bytes);
+    std::string out;
+    for (std::size_t it = 0; it < count; ++it)
+      putHex(out, bytes[it]);
+    reply(count ? out : "E01");
+    return;
+  }
+  case 'P': {
+    char *value;
+    const unsigned reg = std::strtoul(args, &value, 16);
+    m_board->saveState(state);
+    std::uint8_t bytes[2] = {0, 0};
+    const std::size_t count = registerBytes(state, reg, bytes);
+    if (!count || '=' != *value || std::strlen(value + 1) < 2 * count ||
+        !getHex(value + 1, count, bytes)) {
+      reply("E01");
+      return;
+    }
+    setRegister(state, reg, bytes);
+    m_board->loadState(state);
+    reply("OK");
+    return;
+  }
+  case 'm':
+  case 'M': {
+    char *pos;
+    const unsigned long addr = std::strtoul(args, &pos, 16);
+    const unsigned long length =
+        ',' == *pos ? std::strtoul(pos + 1, &pos, 16) : 0;
+    if (addr >= Chip8::MemorySize || addr + length > Chip8::MemorySize) {
+      reply("E01");
+      return;
+    }
+    m_board->saveState(state);
+    if ('m' == packet[0]) {
+      std::string out;
+      for (unsigned long it = 0; it < length; ++it)
+        putHex(out, state.memory[addr + it]);
+      reply(out);
+      return;
+    }
+    // Through the state, so the write is not seen as one by the program
+    if (':' != *pos || std::strlen(pos + 1) < 2 * length ||
+        !getHex(pos + 1, length, &state.memory[addr])) {
+      reply("E01");
+      return;
+    }
+    m_board->loadState(state);
+    reply("OK");
+    return;
+  }
+  case 'c':
+  case 's':
+  case 'v': {
+    char action = packet[0];
+    if ('v' == action) {
+      if (0 == packet.compare(0, 6, "vCont?")) {
+        reply("vCont;c;C;s;S");
+        return;
+      }
+      if (0 != packet.compare(0, 6, "vCont;")) {
+        reply("");
+        return;
+      }
+      action = static_cast<char>(std::tolower(packet[6]));
+    } else if ('\0' != *args) {
+      // Resume address
+      m_board->saveState(state);
+      state.pc = std::strtoul(args, nullptr, 16) & 0xFFF;
+      m_board->loadState(state);
+    }
+    if ('s' == action) {
+      m_board->setBreak(true);
+      m_board->step();
+      reply(stopReply());
+    } else {
+      m_running = true;
+      m_board->setBreak(false);
+    }
+    return;
+  }
+  case 'Z':
+  case 'z': {
+    char *pos;
+    const unsigned long type = std::strtoul(args, &pos, 16);
+    const unsigned long addr =
+        ',' == *pos ? std::strtoul(pos + 1, &pos, 16) : Chip8::MemorySize;
+    const unsigned long kind =
+        ',' == *pos ? std::strtoul(pos + 1, &pos, 16) : 1;
+    if (type > 4 || addr >= Chip8::MemorySize) {
+      reply(type > 4 ? "" : "E01");
+      return;
+    }
+    const std::uint16_t begin = addr;
+    const std::uint16_t end = std::min<unsigned long>(
+        addr + (kind ? kind : 1), Chip8::MemorySize);
+    const bool set = 'Z' == packet[0];
+    if (type <= 1) {
+      if (set)
+        m_breakpoints->setExec(begin);
+      else
+        m_breakpoints->clearExec(begin);
+    }
+    if (2 == type || 4 == type) {
+      if (set)
+        m_breakpoints->setWrite(begin, end);
+      else
+        m_breakpoints->clearWrite(begin, end);
+    }
+    if (3 == type || 4 == type) {
+      if (set)
+        m_breakpoints->setRead(begin, end);
+      else
+        m_breakpoints->clearRead(begin, end);
+    }
+    syncBreakpoints();
+    reply("OK");
+    return;
+  }
+  case 'q':
+    if (0 == packet.compare(0, 10, "qSupported")) {
+      reply("PacketSize=4000;qXfer:features:read+;QStartNoAckMode+;"
+            "swbreak+");
+    } else if ("qAttached" == packet) {
+      reply("1");
+    } else if ("qC" == packet) {
+      reply("QC1");
+    } else if ("qfThreadInfo" == packet) {
+      reply("m1");
+    } else if ("qsThreadInfo" == packet) {
+      reply("l");
+    } else if (0 == packet.compare(0, 31, "qXfer:features:read:target.xml:")) {
+      char *pos;
+      const std::size_t offset =
+          std::strtoul(packet.c_str() + 31, &pos, 16);
+      const std::size_t length =
+          ',' == *pos ? std::strtoul(pos + 1, nullptr, 16) : 0;
+      const std::string xml = kTargetXml;
+      if (offset >= xml.size())
+        reply("l");
+      else if (offset + length >= xml.size())
+        reply("l" + xml.substr(offset));
+      else
+        reply("m" + xml.substr(offset, length));
+    } else {
+      reply("");
+    }
+    return;
+  case 'Q':
+    if ("QStartNoAckMode" == packet) {
+      reply("OK");
+      m_noAck = true;
+    } else {
+      reply("");
+    }
+    return;
+  case 'H':
+  case 'T':
+    reply("OK");
+    return;
+  case 'D':
+    reply("OK");
+    flush();
+    disconnect();
+    return;
+  case 'k':
+    m_board->setShutdown();
+    disconnect();
+    return;
+  default:
+    reply("");
+    return;
+  }
+}
+
+} // namespace Chip8
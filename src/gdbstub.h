@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Chip8/Board.h>
+#include <Chip8/Breakpoints.h>
+#include <memory>
+#include <string>
+
+namespace Chip8 {
+
+// GDB remote serial protocol server on a loopback TCP port. Every socket is
+// non-blocking and serviced from poll(), called once per main loop
+// iteration on the emulation thread, so the machine keeps running at full
+// speed between packets. Breakpoints share the debugger's set, which is
+// attached to the board only while armed.
+//
+// Register numbers as in target.xml: 0-15 V0-VF (8 bit), 16 I and 17 PC
+// (16 bit little endian), 18 SP, 19 DT, 20 ST (8 bit). Memory is the 4 KiB
+// address space.
+class GdbServer {
+  std::shared_ptr<Board> m_board;
+  std::shared_ptr<Breakpoints> m_breakpoints;
+  int m_listen = -1;
+  int m_client = -1;
+  std::uint16_t m_port = 0;
+  std::string m_in;
+  std::string m_out;
+  bool m_noAck = false;
+  // Board runs on behalf of the client, a stop must be reported
+  bool m_running = false;
+  bool m_interrupted = false;
+
+  void accept();
+  void disconnect();
+  void receive();
+  void flush();
+  void handle(const std::string &packet);
+  void reply(const std::string &payload);
+  std::string stopReply();
+  void syncBreakpoints();
+
+public:
+  GdbServer(const std::shared_ptr<Board> &board,
+            const std::shared_ptr<Breakpoints> &breakpoints);
+  ~GdbServer();
+  GdbServer(const GdbServer &) = delete;
+  GdbServer &operator=(const GdbServer &) = delete;
+
+  // Port 0 picks a free port, see port()
+  CHIP8_WARN_UNUSED ResultType listen(std::uint16_t port);
+  std::uint16_t port() const { return m_port; }
+  bool connected() const { return m_client >= 0; }
+  void poll();
+};
+
+} // namespace Chip8
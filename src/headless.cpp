@@ -0,0 +1,405 @@
+#include <Chip8/Audio.h>
+#include <Chip8/Board.h>
+#include <Chip8/Explorer.h>
+#include <Chip8/FrameRecorder.h>
+#include <Chip8/Movie.h>
+#include <Chip8/SaveState.h>
+#include <Chip8/SharedEnv.h>
+#include <Chip8/TerminalVideo.h>
+#include <Chip8/Trace.h>
+#include <Chip8/Video.h>
+#include <Chip8/WavAudio.h>
+
+#include "fileutil.h"
+#include "perfcounters.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+
+// Headless batch runner. Always uses cycle accurate timing and runs as fast
+// as the host allows, so results match interactive runs bit for bit.
+
+namespace {
+
+struct Options {
+  const char *file = nullptr;
+  const char *replay = nullptr;
+  const char *loadState = nullptr;
+  const char *saveState = nullptr;
+  const char *accessMap = nullptr;
+  const char *trace = nullptr;
+  std::uint32_t seed = 0;
+  std::uint64_t frames = 0;
+  bool dumpVideo = false;
+  bool perf = false;
+  const char *draw = nullptr;
+  const char *wav = nullptr;
+  unsigned wavRate = 44100;
+  const char *video = nullptr;
+  unsigned videoScale = 4;
+  const char *shared = nullptr;
+  unsigned instances = 1;
+  unsigned explore = 0;
+  unsigned threads = 0;
+  unsigned framesPerInput = 8;
+};
+
+void usage(const char *name) {
+  std::fprintf(stderr,
+               "Usage %s [OPTIONS] [FILE_PATH]\n"
+               "  -n FRAMES  frames to run (default: movie length or 600)\n"
+               "  -s SEED    RNG seed\n"
+               "  -p FILE    replay input movie\n"
+               "  -l FILE    resume from save state, FILE_PATH is optional\n"
+               "  -S FILE    write save state at exit\n"
+               "  -v         dump video memory at exit\n"
+               "  -P         read hardware performance counters\n"
+               "  -m FILE    write memory access map (binary) at exit\n"
+               "  -T FILE    record execution trace, see Chip8_trace\n"
+               "  -x DEPTH   explore reachable states trying every key at "
+               "DEPTH decision points\n"
+               "  -F FRAMES  frames each explored input is held (default 8)\n"
+               "  -t N       explorer worker threads (default: all cores)\n"
+               "  -d GLYPHS  draw to the terminal at 60 frames/s, GLYPHS is "
+               "braille or quad\n"
+               "  -a FILE    render the beeper into a WAV file at exit\n"
+               "  -R RATE    WAV sample rate (default 44100)\n"
+               "  -V FILE    record video, Y4M when FILE ends in .y4m, else "
+               "raw gray frames\n"
+               "             with a FILE.idx repeat index\n"
+               "  -Z SCALE   video pixel scale (default 4)\n"
+               "  -E NAME    serve external agents through shared memory NAME "
+               "(e.g. /chip8)\n"
+               "  -I N       instances served with -E (default 1)\n",
+               name);
+}
+
+// Every instance runs on its own thread until its agent quits
+int serveShared(const Options &opts, const std::vector<uint8_t> &rom) {
+  Chip8::SharedRegion region;
+  if (Chip8::ResultType::Ok != region.create(opts.shared, opts.instances)) {
+    std::fprintf(stderr, "Unable to create shared memory %s\n", opts.shared);
+    return 1;
+  }
+  std::printf("serving %u instances on %s\n", opts.instances, opts.shared);
+  std::fflush(stdout);
+  std::vector<std::thread> threads;
+  for (unsigned index = 0; index < opts.instances; ++index) {
+    threads.emplace_back([&, index]() {
+      Chip8::Board board(std::make_shared<Chip8::Video>(),
+                         std::make_shared<Chip8::Audio>());
+      board.setTimingMode(Chip8::TimingMode::Vip);
+      board.setSeed(opts.seed + index);
+      board.reset();
+      board.LoadBinary(rom);
+      region.serve(board, index, rom);
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  return 0;
+}
+
+int run(const Options &opts) {
+  std::vector<uint8_t> binaryBlob;
+  if (opts.file) {
+    binaryBlob = Chip8::LoadFile(opts.file);
+    if (0 == binaryBlob.size()) {
+      std::fprintf(stderr, "File not found or empty file\n");
+      return 1;
+    }
+  }
+  if (opts.shared)
+    return serveShared(opts, binaryBlob);
+
+  std::shared_ptr<Chip8::Video> video;
+  std::shared_ptr<Chip8::TerminalVideo> terminal;
+  if (opts.draw) {
+    terminal = std::make_shared<Chip8::TerminalVideo>(
+        STDOUT_FILENO, 0 == std::strcmp(opts.draw, "quad")
+                           ? Chip8::TerminalVideo::Glyphs::Quadrant
+                           : Chip8::TerminalVideo::Glyphs::Braille);
+    video = terminal;
+  } else {
+    video = std::make_shared<Chip8::Video>();
+  }
+  std::shared_ptr<Chip8::Audio> audio;
+  std::shared_ptr<Chip8::WavAudio> wav;
+  if (opts.wav) {
+    wav = std::make_shared<Chip8::WavAudio>();
+    audio = wav;
+  } else {
+    audio = std::make_shared<Chip8::Audio>();
+  }
+  auto board = std::make_shared<Chip8::Board>(video, audio);
+  if (wav)
+    wav->attach(*board);
+  board->setTimingMode(Chip8::TimingMode::Vip);
+  board->setSeed(opts.seed);
+
+  if (opts.explore) {
+    Chip8::ExplorerOptions options;
+    options.depth = opts.explore;
+    options.framesPerInput = opts.framesPerInput;
+    options.threads = opts.threads;
+    options.seed = opts.seed;
+    Chip8::Explorer explorer(binaryBlob, options);
+    explorer.run();
+    explorer.report(stdout);
+    return 0;
+  }
+
+  Chip8::MoviePlayer player;
+  std::uint64_t frames = opts.frames ? opts.frames : 600;
+  if (opts.replay) {
+    if (Chip8::ResultType::Ok != player.load(opts.replay)) {
+      std::fprintf(stderr, "Unable to load movie %s\n", opts.replay);
+      return 1;
+    }
+    if (player.header().romHash != Chip8::romHash(binaryBlob)) {
+      std::fprintf(stderr, "Warning: movie was recorded with another ROM\n");
+    }
+    player.prepare(*board);
+    if (0 == opts.frames)
+      frames = player.header().frames;
+  }
+  board->reset();
+  board->LoadBinary(binaryBlob);
+  if (opts.loadState) {
+    auto start = std::chrono::steady_clock::now();
+    if (Chip8::ResultType::Ok != Chip8::loadStateFile(opts.loadState, *board)) {
+      std::fprintf(stderr, "Unable to load state %s\n", opts.loadState);
+      return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::printf("state loaded: frame %llu in %.1f us\n",
+                static_cast<unsigned long long>(board->frame()),
+                std::chrono::duration<double, std::micro>(end - start).count());
+  }
+
+  const std::uint64_t lastFrame = (opts.replay ? 0 : board->frame()) + frames;
+  const std::uint64_t firstFrame = board->frame();
+  if (opts.accessMap)
+    board->setAccessMap(std::make_shared<Chip8::AccessMap>());
+  auto tracer = std::make_shared<Chip8::TraceRecorder>();
+  if (opts.trace) {
+    if (Chip8::ResultType::Ok != tracer->open(opts.trace)) {
+      std::fprintf(stderr, "Unable to record trace %s\n", opts.trace);
+      return 1;
+    }
+    board->setTracer(tracer);
+  }
+  auto frameRecorder = std::make_shared<Chip8::FrameRecorder>();
+  if (opts.video) {
+    const std::size_t length = std::strlen(opts.video);
+    const bool y4m =
+        length > 4 && 0 == std::strcmp(opts.video + length - 4, ".y4m");
+    if (Chip8::ResultType::Ok !=
+        frameRecorder->open(opts.video,
+                            y4m ? Chip8::FrameFormat::Y4m
+                                : Chip8::FrameFormat::Raw,
+                            opts.videoScale)) {
+      std::fprintf(stderr, "Unable to record video %s\n", opts.video);
+      return 1;
+    }
+    board->setFrameRecorder(frameRecorder);
+  }
+  std::uint64_t steps = 0;
+  std::unique_ptr<Chip8::PerfCounters> perf;
+  if (opts.perf) {
+    perf.reset(new Chip8::PerfCounters());
+    if (perf->available())
+      perf->start();
+    else
+      std::fprintf(stderr, "perf counters unavailable (%s)\n",
+                   perf->reason().c_str());
+  }
+  auto start = std::chrono::steady_clock::now();
+  while (board->frame() < lastFrame && !board->isBreak() &&
+         !board->shutdown()) {
+    const std::uint64_t frame = board->frame();
+    player.apply(*board);
+    board->step();
+    steps++;
+    if (terminal && frame != board->frame()) {
+      // Paced to real time, the picture is meant to be watched
+      terminal->update();
+      std::this_thread::sleep_until(
+          start + std::chrono::microseconds(
+                      (board->frame() - firstFrame) * 1000000 / 60));
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  if (terminal)
+    terminal->close();
+  double secs = std::chrono::duration<double>(end - start).count();
+  Chip8::PerfCounters::Sample sample;
+  if (perf && perf->available())
+    sample = perf->stop();
+  if (opts.video) {
+    board->setFrameRecorder(nullptr);
+    if (Chip8::ResultType::Ok != frameRecorder->close()) {
+      std::fprintf(stderr, "Unable to write video %s\n", opts.video);
+      return 1;
+    }
+  }
+  if (opts.trace) {
+    board->setTracer(nullptr);
+    if (Chip8::ResultType::Ok != tracer->close()) {
+      std::fprintf(stderr, "Unable to write trace %s\n", opts.trace);
+      return 1;
+    }
+  }
+
+  std::printf("frames:       %llu\n",
+              static_cast<unsigned long long>(board->frame()));
+  std::printf("instructions: %llu\n", static_cast<unsigned long long>(steps));
+  std::printf("cycles:       %llu\n",
+              static_cast<unsigned long long>(board->cycles()));
+  std::printf("time:         %.3f s\n", secs);
+  if (secs > 0) {
+    std::printf("speed:        %.0f instr/s, %.0f frames/s (%.1fx realtime)\n",
+                steps / secs, board->frame() / secs,
+                board->frame() / secs / 60.0);
+  }
+  if (perf && perf->available()) {
+    // Cpu::step dispatch and the Video::flipSprite path of the whole run
+    Chip8::PrintPerfSample(stdout, sample, steps, board->frame() - firstFrame);
+  }
+  if (opts.video) {
+    std::printf("video:        %llu frames, %llu distinct\n",
+                static_cast<unsigned long long>(frameRecorder->frames()),
+                static_cast<unsigned long long>(frameRecorder->stored()));
+  }
+  if (terminal && terminal->framesWritten()) {
+    std::printf("terminal:     %.0f bytes/frame\n",
+                static_cast<double>(terminal->bytesWritten()) /
+                    terminal->framesWritten());
+  }
+  if (board->isBreak()) {
+    std::printf("stopped on break at PC %.4X\n", board->pc());
+  }
+  if (opts.dumpVideo) {
+    video->dump();
+  }
+  if (wav) {
+    auto renderStart = std::chrono::steady_clock::now();
+    if (Chip8::ResultType::Ok !=
+        wav->writeWav(opts.wav, opts.wavRate, board->cycles())) {
+      std::fprintf(stderr, "Unable to write audio %s\n", opts.wav);
+      return 1;
+    }
+    auto renderEnd = std::chrono::steady_clock::now();
+    std::printf("audio:        %zu beeps, %.3f s of tone, rendered in "
+                "%.1f ms\n",
+                (wav->transitions().size() + 1) / 2,
+                static_cast<double>(wav->beepCycles(board->cycles())) /
+                    (Chip8::VipCyclesPerFrame * 60.0),
+                std::chrono::duration<double, std::milli>(renderEnd -
+                                                          renderStart)
+                    .count());
+  }
+  if (opts.accessMap) {
+    const auto &map = board->accessMap();
+    const std::uint16_t romEnd =
+        Chip8::ProgramStartLocation + binaryBlob.size();
+    std::printf("coverage:     %zu of %zu ROM bytes executed\n",
+                map->executed(Chip8::ProgramStartLocation, romEnd),
+                binaryBlob.size());
+    map->printRegions(stdout);
+    if (Chip8::ResultType::Ok != map->writeBinary(opts.accessMap)) {
+      std::fprintf(stderr, "Unable to write access map %s\n", opts.accessMap);
+      return 1;
+    }
+  }
+  if (opts.saveState &&
+      Chip8::ResultType::Ok != Chip8::saveStateFile(opts.saveState, *board)) {
+    std::fprintf(stderr, "Unable to save state %s\n", opts.saveState);
+    return 1;
+  }
+  return board->isBreak() ? 2 : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts;
+  int opt;
+  while (-1 !=
+         (opt = getopt(argc, argv, "n:s:p:l:S:vPm:T:x:F:t:d:a:R:V:Z:E:I:"))) {
+    switch (opt) {
+    case 'n':
+      opts.frames = std::strtoull(optarg, nullptr, 0);
+      break;
+    case 's':
+      opts.seed = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'p':
+      opts.replay = optarg;
+      break;
+    case 'l':
+      opts.loadState = optarg;
+      break;
+    case 'S':
+      opts.saveState = optarg;
+      break;
+    case 'v':
+      opts.dumpVideo = true;
+      break;
+    case 'P':
+      opts.perf = true;
+      break;
+    case 'm':
+      opts.accessMap = optarg;
+      break;
+    case 'T':
+      opts.trace = optarg;
+      break;
+    case 'x':
+      opts.explore = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'F':
+      opts.framesPerInput = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 't':
+      opts.threads = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'd':
+      opts.draw = optarg;
+      break;
+    case 'a':
+      opts.wav = optarg;
+      break;
+    case 'R':
+      opts.wavRate = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'V':
+      opts.video = optarg;
+      break;
+    case 'Z':
+      opts.videoScale = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'E':
+      opts.shared = optarg;
+      break;
+    case 'I':
+      opts.instances = std::strtoul(optarg, nullptr, 0);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind < argc) {
+    opts.file = argv[optind];
+  } else if (!opts.loadState) {
+    usage(argv[0]);
+    return 1;
+  }
+  return run(opts);
+}
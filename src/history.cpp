@@ -0,0 +1,226 @@
+#include <Chip8/Board.h>
+#include <Chip8/History.h>
+#include <algorithm>
+
+namespace Chip8 {
+
+constexpr unsigned History::RegisterI;
+constexpr std::uint64_t History::None;
+constexpr std::uint8_t History::EventTimer;
+
+History::History(std::uint64_t snapshotInterval, std::uint64_t maxSteps)
+    : m_interval(std::max<std::uint64_t>(1, snapshotInterval)),
+      m_maxSteps(std::max(maxSteps, 2 * m_interval)) {}
+
+void History::attach(const Board &board) {
+  m_step = m_end = m_begin = 0;
+  m_replaying = false;
+  m_snapshots.clear();
+  m_events.clear();
+  for (auto &steps : m_registers)
+    steps.clear();
+  for (auto &steps : m_memory)
+    steps.clear();
+  for (auto &steps : m_classes)
+    steps.clear();
+  m_snapshots.emplace_back();
+  m_snapshots.back().step = 0;
+  board.saveState(m_snapshots.back().state);
+}
+
+void History::endStep(const Board &board, const Registers &regs,
+                      std::uint16_t I, std::uint16_t opcode, bool executed) {
+  if (m_replaying)
+    return;
+  if (executed) {
+    for (unsigned reg = 0; reg < regs.size(); ++reg) {
+      if (regs[reg] != m_regs[reg])
+        m_registers[reg].push_back(m_step);
+    }
+    if (I != m_I)
+      m_registers[RegisterI].push_back(m_step);
+    m_classes[opcode >> 12].push_back(m_step);
+  }
+  m_end = ++m_step;
+  // Snapshot holds the state before any event of its step is applied
+  if (0 != m_step % m_interval)
+    return;
+  if (m_end - m_begin > m_maxSteps)
+    trim();
+  m_snapshots.emplace_back();
+  m_snapshots.back().step = m_step;
+  board.saveState(m_snapshots.back().state);
+}
+
+void History::keyEvent(std::uint8_t key, bool down) {
+  if (m_replaying)
+    return;
+  if (m_step < m_end)
+    truncate();
+  m_events.push_back(Event{m_step, key, down});
+}
+
+void History::keyLoaded(const Registers &before, const Registers &after) {
+  if (m_replaying || m_step <= m_begin)
+    return;
+  // Credited to the step that waited for the key, seeking to the next one
+  // already shows the value
+  const std::uint64_t step = m_step - 1;
+  for (unsigned reg = 0; reg < before.size(); ++reg) {
+    auto &steps = m_registers[reg];
+    if (before[reg] != after[reg] && (steps.empty() || steps.back() != step))
+      steps.push_back(step);
+  }
+}
+
+void History::timerEvent() {
+  if (m_replaying)
+    return;
+  if (m_step < m_end)
+    truncate();
+  m_events.push_back(Event{m_step, EventTimer, false});
+}
+
+void History::truncate() {
+  // New input after seeking back, the recorded future no longer happens
+  const std::uint64_t step = m_step;
+  auto drop = [step](std::vector<std::uint64_t> &steps) {
+    steps.erase(std::lower_bound(steps.begin(), steps.end(), step),
+                steps.end());
+  };
+  std::for_each(m_registers.begin(), m_registers.end(), drop);
+  std::for_each(m_memory.begin(), m_memory.end(), drop);
+  std::for_each(m_classes.begin(), m_classes.end(), drop);
+  while (!m_snapshots.empty() && m_snapshots.back().step > step)
+    m_snapshots.pop_back();
+  // Events of this step are already applied, new ones append to them
+  while (!m_events.empty() && m_events.back().step > step)
+    m_events.pop_back();
+  m_end = step;
+}
+
+void History::trim() {
+  // Forget the oldest half, amortized over maxSteps / 2 recorded steps
+  const std::uint64_t keep = m_end - m_maxSteps / 2;
+  auto first = std::upper_bound(
+      m_snapshots.begin(), m_snapshots.end(), keep,
+      [](std::uint64_t step, const Snapshot &s) { return step < s.step; });
+  if (first == m_snapshots.begin())
+    return;
+  --first;
+  const std::uint64_t begin = first->step;
+  m_snapshots.erase(m_snapshots.begin(), first);
+  auto drop = [begin](std::vector<std::uint64_t> &steps) {
+    steps.erase(steps.begin(),
+                std::lower_bound(steps.begin(), steps.end(), begin));
+  };
+  std::for_each(m_registers.begin(), m_registers.end(), drop);
+  std::for_each(m_memory.begin(), m_memory.end(), drop);
+  std::for_each(m_classes.begin(), m_classes.end(), drop);
+  m_events.erase(m_events.begin(),
+                 std::lower_bound(m_events.begin(), m_events.end(), begin,
+                                  [](const Event &e, std::uint64_t step) {
+                                    return e.step < step;
+                                  }));
+  m_begin = begin;
+}
+
+std::uint64_t History::lastBefore(const std::vector<std::uint64_t> &steps,
+                                  std::uint64_t step) {
+  auto it = std::lower_bound(steps.begin(), steps.end(), step);
+  if (it == steps.begin())
+    return None;
+  return *--it;
+}
+
+std::uint64_t History::lastMemoryWrite(std::uint16_t addr,
+                                       std::uint64_t before) const {
+  if (addr >= m_memory.size())
+    return None;
+  return lastBefore(m_memory[addr], before);
+}
+
+std::uint64_t History::lastRegisterWrite(unsigned reg,
+                                         std::uint64_t before) const {
+  if (reg >= m_registers.size())
+    return None;
+  return lastBefore(m_registers[reg], before);
+}
+
+std::uint64_t History::lastOpcodeClass(std::uint8_t nibble,
+                                       std::uint64_t before) const {
+  if (nibble >= m_classes.size())
+    return None;
+  return lastBefore(m_classes[nibble], before);
+}
+
+ResultType History::seek(Board &board, std::uint64_t target) {
+  if (target < m_begin || target > m_end || m_snapshots.empty())
+    return ResultType::OutOfRange;
+  // Nearest snapshot at or before target
+  auto snapshot = std::upper_bound(
+      m_snapshots.begin(), m_snapshots.end(), target,
+      [](std::uint64_t step, const Snapshot &s) { return step < s.step; });
+  --snapshot;
+  auto event = std::lower_bound(m_events.begin(), m_events.end(),
+                                snapshot->step,
+                                [](const Event &e, std::uint64_t step) {
+                                  return e.step < step;
+                                });
+  // Replayed steps must not stop on breakpoints, and the tools fed from
+  // Board::step already saw them when they first ran
+  const std::shared_ptr<Breakpoints> breakpoints = board.breakpoints();
+  const std::shared_ptr<Profiler> profiler = board.profiler();
+  const std::shared_ptr<AccessMap> accessMap = board.accessMap();
+  const std::shared_ptr<TraceRecorder> tracer = board.tracer();
+  const std::shared_ptr<FrameRecorder> frameRecorder = board.frameRecorder();
+  board.setBreakpoints(nullptr);
+  board.setProfiler(nullptr);
+  board.setAccessMap(nullptr);
+  board.setTracer(nullptr);
+  board.setFrameRecorder(nullptr);
+  m_replaying = true;
+  board.loadState(snapshot->state);
+  for (std::uint64_t step = snapshot->step;; ++step) {
+    for (; event != m_events.end() && event->step == step; ++event) {
+      if (EventTimer == event->key)
+        board.timerStep();
+      else
+        board.handleKey(event->key, event->down);
+    }
+    if (step == target)
+      break;
+    board.step();
+  }
+  m_replaying = false;
+  board.setBreakpoints(breakpoints);
+  board.setProfiler(profiler);
+  board.setAccessMap(accessMap);
+  board.setTracer(tracer);
+  board.setFrameRecorder(frameRecorder);
+  m_step = target;
+  return ResultType::Ok;
+}
+
+std::size_t History::bytes() const {
+  std::size_t total = m_snapshots.capacity() * sizeof(Snapshot) +
+                      m_events.capacity() * sizeof(Event);
+  for (const auto &steps : m_registers)
+    total += steps.capacity() * sizeof(std::uint64_t);
+  for (const auto &steps : m_memory)
+    total += steps.capacity() * sizeof(std::uint64_t);
+  for (const auto &steps : m_classes)
+    total += steps.capacity() * sizeof(std::uint64_t);
+  return total;
+}
+
+void History::report(std::FILE *out) const {
+  std::fprintf(out, "Step %llu of %llu..%llu, %zu snapshots, %zu events, "
+                    "%zu KiB\n",
+               static_cast<unsigned long long>(m_step),
+               static_cast<unsigned long long>(m_begin),
+               static_cast<unsigned long long>(m_end), m_snapshots.size(),
+               m_events.size(), bytes() / 1024);
+}
+
+} // namespace Chip8
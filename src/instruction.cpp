@@ -1,158 +1,191 @@
 #include <Chip8/Instruction.h>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
 
 namespace Chip8 {
 
+namespace {
+
+// Appends to a caller buffer, truncating but always terminating
+class Writer {
+  char *m_out;
+  std::size_t m_size;
+  std::size_t m_length = 0;
+
+public:
+  Writer(char *out, std::size_t size) : m_out(out), m_size(size) {}
+  Writer &put(char c) {
+    if (m_length + 1 < m_size)
+      m_out[m_length++] = c;
+    return *this;
+  }
+  Writer &put(const char *text) {
+    for (; *text; ++text)
+      put(*text);
+    return *this;
+  }
+  // Uppercase hex without leading zeros
+  Writer &hex(unsigned value) {
+    int shift = 8;
+    while (shift > 0 && 0 == (value >> shift))
+      shift -= 4;
+    for (; shift >= 0; shift -= 4)
+      put("0123456789ABCDEF"[0xF & (value >> shift)]);
+    return *this;
+  }
+  Writer &reg(unsigned index) { return put('V').hex(index); }
+  std::size_t done() {
+    if (m_size)
+      m_out[m_length] = '\0';
+    return m_length;
+  }
+};
+
+// MNEMONIC Vx, 0xNN
+std::size_t regByte(Writer &w, const char *name, unsigned x, unsigned nn) {
+  return w.put(name).reg(x).put(", 0x").hex(nn).done();
+}
+
+// MNEMONIC Vx, Vy
+std::size_t regReg(Writer &w, const char *name, unsigned x, unsigned y) {
+  return w.put(name).reg(x).put(", ").reg(y).done();
+}
+
+} // namespace
+
+bool Instruction::valid() const {
+  switch (type()) {
+  case 0x0:
+    return 0x00E0 == code() || 0x00EE == code();
+  case 0x8:
+    return subtype1() <= 0x7 || 0xe == subtype1();
+  case 0xe:
+    return 0x9E == subtype2() || 0xA1 == subtype2();
+  case 0xf:
+    switch (subtype2()) {
+    case 0x07:
+    case 0x0A:
+    case 0x15:
+    case 0x18:
+    case 0x1E:
+    case 0x29:
+    case 0x33:
+    case 0x55:
+    case 0x65:
+      return true;
+    default:
+      return false;
+    }
+  default:
+    return true;
+  }
+}
+
 std::string Instruction::disasm() const {
-  std::stringstream str;
-  str << std::hex << std::uppercase;
+  char text[DisasmMaxLength];
+  return std::string(text, disasm(text, sizeof(text)));
+}
+
+std::size_t Instruction::disasm(char *out, std::size_t size) const {
+  Writer w(out, size);
+  const unsigned x = X();
+  const unsigned y = Y();
 
   switch (type()) {
-  case 0x0: {
+  case 0x0:
     switch (code()) {
     case 0x00E0:
-      str << "CLS";
-      break;
+      return w.put("CLS").done();
     case 0x00EE:
-      str << "RET";
-      break;
+      return w.put("RET").done();
     default:
-      str << "[UNKNOWN]";
       break;
     }
     break;
-  }
   case 0x1:
-    str << "JP " << NNN();
-    break;
+    return w.put("JP ").hex(NNN()).done();
   case 0x2:
-    str << "CALL " << NNN();
-    break;
+    return w.put("CALL ").hex(NNN()).done();
   case 0x3:
-    str << "SE V" << (std::uint16_t)X() << ", 0x" << NN();
-    break;
+    return regByte(w, "SE ", x, NN());
   case 0x4:
-    str << "SNE V" << (std::uint16_t)X() << ", 0x" << NN();
-    break;
+    return regByte(w, "SNE ", x, NN());
   case 0x5:
-    str << "SE V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y();
-    break;
+    return regReg(w, "SE ", x, y);
   case 0x6:
-    str << "LD V" << (std::uint16_t)X() << ", 0x" << NN();
-    break;
+    return regByte(w, "LD ", x, NN());
   case 0x7:
-    str << "ADD V" << (std::uint16_t)X() << ", 0x" << NN();
-    break;
+    return regByte(w, "ADD ", x, NN());
   case 0x8:
     switch (subtype1()) {
     case 0x0:
-      str << "LD V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y();
-      break;
+      return regReg(w, "LD ", x, y);
     case 0x1:
-      str << "OR V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y();
-      break;
+      return regReg(w, "OR ", x, y);
     case 0x2:
-      str << "AND V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y();
-      break;
+      return regReg(w, "AND ", x, y);
     case 0x3:
-      str << "XOR V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y();
-      break;
+      return regReg(w, "XOR ", x, y);
     case 0x4:
-      str << "ADD V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y();
-      break;
+      return regReg(w, "ADD ", x, y);
     case 0x5:
-      str << "SUB V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y();
-      break;
+      return regReg(w, "SUB ", x, y);
     case 0x6:
-      str << "SHR V" << (std::uint16_t)X() << "{, V" << (std::uint16_t)Y()
-          << "}";
-      break;
+      return w.put("SHR ").reg(x).put("{, ").reg(y).put('}').done();
     case 0x7:
-      str << "SUBN V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y();
-      break;
+      return regReg(w, "SUBN ", x, y);
     case 0xe:
-      str << "SHL V" << (std::uint16_t)X() << "{, V" << (std::uint16_t)Y()
-          << "}";
-      break;
+      return w.put("SHL ").reg(x).put("{, ").reg(y).put('}').done();
     default:
-      str << "[UNKNOWN]";
       break;
     }
     break;
   case 0x9:
-    str << "SNE V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y();
-    break;
+    return regReg(w, "SNE ", x, y);
   case 0xa:
-    str << "LD I, 0x" << NNN();
-    break;
+    return w.put("LD I, 0x").hex(NNN()).done();
   case 0xb:
-    str << "JP V0, 0x" << NNN();
-    break;
+    return w.put("JP V0, 0x").hex(NNN()).done();
   case 0xc:
-    str << "RND V" << (std::uint16_t)X() << ", 0x" << NN();
-    break;
+    return regByte(w, "RND ", x, NN());
   case 0xd:
-    str << "DRW V" << (std::uint16_t)X() << ", V" << (std::uint16_t)Y()
-        << ", 0x" << N();
-    break;
-  case 0xe: {
+    return w.put("DRW ").reg(x).put(", ").reg(y).put(", 0x").hex(N()).done();
+  case 0xe:
     switch (subtype2()) {
     case 0x9E:
-      str << "SKP V" << (std::uint16_t)X();
-      break;
+      return w.put("SKP ").reg(x).done();
     case 0xA1:
-      str << "SKNP V" << (std::uint16_t)X();
-      break;
+      return w.put("SKNP ").reg(x).done();
     default:
-      str << "[UNKNOWN]";
       break;
     }
     break;
-  }
-  case 0xf: {
+  case 0xf:
     switch (subtype2()) {
     case 0x07:
-      str << "LD V" << (std::uint16_t)X() << ", DT";
-      break;
+      return w.put("LD ").reg(x).put(", DT").done();
     case 0x0A:
-      str << "LD V" << (std::uint16_t)X() << ", K";
-      break;
+      return w.put("LD ").reg(x).put(", K").done();
     case 0x15:
-      str << "LD DT, V" << (std::uint16_t)X();
-      break;
+      return w.put("LD DT, ").reg(x).done();
     case 0x18:
-      str << "LD ST, V" << (std::uint16_t)X();
-      break;
+      return w.put("LD ST, ").reg(x).done();
     case 0x1E:
-      str << "ADD I, V" << (std::uint16_t)X();
-      break;
+      return w.put("ADD I, ").reg(x).done();
     case 0x29:
-      str << "LD F, V" << (std::uint16_t)X();
-      break;
+      return w.put("LD F, ").reg(x).done();
     case 0x33:
-      str << "LD B, V" << (std::uint16_t)X();
-      break;
+      return w.put("LD B, ").reg(x).done();
     case 0x55:
-      str << "LD [I], V" << (std::uint16_t)X();
-      break;
+      return w.put("LD [I], ").reg(x).done();
     case 0x65:
-      str << "LD V" << (std::uint16_t)X() << ", [I]";
-      break;
+      return w.put("LD ").reg(x).put(", [I]").done();
     default:
-      str << "[UNKNOWN]";
       break;
     }
-
     break;
-  }
   default:
-    str << "[UNKNOWN]";
     break;
   }
-
-  return str.str();
+  return w.put("[UNKNOWN]").done();
 }
 
 } // namespace Chip8
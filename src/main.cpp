@@ -1,19 +1,30 @@
 #include <Chip8/Board.h>
 #include <Chip8/Cpu.h>
 #include <Chip8/Memory.h>
+#include <Chip8/Movie.h>
+#include <Chip8/Rewind.h>
+#include <Chip8/RunAhead.h>
+#include <Chip8/SaveState.h>
+#include <Chip8/ThreadPool.h>
 #include <Chip8/Video.h>
 
 #include "debugger.h"
+#include "fileutil.h"
+#include "gdbstub.h"
+#include "romconfig.h"
 #include "sdlaudio.h"
+#include "sdlgrid.h"
 #include "sdlvideo.h"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_keyboard.h>
 #include <csignal>
 #include <cstdio>
-#include <fstream>
+#include <cstdlib>
 #include <map>
 #include <memory>
+#include <string>
+#include <unistd.h>
 
 namespace {
 
@@ -31,16 +42,6 @@ const std::map<SDL_Scancode, std::uint16_t> kKeyMap = {
     {SDL_SCANCODE_C, 0xB}, {SDL_SCANCODE_V, 0xF},
 };
 
-std::vector<uint8_t> LoadFile(const char *file) {
-  std::ifstream f{file};
-  if (!f) {
-    std::fprintf(stderr, "Unable open file %s\n", file);
-    return {};
-  }
-  return std::vector<uint8_t>((std::istreambuf_iterator<char>(f)),
-                              std::istreambuf_iterator<char>());
-}
-
 volatile std::sig_atomic_t debugger_enabled = false;
 
 void signal_handler(int signal_no) {
@@ -49,21 +50,164 @@ void signal_handler(int signal_no) {
   }
 }
 
-int main_loop(const char *file) {
-  auto binaryBlob = LoadFile(file);
+struct Options {
+  const char *file = nullptr;
+  Chip8::TimingMode timing = Chip8::TimingMode::Host;
+  std::uint32_t seed = 0;
+  const char *record = nullptr;
+  unsigned rewindSeconds = 0;
+  int runAhead = -1; // -1 when not given on command line
+  int gdbPort = -1;
+  unsigned instances = 0; // Grid of silent machines when given
+  unsigned scale = 16;
+  bool upscale = false;
+  Chip8::UpscaleFilter filter = Chip8::UpscaleFilter::Nearest;
+  unsigned effects = 0;
+};
+
+// FILTER[,EFFECT...], e.g. scale2x,scanlines
+bool parseUpscale(const char *arg, Options &opts) {
+  std::string text(arg);
+  std::size_t begin = 0;
+  while (begin <= text.size()) {
+    std::size_t end = text.find(',', begin);
+    if (std::string::npos == end)
+      end = text.size();
+    const std::string item = text.substr(begin, end - begin);
+    if ("nearest" == item)
+      opts.filter = Chip8::UpscaleFilter::Nearest;
+    else if ("scale2x" == item || "epx" == item)
+      opts.filter = Chip8::UpscaleFilter::Scale2x;
+    else if ("scanlines" == item)
+      opts.effects |= Chip8::UpscaleScanlines;
+    else if ("grid" == item)
+      opts.effects |= Chip8::UpscaleGrid;
+    else
+      return false;
+    begin = end + 1;
+  }
+  opts.upscale = true;
+  return true;
+}
+
+// Runs opts.instances copies of the ROM with consecutive seeds in one
+// window, keys go to every machine
+int grid_loop(const Options &opts) {
+  auto binaryBlob = Chip8::LoadFile(opts.file);
   if (0 == binaryBlob.size()) {
     std::fprintf(stderr, "File not found or empty file\n");
     return 1;
   }
-  auto video = std::make_shared<Chip8::SDLVideo>();
+  Chip8::SDLGrid grid(opts.instances);
+  grid.show();
+  std::vector<std::shared_ptr<Chip8::Video>> videos;
+  std::vector<std::shared_ptr<Chip8::Board>> boards;
+  for (unsigned index = 0; index < opts.instances; ++index) {
+    videos.push_back(std::make_shared<Chip8::Video>());
+    videos.back()->reset();
+    boards.push_back(std::make_shared<Chip8::Board>(
+        videos.back(), std::make_shared<Chip8::Audio>()));
+    boards.back()->setTimingMode(Chip8::TimingMode::Vip);
+    boards.back()->setSeed(opts.seed + index);
+    boards.back()->reset();
+    boards.back()->LoadBinary(binaryBlob);
+  }
+  Chip8::ThreadPool pool;
+
+  Uint32 last_timer_tick = SDL_GetTicks();
+  bool should_quit = false;
+  SDL_Event event;
+  while (!should_quit) {
+    while (SDL_PollEvent(&event)) {
+      if (SDL_QUIT == event.type) {
+        should_quit = true;
+      } else if (SDL_KEYDOWN == event.type || SDL_KEYUP == event.type) {
+        if (SDL_SCANCODE_ESCAPE == event.key.keysym.scancode)
+          should_quit = true;
+        auto keyEntry = kKeyMap.find(event.key.keysym.scancode);
+        if (keyEntry != kKeyMap.end()) {
+          for (auto &board : boards)
+            board->handleKey(keyEntry->second, SDL_KEYDOWN == event.type);
+        }
+      }
+    }
+    Uint32 next_timer_tick = SDL_GetTicks();
+    if (next_timer_tick - last_timer_tick > 16) {
+      last_timer_tick = next_timer_tick;
+      pool.parallelFor(boards.size(), [&](std::size_t index, unsigned) {
+        if (!boards[index]->shutdown())
+          boards[index]->runFrame();
+      });
+      grid.update(videos);
+    } else {
+      SDL_Delay(1);
+    }
+  }
+  return 0;
+}
+
+int main_loop(const Options &opts) {
+  const char *file = opts.file;
+  auto binaryBlob = Chip8::LoadFile(file);
+  if (0 == binaryBlob.size()) {
+    std::fprintf(stderr, "File not found or empty file\n");
+    return 1;
+  }
+  auto video = std::make_shared<Chip8::SDLVideo>(opts.scale);
+  if (opts.upscale)
+    video->setUpscaler(opts.filter, opts.effects);
   auto audio = std::make_shared<Chip8::SDLAudio>();
   video->show();
+  // With run-ahead the real board stays headless, the run-ahead board draws
+  std::shared_ptr<Chip8::Video> boardVideo = video;
+  std::unique_ptr<Chip8::RunAhead> runAhead;
+  if (opts.runAhead > 0) {
+    boardVideo = std::make_shared<Chip8::Video>();
+    runAhead.reset(new Chip8::RunAhead(video, opts.runAhead));
+  }
   // Initialize Board
-  auto board = std::make_shared<Chip8::Board>(video, audio);
+  auto board = std::make_shared<Chip8::Board>(boardVideo, audio);
+  board->setTimingMode(opts.timing);
+  board->setSeed(opts.seed);
+  board->reset();
   board->LoadBinary(binaryBlob);
+#ifdef CHIP8_ENABLE_PROFILER
+  board->setProfiler(std::make_shared<Chip8::Profiler>());
+#endif
+
+  Chip8::MovieWriter recorder;
+  if (opts.record &&
+      Chip8::ResultType::Ok != recorder.open(opts.record, *board, binaryBlob)) {
+    std::fprintf(stderr, "Unable to record movie %s\n", opts.record);
+    return 1;
+  }
+
+  // Rewind history, one snapshot per frame
+  std::shared_ptr<Chip8::RewindBuffer> rewind;
+  if (opts.rewindSeconds > 0) {
+    if (opts.record) {
+      std::fprintf(stderr, "Rewind is disabled while recording a movie\n");
+    } else {
+      rewind = std::make_shared<Chip8::RewindBuffer>(opts.rewindSeconds * 60);
+    }
+  }
+  bool rewinding = false;
+  Chip8::BoardState state;
+  const std::string statePath = std::string(file) + ".state";
 
   // Initialize debugger
   auto debugger = std::make_shared<Chip8::Debugger>(board);
+  debugger->setRewind(rewind);
+  // A GDB client replaces the console, both share one breakpoint set
+  std::unique_ptr<Chip8::GdbServer> gdb;
+  if (opts.gdbPort >= 0) {
+    gdb.reset(new Chip8::GdbServer(board, debugger->breakpoints()));
+    if (Chip8::ResultType::Ok != gdb->listen(opts.gdbPort)) {
+      std::fprintf(stderr, "Unable to listen on port %d\n", opts.gdbPort);
+      return 1;
+    }
+    std::fprintf(stderr, "Waiting for GDB on 127.0.0.1:%u\n", gdb->port());
+  }
 
   Uint32 last_timer_tick = SDL_GetTicks();
   Uint32 last_board_tick = last_timer_tick;
@@ -87,8 +231,33 @@ int main_loop(const char *file) {
           should_quit = 1;
           break;
         }
+        if (SDL_SCANCODE_BACKSPACE == event.key.keysym.scancode) {
+          rewinding = SDL_KEYDOWN == event.type;
+          break;
+        }
+        if (SDL_KEYDOWN == event.type &&
+            SDL_SCANCODE_F5 == event.key.keysym.scancode) {
+          if (Chip8::ResultType::Ok !=
+              Chip8::saveStateFile(statePath.c_str(), *board))
+            std::fprintf(stderr, "Unable to save %s\n", statePath.c_str());
+          break;
+        }
+        if (SDL_KEYDOWN == event.type &&
+            SDL_SCANCODE_F9 == event.key.keysym.scancode) {
+          if (recorder.isOpen()) {
+            std::fprintf(stderr, "Loading state is disabled while recording\n");
+          } else if (Chip8::ResultType::Ok !=
+                     Chip8::loadStateFile(statePath.c_str(), *board)) {
+            std::fprintf(stderr, "Unable to load %s\n", statePath.c_str());
+          }
+          break;
+        }
         auto keyEntry = kKeyMap.find(event.key.keysym.scancode);
         if (keyEntry != kKeyMap.end()) {
+          if (runAhead && SDL_KEYDOWN == event.type && !event.key.repeat)
+            runAhead->keyPressed();
+          recorder.record(board->cycles(), keyEntry->second,
+                          SDL_KEYDOWN == event.type);
           board->handleKey(keyEntry->second, SDL_KEYDOWN == event.type);
         }
         break;
@@ -102,24 +271,44 @@ int main_loop(const char *file) {
     Uint32 next_timer_tick = SDL_GetTicks();
     if (next_timer_tick - last_timer_tick > 16) {
       last_timer_tick = next_timer_tick;
-      /* Update board timers */
-      board->timerStep();
+      if (rewinding && rewind) {
+        // Step back one frame per tick while rewind key is held
+        if (rewind->rewind(state))
+          board->loadState(state);
+      } else if (board->isBreak()) {
+        // Stopped in the debugger, only its commands move the machine
+      } else if (Chip8::TimingMode::Vip == board->timingMode()) {
+        // Whole frame of emulated cycles, timers tick inside the board
+        board->runFrame();
+      } else {
+        /* Update board timers */
+        board->timerStep();
+        board->step();
+      }
+      if (runAhead)
+        runAhead->present(*board);
       video->update();
-      board->step();
+      if (rewind && !rewinding && !board->isBreak()) {
+        board->saveState(state);
+        rewind->capture(state);
+      }
     }
 
     if (debugger_enabled) {
       board->setBreak(true);
       debugger_enabled = false;
     }
-    if (board->isBreak()) {
-      std::fprintf(stderr, "Debugger enabled\n");
-      debugger->debugger_loop();
-    }
+    if (gdb)
+      gdb->poll();
+    // Runs console commands, the prompt lives on its own thread. A connected
+    // GDB client owns the stops instead.
+    if (!gdb || !gdb->connected())
+      debugger->poll();
 
     if (!board->shutdown()) {
       // Board should tick at 50 Hz rate
-      if (next_timer_tick - last_board_tick > 20) {
+      if (Chip8::TimingMode::Host == board->timingMode() &&
+          !board->isBreak() && next_timer_tick - last_board_tick > 20) {
         last_board_tick = next_timer_tick;
         board->step();
       }
@@ -127,15 +316,93 @@ int main_loop(const char *file) {
       should_quit = 1;
     }
   }
+  recorder.close(board->frame());
+  if (runAhead)
+    runAhead->report(stderr);
+  video->report(stderr);
+  return 0;
+}
+
+void usage(const char *name) {
+  std::fprintf(stderr,
+               "Usage %s [OPTIONS] [FILE_PATH]\n"
+               "  -c       cycle accurate COSMAC VIP timing\n"
+               "  -s SEED  RNG seed\n"
+               "  -r FILE  record input movie (implies -c)\n"
+               "  -w SECS  keep SECS seconds of rewind history, hold "
+               "Backspace to rewind\n"
+               "  -a N     run N frames ahead to cut input latency (implies "
+               "-c)\n"
+               "  -g PORT  serve the GDB remote protocol on 127.0.0.1:PORT\n"
+               "  -n N     run N machines side by side, seeds SEED and up "
+               "(implies -c)\n"
+               "  -z N     window scale, default 16\n"
+               "  -u MODE  upscale on the CPU, MODE is nearest or scale2x "
+               "followed by\n"
+               "           ,scanlines and ,grid effects\n"
+               "Settings may also be given per ROM in FILE_PATH.cfg:\n"
+               "  timing = vip\n"
+               "  runahead = N\n"
+               "F5/F9 save/load state to FILE_PATH.state\n",
+               name);
 }
 
 } // namespace
 
 int main(int argc, char **argv) {
-  if (argc < 2) {
-    std::fprintf(stderr, "Usage %s [FILE_PATH]\n", argv[0]);
+  Options opts;
+  int opt;
+  while (-1 != (opt = getopt(argc, argv, "cs:r:w:a:g:n:z:u:"))) {
+    switch (opt) {
+    case 'c':
+      opts.timing = Chip8::TimingMode::Vip;
+      break;
+    case 's':
+      opts.seed = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'r':
+      opts.record = optarg;
+      opts.timing = Chip8::TimingMode::Vip;
+      break;
+    case 'w':
+      opts.rewindSeconds = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'a':
+      opts.runAhead = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'g':
+      opts.gdbPort = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'n':
+      opts.instances = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'z':
+      opts.scale = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'u':
+      if (!parseUpscale(optarg, opts)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    usage(argv[0]);
     return 1;
   }
+  opts.file = argv[optind];
+  // Command line wins over per ROM settings
+  auto config = Chip8::LoadRomConfig(opts.file);
+  if ("vip" == config["timing"])
+    opts.timing = Chip8::TimingMode::Vip;
+  if (opts.runAhead < 0 && config.count("runahead"))
+    opts.runAhead = std::strtoul(config["runahead"].c_str(), nullptr, 0);
+  if (opts.runAhead > 0)
+    opts.timing = Chip8::TimingMode::Vip;
   int rv;
   // Initialize SDL
   // TODO: Consider SDL_INIT_NOPARACHUTE
@@ -153,7 +420,10 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  main_loop(argv[1]);
+  if (opts.instances > 0)
+    grid_loop(opts);
+  else
+    main_loop(opts);
   SDL_Quit();
   return 0;
   // Random comment
@@ -1,10 +1,10 @@
 #include <Chip8/Memory.h>
+#include <algorithm>
 
 namespace Chip8 {
 
-void Memory::reset() {
-  std::fill(m_data.begin(), m_data.end(), 0);
-  // Store font data
+namespace {
+std::shared_ptr<Memory::Page> makeFontPage() {
   // TODO: Move to board?
   const std::vector<std::vector<uint8_t>> font_data = {
       /* 0 */ {0xF0, 0x90, 0x90, 0x90, 0xF0},
@@ -24,27 +24,80 @@ void Memory::reset() {
       /* E */ {0xF0, 0x80, 0xF0, 0x80, 0xF0},
       /* F */ {0xF0, 0x80, 0xF0, 0x80, 0x80},
   };
-  for (uint8_t font = 0; font < font_data.size(); ++font) {
-    uint16_t offset;
-    font_ptr(font, offset); // TODO
-    for (const auto &sprite : font_data[font]) {
-      write(offset++, sprite); // TODO
-    }
-  }
+  auto page = std::make_shared<Memory::Page>();
+  page->fill(0);
+  std::size_t offset = 0x050;
+  for (const auto &glyph : font_data)
+    for (const auto &sprite : glyph)
+      (*page)[offset++] = sprite;
+  return page;
 }
 
-ResultType Memory::read(uint16_t offset, uint8_t &data) {
-  if (offset >= m_data.size())
-    return ResultType::OutOfRange;
-  data = m_data.at(offset);
-  return ResultType::Ok;
+// Pristine pages, shared by every instance and never written
+const std::shared_ptr<Memory::Page> &fontPage() {
+  static const std::shared_ptr<Memory::Page> page = makeFontPage();
+  return page;
 }
 
-ResultType Memory::write(uint16_t offset, uint8_t data) {
-  if (offset >= m_data.size())
-    return ResultType::OutOfRange;
-  m_data.at(offset) = data;
-  return ResultType::Ok;
+const std::shared_ptr<Memory::Page> &zeroPage() {
+  static const std::shared_ptr<Memory::Page> page = [] {
+    auto page = std::make_shared<Memory::Page>();
+    page->fill(0);
+    return page;
+  }();
+  return page;
+}
+} // namespace
+
+Memory::Memory() { reset(); }
+
+void Memory::reset() {
+  // Font lives in the first page, see font_ptr()
+  m_pages[0] = fontPage();
+  for (std::size_t page = 1; page < m_pages.size(); ++page)
+    m_pages[page] = zeroPage();
+  m_owned = 0;
+}
+
+Memory::Page &Memory::own(std::uint16_t page) {
+  m_pages[page] = std::make_shared<Page>(*m_pages[page]);
+  m_owned |= 1u << page;
+  return *m_pages[page];
+}
+
+Memory Memory::fork() {
+  Memory copy;
+  copy.m_pages = m_pages;
+  if (m_owned)
+    share();
+  return copy;
+}
+
+std::size_t Memory::ownedPages() const {
+  std::size_t count = 0;
+  for (std::uint16_t owned = m_owned; owned; owned &= owned - 1)
+    count++;
+  return count;
+}
+
+void Memory::saveState(BoardState &state) const {
+  for (std::size_t page = 0; page < m_pages.size(); ++page)
+    std::copy(m_pages[page]->begin(), m_pages[page]->end(),
+              state.memory.begin() + page * PageSize);
+}
+
+void Memory::loadState(const BoardState &state) {
+  for (std::size_t page = 0; page < m_pages.size(); ++page) {
+    auto src = state.memory.begin() + page * PageSize;
+    if (!(m_owned & (1u << page))) {
+      // Keep sharing when the content did not change
+      if (std::equal(src, src + PageSize, m_pages[page]->begin()))
+        continue;
+      m_pages[page] = std::make_shared<Page>();
+      m_owned |= 1u << page;
+    }
+    std::copy(src, src + PageSize, m_pages[page]->begin());
+  }
 }
 
 ResultType Memory::write_bulk(uint16_t offset, const std::vector<uint8_t> &data,
@@ -0,0 +1,184 @@
+#include <Chip8/Movie.h>
+#include <cstring>
+
+namespace Chip8 {
+
+namespace {
+constexpr std::size_t kWriteBufferSize = 64 * 1024;
+
+void putLe(std::uint8_t *out, std::uint64_t value, unsigned bytes) {
+  for (unsigned it = 0; it < bytes; ++it)
+    out[it] = static_cast<std::uint8_t>(value >> (8 * it));
+}
+
+std::uint64_t getLe(const std::uint8_t *in, unsigned bytes) {
+  std::uint64_t value = 0;
+  for (unsigned it = 0; it < bytes; ++it)
+    value |= static_cast<std::uint64_t>(in[it]) << (8 * it);
+  return value;
+}
+
+// Field by field so the file is little endian whatever the host
+void encodeHeader(const MovieHeader &header,
+                  std::uint8_t (&out)[sizeof(MovieHeader)]) {
+  std::memcpy(out, header.magic, 4);
+  putLe(out + 4, header.version, 2);
+  out[6] = header.timing;
+  out[7] = header.quirks;
+  putLe(out + 8, header.seed, 4);
+  putLe(out + 12, header.romHash, 4);
+  putLe(out + 16, header.frames, 8);
+  putLe(out + 24, header.events, 8);
+}
+
+void decodeHeader(const std::uint8_t (&in)[sizeof(MovieHeader)],
+                  MovieHeader &header) {
+  std::memcpy(header.magic, in, 4);
+  header.version = static_cast<std::uint16_t>(getLe(in + 4, 2));
+  header.timing = in[6];
+  header.quirks = in[7];
+  header.seed = static_cast<std::uint32_t>(getLe(in + 8, 4));
+  header.romHash = static_cast<std::uint32_t>(getLe(in + 12, 4));
+  header.frames = getLe(in + 16, 8);
+  header.events = getLe(in + 24, 8);
+}
+
+void writeHeader(std::FILE *file, const MovieHeader &header) {
+  std::uint8_t bytes[sizeof(MovieHeader)];
+  encodeHeader(header, bytes);
+  std::fwrite(bytes, sizeof(bytes), 1, file);
+}
+} // namespace
+
+std::uint32_t romHash(const std::vector<uint8_t> &rom) {
+  std::uint32_t hash = 0x811C9DC5u;
+  for (auto b : rom) {
+    hash ^= b;
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
+
+MovieWriter::~MovieWriter() {
+  if (isOpen())
+    close(m_header.frames);
+}
+
+ResultType MovieWriter::open(const char *path, const Board &board,
+                             const std::vector<uint8_t> &rom) {
+  if (isOpen())
+    return ResultType::Error;
+  if (TimingMode::Vip != board.timingMode())
+    return ResultType::Error;
+  m_file = std::fopen(path, "wb");
+  if (nullptr == m_file)
+    return ResultType::Error;
+  std::memcpy(m_header.magic, "C8MV", 4);
+  m_header.version = MovieVersion;
+  m_header.timing = static_cast<std::uint8_t>(board.timingMode());
+  m_header.quirks = 0;
+  m_header.seed = board.seed();
+  m_header.romHash = romHash(rom);
+  m_header.frames = 0;
+  m_header.events = 0;
+  m_lastCycle = 0;
+  m_buffer.clear();
+  m_buffer.reserve(kWriteBufferSize);
+  // Placeholder, rewritten on close
+  writeHeader(m_file, m_header);
+  return ResultType::Ok;
+}
+
+void MovieWriter::flush() {
+  if (!m_buffer.empty())
+    std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+  m_buffer.clear();
+}
+
+void MovieWriter::record(std::uint64_t cycle, std::uint8_t key, bool down) {
+  if (!isOpen())
+    return;
+  std::uint64_t v = ((cycle - m_lastCycle) << 5) | (down ? 0x10 : 0) |
+                    (key & 0xF);
+  m_lastCycle = cycle;
+  do {
+    std::uint8_t byte = v & 0x7F;
+    v >>= 7;
+    m_buffer.push_back(v ? (byte | 0x80) : byte);
+  } while (v);
+  m_header.events++;
+  if (m_buffer.size() >= kWriteBufferSize - 16)
+    flush();
+}
+
+void MovieWriter::close(std::uint64_t frames) {
+  if (!isOpen())
+    return;
+  flush();
+  m_header.frames = frames;
+  std::fseek(m_file, 0, SEEK_SET);
+  writeHeader(m_file, m_header);
+  std::fclose(m_file);
+  m_file = nullptr;
+}
+
+ResultType MoviePlayer::load(const char *path) {
+  std::FILE *file = std::fopen(path, "rb");
+  if (nullptr == file)
+    return ResultType::Error;
+  std::fseek(file, 0, SEEK_END);
+  long size = std::ftell(file);
+  std::fseek(file, 0, SEEK_SET);
+  std::uint8_t header[sizeof(MovieHeader)];
+  if (size < static_cast<long>(sizeof(header)) ||
+      1 != std::fread(header, sizeof(header), 1, file)) {
+    std::fclose(file);
+    return ResultType::Error;
+  }
+  decodeHeader(header, m_header);
+  m_data.resize(size - sizeof(m_header));
+  std::size_t got = std::fread(m_data.data(), 1, m_data.size(), file);
+  std::fclose(file);
+  if (got != m_data.size() || 0 != std::memcmp(m_header.magic, "C8MV", 4) ||
+      MovieVersion != m_header.version)
+    return ResultType::Error;
+  m_pos = 0;
+  m_played = 0;
+  m_cycle = 0;
+  m_corrupt = false;
+  if (!done() && !next())
+    return ResultType::Error;
+  return ResultType::Ok;
+}
+
+void MoviePlayer::prepare(Board &board) const {
+  board.setTimingMode(static_cast<TimingMode>(m_header.timing));
+  board.setSeed(m_header.seed);
+  board.reset();
+}
+
+bool MoviePlayer::next() {
+  std::uint64_t v = 0;
+  for (unsigned shift = 0; m_pos < m_data.size() && shift < 64; shift += 7) {
+    std::uint8_t byte = m_data[m_pos++];
+    v |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+    if (0 == (byte & 0x80)) {
+      m_cycle += v >> 5;
+      m_event = v & 0x1F;
+      return true;
+    }
+  }
+  // Truncated or overlong varint, stop playback
+  m_played = m_header.events;
+  m_corrupt = true;
+  return false;
+}
+
+void MoviePlayer::inject(Board &board) {
+  board.handleKey(m_event & 0xF, 0 != (m_event & 0x10));
+  m_played++;
+  if (!done())
+    next();
+}
+
+} // namespace Chip8
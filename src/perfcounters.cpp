@@ -0,0 +1,147 @@
+#include "perfcounters.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Chip8 {
+
+#ifdef __linux__
+namespace {
+struct EventConfig {
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+const EventConfig kEvents[PerfCounters::EventCount] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+int openEvent(const EventConfig &event) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+} // namespace
+
+PerfCounters::PerfCounters() {
+  for (int it = 0; it < EventCount; ++it) {
+    m_fds[it] = openEvent(kEvents[it]);
+    if (m_fds[it] < 0 && m_reason.empty())
+      m_reason = std::string(name(static_cast<Event>(it))) + ": " +
+                 std::strerror(errno);
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (auto fd : m_fds)
+    if (fd >= 0)
+      close(fd);
+}
+
+void PerfCounters::start() {
+  for (auto fd : m_fds) {
+    if (fd < 0)
+      continue;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+PerfCounters::Sample PerfCounters::stop() {
+  Sample sample;
+  for (int it = 0; it < EventCount; ++it) {
+    sample.values[it] = 0;
+    sample.valid[it] = false;
+    if (m_fds[it] < 0)
+      continue;
+    ioctl(m_fds[it], PERF_EVENT_IOC_DISABLE, 0);
+    // value, time enabled, time running
+    std::uint64_t data[3];
+    if (sizeof(data) != read(m_fds[it], data, sizeof(data)) || 0 == data[2])
+      continue;
+    sample.values[it] = data[2] < data[1]
+                            ? static_cast<std::uint64_t>(
+                                  static_cast<double>(data[0]) * data[1] /
+                                  data[2])
+                            : data[0];
+    sample.valid[it] = true;
+  }
+  return sample;
+}
+#else
+PerfCounters::PerfCounters() : m_reason("perf_event_open is Linux only") {
+  m_fds.fill(-1);
+}
+
+PerfCounters::~PerfCounters() {}
+
+void PerfCounters::start() {}
+
+PerfCounters::Sample PerfCounters::stop() {
+  Sample sample;
+  sample.values.fill(0);
+  sample.valid.fill(false);
+  return sample;
+}
+#endif
+
+bool PerfCounters::available() const {
+  for (auto fd : m_fds)
+    if (fd >= 0)
+      return true;
+  return false;
+}
+
+const char *PerfCounters::name(Event event) {
+  switch (event) {
+  case Cycles:
+    return "cycles";
+  case Instructions:
+    return "instructions";
+  case BranchMisses:
+    return "branch-misses";
+  case L1dMisses:
+    return "L1d-misses";
+  default:
+    return "?";
+  }
+}
+
+void PrintPerfSample(std::FILE *out, const PerfCounters::Sample &sample,
+                     std::uint64_t instructions, std::uint64_t frames) {
+  std::fprintf(out, "%-14s %16s %12s %12s\n", "counter", "total",
+               "per instr", "per frame");
+  for (int it = 0; it < PerfCounters::EventCount; ++it) {
+    const char *name = PerfCounters::name(static_cast<PerfCounters::Event>(it));
+    if (!sample.valid[it]) {
+      std::fprintf(out, "%-14s %16s\n", name, "n/a");
+      continue;
+    }
+    const double value = static_cast<double>(sample.values[it]);
+    std::fprintf(out, "%-14s %16llu %12.2f %12.0f\n", name,
+                 static_cast<unsigned long long>(sample.values[it]),
+                 instructions ? value / instructions : 0.0,
+                 frames ? value / frames : 0.0);
+  }
+}
+
+} // namespace Chip8
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace Chip8 {
+
+// Hardware counters of the calling thread through Linux perf_event_open(2),
+// user space only. Every event is opened on its own so a partial set still
+// works; in containers or on other systems nothing opens and reason() says
+// why.
+class PerfCounters {
+public:
+  enum Event {
+    Cycles,
+    Instructions,
+    BranchMisses,
+    L1dMisses,
+    EventCount,
+  };
+  struct Sample {
+    std::array<std::uint64_t, EventCount> values;
+    std::array<bool, EventCount> valid;
+  };
+
+private:
+  std::array<int, EventCount> m_fds;
+  std::string m_reason;
+
+public:
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool available() const;
+  const std::string &reason() const { return m_reason; }
+  static const char *name(Event event);
+
+  // Reset and enable all counters
+  void start();
+  // Disable and read, scaled when the kernel multiplexed a counter
+  Sample stop();
+};
+
+// Table of counters, totals and per emulated instruction and per frame
+void PrintPerfSample(std::FILE *out, const PerfCounters::Sample &sample,
+                     std::uint64_t instructions, std::uint64_t frames);
+
+} // namespace Chip8
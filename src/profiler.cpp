@@ -0,0 +1,123 @@
+#include <Chip8/Profiler.h>
+#include <algorithm>
+
+namespace Chip8 {
+
+namespace {
+// Deeper stacks are folded into their parent, recursion would otherwise grow
+// the tree without bound
+constexpr std::size_t kMaxNodes = 1u << 16;
+} // namespace
+
+Profiler::Profiler() { reset(); }
+
+void Profiler::reset() {
+  m_pc.fill(Counter());
+  m_class.fill(Counter());
+  m_draw = Counter();
+  m_keyWait = Counter();
+  m_cycles = 0;
+  m_nodes.clear();
+  m_nodes.push_back({0, 0, 0, {}});
+  m_node = 0;
+  m_folded = 0;
+}
+
+void Profiler::enter(std::uint16_t entry) {
+  for (auto child : m_nodes[m_node].children) {
+    if (entry == m_nodes[child].entry) {
+      m_node = child;
+      return;
+    }
+  }
+  if (m_nodes.size() >= kMaxNodes) {
+    m_folded++;
+    return;
+  }
+  const auto child = static_cast<std::uint32_t>(m_nodes.size());
+  m_nodes.push_back({entry, m_node, 0, {}});
+  m_nodes[m_node].children.push_back(child);
+  m_node = child;
+}
+
+void Profiler::leave() {
+  if (m_folded)
+    m_folded--;
+  else
+    m_node = m_nodes[m_node].parent;
+}
+
+std::vector<Profiler::HotSpot> Profiler::hot(std::size_t count) const {
+  std::vector<HotSpot> spots;
+  for (std::uint16_t pc = 0; pc < m_pc.size(); ++pc)
+    if (m_pc[pc].count)
+      spots.push_back({pc, m_pc[pc]});
+  count = std::min(count, spots.size());
+  std::partial_sort(spots.begin(), spots.begin() + count, spots.end(),
+                    [](const HotSpot &a, const HotSpot &b) {
+                      return a.counter.cycles > b.counter.cycles;
+                    });
+  spots.resize(count);
+  return spots;
+}
+
+const char *Profiler::className(std::uint8_t nibble) {
+  static const char *kNames[16] = {
+      "0NNN CLS/RET", "1NNN JP",   "2NNN CALL", "3XNN SE",
+      "4XNN SNE",     "5XY0 SE",   "6XNN LD",   "7XNN ADD",
+      "8XYN ALU",     "9XY0 SNE",  "ANNN LD I", "BNNN JP V0",
+      "CXNN RND",     "DXYN DRW",  "EXNN SKP",  "FXNN misc",
+  };
+  return kNames[nibble & 0xF];
+}
+
+void Profiler::report(std::FILE *out) const {
+  const double total = m_cycles ? static_cast<double>(m_cycles) : 1.0;
+  std::fprintf(out, "%-14s %12s %14s %7s\n", "class", "count", "cycles",
+               "share");
+  for (std::uint8_t nibble = 0; nibble < m_class.size(); ++nibble) {
+    const Counter &counter = m_class[nibble];
+    if (!counter.count)
+      continue;
+    std::fprintf(out, "%-14s %12llu %14llu %6.2f%%\n", className(nibble),
+                 static_cast<unsigned long long>(counter.count),
+                 static_cast<unsigned long long>(counter.cycles),
+                 100.0 * counter.cycles / total);
+  }
+  std::fprintf(out, "%-14s %12llu %14llu %6.2f%%\n", "key wait",
+               static_cast<unsigned long long>(m_keyWait.count),
+               static_cast<unsigned long long>(m_keyWait.cycles),
+               100.0 * m_keyWait.cycles / total);
+  std::fprintf(out, "total cycles %llu, DXYN incl. vblank wait %.2f%%\n",
+               static_cast<unsigned long long>(m_cycles),
+               100.0 * m_draw.cycles / total);
+}
+
+void Profiler::writeStack(std::FILE *out, std::uint32_t node) const {
+  if (0 == node) {
+    std::fprintf(out, "main");
+    return;
+  }
+  writeStack(out, m_nodes[node].parent);
+  std::fprintf(out, ";sub_%.3X", m_nodes[node].entry);
+}
+
+void Profiler::writeCollapsed(std::FILE *out) const {
+  for (std::uint32_t node = 0; node < m_nodes.size(); ++node) {
+    if (!m_nodes[node].cycles)
+      continue;
+    writeStack(out, node);
+    std::fprintf(out, " %llu\n",
+                 static_cast<unsigned long long>(m_nodes[node].cycles));
+  }
+}
+
+ResultType Profiler::writeCollapsed(const char *path) const {
+  std::FILE *out = std::fopen(path, "w");
+  if (!out)
+    return ResultType::Error;
+  writeCollapsed(out);
+  return 0 == std::fclose(out) ? ResultType::Ok : ResultType::Error;
+}
+
+} // namespace Chip8
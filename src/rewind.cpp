@@ -0,0 +1,170 @@
+#include <Chip8/Rewind.h>
+#include <algorithm>
+#include <cstring>
+
+namespace Chip8 {
+
+namespace {
+// Zero gaps shorter than this are kept inside a literal run, a new run
+// header would cost more than the bytes it skips.
+constexpr std::size_t kMinZeroRun = 3;
+
+void putVarint(std::vector<std::uint8_t> &out, std::size_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<std::uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(v));
+}
+
+bool getVarint(const std::vector<std::uint8_t> &in, std::size_t &pos,
+               std::size_t &v) {
+  v = 0;
+  for (unsigned shift = 0; pos < in.size() && shift < 64; shift += 7) {
+    std::uint8_t byte = in[pos++];
+    v |= static_cast<std::size_t>(byte & 0x7F) << shift;
+    if (0 == (byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+const std::uint8_t *bytesOf(const BoardState &state) {
+  return reinterpret_cast<const std::uint8_t *>(&state);
+}
+
+std::uint8_t *bytesOf(BoardState &state) {
+  return reinterpret_cast<std::uint8_t *>(&state);
+}
+} // namespace
+
+RewindBuffer::RewindBuffer(std::size_t frames, std::size_t keyframeInterval)
+    : m_entries(std::max<std::size_t>(frames, 2)),
+      m_keyframeInterval(
+          std::max<std::size_t>(1, std::min(keyframeInterval, frames / 2))) {}
+
+void RewindBuffer::clear() {
+  m_tail = 0;
+  m_count = 0;
+  m_hasKeyframe = false;
+}
+
+std::size_t RewindBuffer::bytes() const {
+  std::size_t total = 0;
+  for (std::size_t it = 0; it < m_count; ++it)
+    total += m_entries[index(it)].data.size();
+  return total;
+}
+
+void RewindBuffer::evictOldest() {
+  // Deltas are useless without their keyframe, drop them together
+  do {
+    if (m_tail == m_keyIndex)
+      m_hasKeyframe = false;
+    m_tail = (m_tail + 1) % m_entries.size();
+    m_count--;
+  } while (m_count && !m_entries[m_tail].keyframe);
+}
+
+void RewindBuffer::capture(const BoardState &state) {
+  if (m_count == m_entries.size())
+    evictOldest();
+  const std::size_t slot = index(m_count);
+  Entry &entry = m_entries[slot];
+  if (!m_hasKeyframe || m_sinceKeyframe >= m_keyframeInterval) {
+    entry.keyframe = true;
+    encode(bytesOf(state), nullptr, sizeof(state), entry.data);
+    m_keyframe = state;
+    m_hasKeyframe = true;
+    m_keyIndex = slot;
+    m_sinceKeyframe = 1;
+  } else {
+    entry.keyframe = false;
+    encode(bytesOf(state), bytesOf(m_keyframe), sizeof(state), entry.data);
+    m_sinceKeyframe++;
+  }
+  m_count++;
+}
+
+bool RewindBuffer::rewind(BoardState &state) {
+  if (0 == m_count)
+    return false;
+  const std::size_t newest = m_count - 1;
+  std::size_t key = newest;
+  while (!m_entries[index(key)].keyframe) {
+    if (0 == key)
+      return false;
+    key--;
+  }
+  std::memset(bytesOf(m_keyframe), 0, sizeof(m_keyframe));
+  if (!decode(m_entries[index(key)].data, bytesOf(m_keyframe),
+              sizeof(m_keyframe)))
+    return false;
+  state = m_keyframe;
+  if (key != newest &&
+      !decode(m_entries[index(newest)].data, bytesOf(state), sizeof(state)))
+    return false;
+
+  m_count--;
+  if (key == newest) {
+    // Next capture starts a new keyframe
+    m_hasKeyframe = false;
+  } else {
+    m_hasKeyframe = true;
+    m_keyIndex = index(key);
+    m_sinceKeyframe = m_count - key;
+  }
+  return true;
+}
+
+void RewindBuffer::encode(const std::uint8_t *data, const std::uint8_t *ref,
+                          std::size_t size, std::vector<std::uint8_t> &out) {
+  out.clear();
+  auto at = [&](std::size_t i) -> std::uint8_t {
+    return ref ? data[i] ^ ref[i] : data[i];
+  };
+  std::size_t pos = 0;
+  while (pos < size) {
+    std::size_t zeros = pos;
+    while (zeros < size && 0 == at(zeros))
+      zeros++;
+    if (zeros == size)
+      break;
+    std::size_t end = zeros;
+    std::size_t gap = 0;
+    while (end + gap < size && gap < kMinZeroRun) {
+      if (0 == at(end + gap)) {
+        gap++;
+      } else {
+        end += gap + 1;
+        gap = 0;
+      }
+    }
+    putVarint(out, zeros - pos);
+    putVarint(out, end - zeros);
+    for (std::size_t it = zeros; it < end; ++it)
+      out.push_back(at(it));
+    pos = end;
+  }
+}
+
+bool RewindBuffer::decode(const std::vector<std::uint8_t> &in,
+                          std::uint8_t *data, std::size_t size) {
+  std::size_t pos = 0;
+  std::size_t offset = 0;
+  while (pos < in.size()) {
+    std::size_t zeros, literal;
+    if (!getVarint(in, pos, zeros) || !getVarint(in, pos, literal))
+      return false;
+    offset += zeros;
+    if (offset + literal > size || pos + literal > in.size())
+      return false;
+    for (std::size_t it = 0; it < literal; ++it)
+      data[offset + it] ^= in[pos + it];
+    pos += literal;
+    offset += literal;
+  }
+  return true;
+}
+
+} // namespace Chip8
@@ -0,0 +1,32 @@
+#include "romconfig.h"
+#include <fstream>
+
+namespace Chip8 {
+
+namespace {
+std::string trim(const std::string &str) {
+  const char *ws = " \t\r\n";
+  auto begin = str.find_first_not_of(ws);
+  if (std::string::npos == begin)
+    return {};
+  return str.substr(begin, str.find_last_not_of(ws) - begin + 1);
+}
+} // namespace
+
+std::map<std::string, std::string> LoadRomConfig(const char *romPath) {
+  std::map<std::string, std::string> config;
+  std::ifstream f{std::string(romPath) + ".cfg"};
+  std::string line;
+  while (std::getline(f, line)) {
+    line = line.substr(0, line.find('#'));
+    auto eq = line.find('=');
+    if (std::string::npos == eq)
+      continue;
+    auto key = trim(line.substr(0, eq));
+    if (!key.empty())
+      config[key] = trim(line.substr(eq + 1));
+  }
+  return config;
+}
+
+} // namespace Chip8
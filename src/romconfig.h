@@ -0,0 +1,12 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace Chip8 {
+
+// Per ROM settings from FILE_PATH.cfg. Lines are "key = value", text after
+// '#' is a comment. Missing file gives empty config.
+std::map<std::string, std::string> LoadRomConfig(const char *romPath);
+
+} // namespace Chip8
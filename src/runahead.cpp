@@ -0,0 +1,84 @@
+#include <Chip8/RunAhead.h>
+#include <chrono>
+
+namespace Chip8 {
+
+namespace {
+// A press with no visible reaction within a second is given up on
+constexpr std::int64_t kProbeFrames = 60;
+} // namespace
+
+RunAhead::RunAhead(std::shared_ptr<Video> video, unsigned frames)
+    : m_ahead(std::make_shared<Board>(video, std::make_shared<Audio>())),
+      m_frames(frames) {
+  m_ahead->setTimingMode(TimingMode::Vip);
+  m_lastReal.fill(0);
+  m_lastShown.fill(0);
+}
+
+void RunAhead::present(const Board &board) {
+  auto start = std::chrono::steady_clock::now();
+  board.saveState(m_state);
+  m_ahead->setTimingMode(board.timingMode());
+  m_ahead->setBreak(false);
+  m_ahead->loadState(m_state);
+  for (unsigned it = 0; it < m_frames && !m_ahead->isBreak(); ++it)
+    m_ahead->runFrame();
+  auto end = std::chrono::steady_clock::now();
+  m_seconds += std::chrono::duration<double>(end - start).count();
+  m_presented++;
+
+  m_ahead->saveState(m_shown);
+  // The first presented frame has nothing to compare against
+  if (m_armed && m_presented > 1) {
+    const std::int64_t elapsed = m_presented - m_pressed;
+    if (m_realLatency < 0 && m_state.screen != m_lastReal)
+      m_realLatency = elapsed;
+    if (m_shownLatency < 0 && m_shown.screen != m_lastShown)
+      m_shownLatency = elapsed;
+    if (m_realLatency >= 0 && m_shownLatency >= 0) {
+      m_samples++;
+      m_realTotal += m_realLatency;
+      m_shownTotal += m_shownLatency;
+      m_armed = false;
+    } else if (elapsed >= kProbeFrames) {
+      m_unanswered++;
+      m_armed = false;
+    }
+  }
+  m_lastReal = m_state.screen;
+  m_lastShown = m_shown.screen;
+}
+
+void RunAhead::keyPressed() {
+  // Every press starts a new probe, one still waiting never showed a change
+  if (m_armed)
+    m_unanswered++;
+  m_armed = true;
+  m_pressed = m_presented;
+  m_realLatency = -1;
+  m_shownLatency = -1;
+}
+
+void RunAhead::report(std::FILE *out) const {
+  std::fprintf(out, "run-ahead: %u frames, %.1f us per presented frame\n",
+               m_frames,
+               m_presented ? m_seconds * 1e6 / m_presented : 0.0);
+  if (m_unanswered)
+    std::fprintf(out,
+                 "run-ahead: %llu key presses without a visible reaction\n",
+                 static_cast<unsigned long long>(m_unanswered));
+  if (0 == m_samples) {
+    std::fprintf(out, "run-ahead: no key press changed the picture\n");
+    return;
+  }
+  const double real = static_cast<double>(m_realTotal) / m_samples;
+  const double shown = static_cast<double>(m_shownTotal) / m_samples;
+  std::fprintf(out,
+               "run-ahead: %llu key presses, first visible reaction after "
+               "%.2f frames without run-ahead, %.2f with (%.1f ms saved)\n",
+               static_cast<unsigned long long>(m_samples), real, shown,
+               (real - shown) * 1000.0 / 60.0);
+}
+
+} // namespace Chip8
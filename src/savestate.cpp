@@ -0,0 +1,85 @@
+#include <Chip8/SaveState.h>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Chip8 {
+
+namespace {
+std::uint32_t checksum(const BoardState &state) {
+  const auto *data = reinterpret_cast<const std::uint8_t *>(&state);
+  std::uint32_t hash = 0x811C9DC5u;
+  for (std::size_t it = 0; it < sizeof(state); ++it) {
+    hash ^= data[it];
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
+} // namespace
+
+ResultType saveStateFile(const char *path, const Board &board) {
+  struct {
+    SaveStateHeader header;
+    BoardState state;
+  } file;
+  std::memset(&file.header, 0, sizeof(file.header));
+  board.saveState(file.state);
+  std::memcpy(file.header.magic, "C8SS", 4);
+  file.header.version = SaveStateVersion;
+  file.header.headerSize = sizeof(SaveStateHeader);
+  file.header.stateSize = sizeof(BoardState);
+  file.header.byteOrder = SaveStateByteOrder;
+  file.header.checksum = checksum(file.state);
+  file.header.timing = static_cast<std::uint8_t>(board.timingMode());
+
+  const std::string tmp = std::string(path) + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return ResultType::Error;
+  const bool ok = sizeof(file) == ::write(fd, &file, sizeof(file));
+  ::close(fd);
+  if (!ok || 0 != std::rename(tmp.c_str(), path)) {
+    ::unlink(tmp.c_str());
+    return ResultType::Error;
+  }
+  return ResultType::Ok;
+}
+
+ResultType loadStateFile(const char *path, Board &board) {
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return ResultType::Error;
+  struct stat st;
+  const std::size_t size = sizeof(SaveStateHeader) + sizeof(BoardState);
+  if (0 != ::fstat(fd, &st) || static_cast<std::size_t>(st.st_size) < size) {
+    ::close(fd);
+    return ResultType::Error;
+  }
+  void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (MAP_FAILED == map)
+    return ResultType::Error;
+
+  const auto *header = static_cast<const SaveStateHeader *>(map);
+  const auto *state = reinterpret_cast<const BoardState *>(
+      static_cast<const std::uint8_t *>(map) + sizeof(SaveStateHeader));
+  ResultType rv = ResultType::Error;
+  if (0 == std::memcmp(header->magic, "C8SS", 4) &&
+      SaveStateVersion == header->version &&
+      sizeof(SaveStateHeader) == header->headerSize &&
+      sizeof(BoardState) == header->stateSize &&
+      SaveStateByteOrder == header->byteOrder &&
+      checksum(*state) == header->checksum) {
+    board.setTimingMode(static_cast<TimingMode>(header->timing));
+    board.loadState(*state);
+    rv = ResultType::Ok;
+  }
+  ::munmap(map, size);
+  return rv;
+}
+
+} // namespace Chip8
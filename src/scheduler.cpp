@@ -0,0 +1,89 @@
+#include <Chip8/Scheduler.h>
+
+namespace Chip8 {
+
+void Task::FinalAwaiter::await_suspend(Handle handle) noexcept {
+  // Destroyed by the scheduler once the resume that got here returned
+  handle.promise().scheduler->finish(handle);
+}
+
+Scheduler::~Scheduler() {
+  // Parked tasks never finish on their own
+  for (Task::Handle handle : m_tasks)
+    handle.destroy();
+}
+
+void Scheduler::spawn(Task task) {
+  Task::Handle handle = task.m_handle;
+  task.m_handle = nullptr;
+  handle.promise().scheduler = this;
+  handle.promise().index = m_tasks.size();
+  m_tasks.push_back(handle);
+  m_nextFrame.push_back(handle);
+}
+
+void Scheduler::Sleep::await_suspend(std::coroutine_handle<> handle) {
+  if (1 == frames)
+    scheduler.m_nextFrame.push_back(handle);
+  else
+    scheduler.m_sleeping[scheduler.m_frame + frames].push_back(handle);
+}
+
+void Scheduler::reap() {
+  for (Task::Handle handle : m_finished) {
+    // Swap with the last task, O(1) removal
+    const std::size_t index = handle.promise().index;
+    m_tasks[index] = m_tasks.back();
+    m_tasks[index].promise().index = index;
+    m_tasks.pop_back();
+    handle.destroy();
+  }
+  m_finished.clear();
+}
+
+void Scheduler::tick() {
+  m_frame++;
+  m_ready.insert(m_ready.end(), m_nextFrame.begin(), m_nextFrame.end());
+  m_nextFrame.clear();
+  auto due = m_sleeping.find(m_frame);
+  if (m_sleeping.end() != due) {
+    m_ready.insert(m_ready.end(), due->second.begin(), due->second.end());
+    m_sleeping.erase(due);
+  }
+  while (!m_ready.empty()) {
+    // Wakes from inside run in the same tick, after the current batch
+    m_running.swap(m_ready);
+    for (std::coroutine_handle<> handle : m_running)
+      handle.resume();
+    m_resumes += m_running.size();
+    m_running.clear();
+    reap();
+  }
+}
+
+std::uint64_t Scheduler::run(std::uint64_t maxFrames) {
+  const std::uint64_t first = m_frame;
+  while (!m_tasks.empty() && m_frame - first < maxFrames &&
+         !(m_ready.empty() && m_nextFrame.empty() && m_sleeping.empty()))
+    tick();
+  return m_frame - first;
+}
+
+void Signal::notify() {
+  for (std::coroutine_handle<> handle : m_waiters)
+    m_scheduler.wake(handle);
+  m_waiters.clear();
+}
+
+Task runBoard(Scheduler &scheduler, Board &board, Signal &input,
+              std::uint64_t frames) {
+  for (std::uint64_t frame = 0;
+       frame < frames && !board.isBreak() && !board.shutdown(); ++frame) {
+    while (board.isIdleKeyWait())
+      co_await input;
+    board.runFrame();
+    co_await scheduler.frames(1);
+  }
+}
+
+} // namespace Chip8
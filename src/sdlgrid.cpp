@@ -0,0 +1,76 @@
+#include "sdlgrid.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace Chip8 {
+
+namespace {
+// Largest window the grid scales up to
+constexpr unsigned kMaxWindowWidth = 1600;
+constexpr unsigned kMaxWindowHeight = 900;
+constexpr unsigned kMaxScale = 16;
+} // namespace
+
+SDLGrid::SDLGrid(std::size_t count, unsigned columns)
+    : m_atlas(count, columns) {
+  // Scales down as well when the atlas outgrows the screen
+  const double scale = std::min<double>(
+      kMaxScale, std::min(double(kMaxWindowWidth) / m_atlas.width(),
+                          double(kMaxWindowHeight) / m_atlas.height()));
+  window = SDL_CreateWindow(
+      "Chip8 emulator", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+      std::max(1, static_cast<int>(m_atlas.width() * scale)),
+      std::max(1, static_cast<int>(m_atlas.height() * scale)),
+      SDL_WINDOW_HIDDEN);
+  if (!window) {
+    std::fprintf(stderr, "Cannot create SDL video: %s\n", SDL_GetError());
+    exit(1);
+  }
+  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+  if (!renderer) {
+    std::fprintf(stderr, "Cannot create SDL renderer: %s\n", SDL_GetError());
+    exit(1);
+  }
+  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                              SDL_TEXTUREACCESS_STREAMING, m_atlas.width(),
+                              m_atlas.height());
+  if (!texture) {
+    std::fprintf(stderr, "Cannot create SDL texture: %s\n", SDL_GetError());
+    exit(1);
+  }
+  // Atlas starts black, upload it whole once
+  SDL_UpdateTexture(texture, NULL, m_atlas.pixels(), m_atlas.pitch());
+}
+
+SDLGrid::~SDLGrid() {
+  SDL_DestroyTexture(texture);
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+}
+
+void SDLGrid::update(const std::vector<std::shared_ptr<Video>> &videos) {
+  const std::size_t count = std::min(videos.size(), m_atlas.count());
+  for (std::size_t index = 0; index < count; ++index) {
+    videos[index]->updateLeds();
+    m_atlas.update(index, *videos[index]);
+  }
+  if (m_atlas.dirty()) {
+    // Band of tile rows holding every changed tile, untouched tiles inside
+    // it are re-sent unchanged from the atlas
+    const SDL_Rect band = {0, static_cast<int>(m_atlas.dirtyTop()),
+                           static_cast<int>(m_atlas.width()),
+                           static_cast<int>(m_atlas.dirtyHeight())};
+    SDL_UpdateTexture(texture, &band,
+                      m_atlas.pixels() +
+                          static_cast<std::size_t>(band.y) * m_atlas.width(),
+                      m_atlas.pitch());
+    m_atlas.clearDirty();
+  }
+  SDL_RenderCopy(renderer, texture, NULL, NULL);
+  SDL_RenderPresent(renderer);
+}
+
+void SDLGrid::show() { SDL_ShowWindow(window); }
+
+} // namespace Chip8
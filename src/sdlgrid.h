@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Chip8/Video.h>
+#include <Chip8/VideoAtlas.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_render.h>
+#include <memory>
+#include <vector>
+
+namespace Chip8 {
+
+// One window showing many machines side by side. Every machine draws into
+// a tile of a single streaming texture, so a frame costs one upload of the
+// changed band and one SDL_RenderCopy whatever the machine count.
+class SDLGrid {
+  SDL_Window *window = nullptr;
+  SDL_Renderer *renderer = nullptr;
+  SDL_Texture *texture = nullptr;
+  VideoAtlas m_atlas;
+
+public:
+  explicit SDLGrid(std::size_t count, unsigned columns = 0);
+  ~SDLGrid();
+  SDLGrid(const SDLGrid &) = delete;
+  SDLGrid &operator=(const SDLGrid &) = delete;
+
+  // Fades and draws videos[i] into tile i
+  void update(const std::vector<std::shared_ptr<Video>> &videos);
+  void show();
+  const VideoAtlas &atlas() const { return m_atlas; }
+};
+
+} // namespace Chip8
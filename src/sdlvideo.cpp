@@ -1,15 +1,14 @@
 #include "sdlvideo.h"
+#include <chrono>
 #include <cstdio>
 #include <unistd.h>
 
 namespace Chip8 {
 
-constexpr int VIDEO_SCALE = 16;
-
-SDLVideo::SDLVideo() {
+SDLVideo::SDLVideo(unsigned scale) : m_scale(scale ? scale : 1) {
   window = SDL_CreateWindow("Chip8 emulator", SDL_WINDOWPOS_CENTERED,
-                            SDL_WINDOWPOS_CENTERED, 64 * VIDEO_SCALE,
-                            32 * VIDEO_SCALE, SDL_WINDOW_HIDDEN);
+                            SDL_WINDOWPOS_CENTERED, 64 * m_scale,
+                            32 * m_scale, SDL_WINDOW_HIDDEN);
   if (!window) {
     std::fprintf(stderr, "Cannot create SDL video: %s\n", SDL_GetError());
     exit(1);
@@ -33,24 +32,41 @@ SDLVideo::SDLVideo() {
 
 SDLVideo::~SDLVideo() {}
 
+void SDLVideo::setUpscaler(UpscaleFilter filter, unsigned effects) {
+  m_upscaler.reset(new Upscaler(m_scale, filter, effects));
+  SDL_DestroyTexture(texture);
+  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                              SDL_TEXTUREACCESS_STREAMING,
+                              m_upscaler->width(), m_upscaler->height());
+  if (!texture) {
+    std::fprintf(stderr, "Cannot create SDL texture: %s\n", SDL_GetError());
+    exit(1);
+  }
+}
+
 void SDLVideo::update() {
-  for (uint8_t y = 0; y < m_screen.size(); ++y) {
-    for (uint8_t x = 0; x < m_screen[y].size(); ++x) {
-      auto &val = m_ledBuffer[y][x];
-      constexpr uint8_t showDiffVal = 0x55;
-      constexpr uint8_t hideDiffVal = 0x15;
-      if (m_screen[y][x]) {
-        if (val < 0xFF - showDiffVal)
-          val += showDiffVal;
-        else
-          val = 0xFF;
-      } else {
-        if (val > hideDiffVal)
-          val -= hideDiffVal;
-        else
-          val = 0;
-      }
+  updateLeds();
+
+  if (m_upscaler) {
+    void *pixels;
+    int pitch;
+    if (0 == SDL_LockTexture(texture, NULL, &pixels, &pitch)) {
+      const auto start = std::chrono::steady_clock::now();
+      m_upscaler->run(m_ledBuffer, static_cast<std::uint32_t *>(pixels),
+                      pitch);
+      const std::uint64_t nanos =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count();
+      SDL_UnlockTexture(texture);
+      m_upscaleFrames++;
+      m_upscaleNanos += nanos;
+      if (nanos > m_upscaleMaxNanos)
+        m_upscaleMaxNanos = nanos;
     }
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+    SDL_RenderPresent(renderer);
+    return;
   }
 
   SDL_SetRenderTarget(renderer, texture);
@@ -72,4 +88,15 @@ void SDLVideo::update() {
 }
 
 void SDLVideo::show() { SDL_ShowWindow(window); }
+
+void SDLVideo::report(std::FILE *out) const {
+  if (!m_upscaler || 0 == m_upscaleFrames)
+    return;
+  std::fprintf(out, "Upscale %ux%u %s: %llu frames, %.3f ms avg, %.3f ms max\n",
+               m_upscaler->width(), m_upscaler->height(),
+               simdName(m_upscaler->simd()),
+               static_cast<unsigned long long>(m_upscaleFrames),
+               m_upscaleNanos / 1e6 / m_upscaleFrames,
+               m_upscaleMaxNanos / 1e6);
+}
 }
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <Chip8/Upscaler.h>
 #include <Chip8/Video.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_render.h>
 #include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
 
 namespace Chip8 {
 
@@ -11,15 +15,25 @@ class SDLVideo : public Chip8::Video {
   SDL_Window *window = nullptr;
   SDL_Renderer *renderer = nullptr;
   SDL_Texture *texture = nullptr;
+  unsigned m_scale;
+  // Software post-processing, the renderer scales the 64x32 texture without
+  std::unique_ptr<Upscaler> m_upscaler;
+  std::uint64_t m_upscaleFrames = 0;
+  std::uint64_t m_upscaleNanos = 0;
+  std::uint64_t m_upscaleMaxNanos = 0;
 
 public:
-  SDLVideo();
+  explicit SDLVideo(unsigned scale = 16);
   ~SDLVideo();
   SDLVideo(const SDLVideo &) = delete;
   SDLVideo &operator=(const SDLVideo &) = delete;
 
+  // Upscales on the CPU straight into a window sized streaming texture
+  void setUpscaler(UpscaleFilter filter, unsigned effects);
   void update();
   void show();
+  // Per frame upscale timings
+  void report(std::FILE *out) const;
 };
 
 } // namespace Chip8
@@ -0,0 +1,207 @@
+#include <Chip8/Board.h>
+#include <Chip8/SharedEnv.h>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+namespace Chip8 {
+
+namespace {
+
+// Polls before sleeping, a few microseconds of a busy agent's think time.
+// Pointless with a single CPU, the other side cannot run meanwhile.
+unsigned spinCount() {
+  static const unsigned count =
+      std::thread::hardware_concurrency() > 1 ? 512 : 0;
+  return count;
+}
+
+void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+// Shared (not FUTEX_PRIVATE) so waits pair up across processes
+void futexWait(std::atomic<std::uint32_t> &word, std::uint32_t value) {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT,
+          value, nullptr, nullptr, 0);
+}
+
+void futexWake(std::atomic<std::uint32_t> &word) {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE,
+          INT_MAX, nullptr, nullptr, 0);
+}
+
+void waitChange(std::atomic<std::uint32_t> &word, std::uint32_t seen,
+                std::atomic<std::uint32_t> &sleepers) {
+  for (unsigned spin = spinCount(); spin > 0; --spin) {
+    if (word.load(std::memory_order_acquire) != seen)
+      return;
+    cpuRelax();
+  }
+  // Counted before the last check, the publisher bumps the word before it
+  // reads sleepers, so one of the two sees the other
+  sleepers.fetch_add(1);
+  while (word.load() == seen)
+    futexWait(word, seen);
+  sleepers.fetch_sub(1);
+}
+
+void bump(std::atomic<std::uint32_t> &word,
+          std::atomic<std::uint32_t> &sleepers) {
+  word.fetch_add(1);
+  if (sleepers.load())
+    futexWake(word);
+}
+
+} // namespace
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == 4,
+              "handoff words must be plain 32 bit words for futex");
+
+void SharedSlot::publishFrame() { bump(frameSeq, sleepers); }
+
+bool SharedSlot::waitAction(std::uint32_t seen) {
+  waitChange(actionSeq, seen, sleepers);
+  return Quit != control;
+}
+
+void SharedSlot::waitFrame(std::uint32_t seen) {
+  waitChange(frameSeq, seen, sleepers);
+}
+
+void SharedSlot::act(std::uint16_t keysDown, Control what) {
+  keys = keysDown;
+  control = what;
+  bump(actionSeq, sleepers);
+}
+
+SharedRegion::~SharedRegion() { close(); }
+
+std::size_t SharedRegion::slotOffset() {
+  return (sizeof(SharedHeader) + alignof(SharedSlot) - 1) /
+         alignof(SharedSlot) * alignof(SharedSlot);
+}
+
+ResultType SharedRegion::create(const char *name, std::uint32_t slots) {
+  if (isOpen() || 0 == slots)
+    return ResultType::Error;
+  shm_unlink(name);
+  const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+    return ResultType::Error;
+  const std::size_t size = slotOffset() + slots * sizeof(SharedSlot);
+  void *base = MAP_FAILED;
+  if (0 == ftruncate(fd, size))
+    base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (MAP_FAILED == base) {
+    shm_unlink(name);
+    return ResultType::Error;
+  }
+  m_base = base;
+  m_size = size;
+  m_name = name;
+  m_owner = true;
+  // Fresh pages are zero, which is a valid state for every slot
+  for (std::uint32_t it = 0; it < slots; ++it)
+    new (&slot(it)) SharedSlot();
+  auto header = static_cast<SharedHeader *>(m_base);
+  header->version = SharedVersion;
+  header->reserved = 0;
+  header->slotSize = sizeof(SharedSlot);
+  header->slots = slots;
+  // Magic last, agents polling for the region see it complete
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, "C8SM", 4);
+  return ResultType::Ok;
+}
+
+ResultType SharedRegion::open(const char *name) {
+  if (isOpen())
+    return ResultType::Error;
+  const int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0)
+    return ResultType::Error;
+  const off_t size = lseek(fd, 0, SEEK_END);
+  void *base = MAP_FAILED;
+  if (size >= static_cast<off_t>(sizeof(SharedHeader)))
+    base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (MAP_FAILED == base)
+    return ResultType::Error;
+  m_base = base;
+  m_size = size;
+  m_name = name;
+  m_owner = false;
+  const auto header = static_cast<const SharedHeader *>(m_base);
+  if (0 != std::memcmp(header->magic, "C8SM", 4) ||
+      SharedVersion != header->version ||
+      sizeof(SharedSlot) != header->slotSize ||
+      m_size < slotOffset() + header->slots * sizeof(SharedSlot)) {
+    close();
+    return ResultType::Error;
+  }
+  return ResultType::Ok;
+}
+
+void SharedRegion::close() {
+  if (!isOpen())
+    return;
+  munmap(m_base, m_size);
+  if (m_owner)
+    shm_unlink(m_name.c_str());
+  m_base = nullptr;
+  m_size = 0;
+  m_owner = false;
+}
+
+std::uint32_t SharedRegion::slots() const {
+  return isOpen() ? static_cast<const SharedHeader *>(m_base)->slots : 0;
+}
+
+SharedSlot &SharedRegion::slot(std::uint32_t index) {
+  return reinterpret_cast<SharedSlot *>(static_cast<char *>(m_base) +
+                                        slotOffset())[index];
+}
+
+void SharedRegion::serve(Board &board, std::uint32_t index,
+                         const std::vector<std::uint8_t> &rom) {
+  SharedSlot &slot = this->slot(index);
+  std::uint16_t keys = 0;
+  std::uint32_t seen = slot.actionSeq.load();
+  while (true) {
+    board.saveState(slot.state);
+    slot.status = board.shutdown()  ? SharedSlot::Shutdown
+                  : board.isBreak() ? SharedSlot::Break
+                                    : SharedSlot::Running;
+    slot.publishFrame();
+    if (!slot.waitAction(seen))
+      return;
+    seen = slot.actionSeq.load();
+    if (SharedSlot::Reset == slot.control) {
+      board.reset();
+      board.LoadBinary(rom);
+      keys = 0;
+    }
+    for (std::uint8_t key = 0; key < 16; ++key) {
+      const bool down = 0 != (slot.keys & (1u << key));
+      if (down != (0 != (keys & (1u << key))))
+        board.handleKey(key, down);
+    }
+    keys = slot.keys;
+    const unsigned frames = slot.framesPerAction ? slot.framesPerAction : 1;
+    for (unsigned it = 0;
+         it < frames && !board.isBreak() && !board.shutdown(); ++it)
+      board.runFrame();
+  }
+}
+
+} // namespace Chip8
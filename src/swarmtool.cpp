@@ -0,0 +1,113 @@
+#include <Chip8/Audio.h>
+#include <Chip8/Board.h>
+#include <Chip8/Scheduler.h>
+#include <Chip8/Video.h>
+
+#include "fileutil.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+// Runs many copies of one ROM as coroutines on a single thread, machines
+// waiting for a key park until the scripted input presses one.
+
+namespace {
+
+void usage(const char *name) {
+  std::fprintf(stderr,
+               "Usage %s [-n INSTANCES] [-f FRAMES] [-i INTERVAL] FILE\n"
+               "  -n  machines to run, default 10000\n"
+               "  -f  frames each machine runs, default 600\n"
+               "  -i  frames between key presses, 0 never, default 30\n",
+               name);
+}
+
+// Holds a key on every machine for one frame each interval frames, then
+// wakes the parked ones
+Chip8::Task pressKeys(Chip8::Scheduler &scheduler,
+                      std::vector<std::unique_ptr<Chip8::Board>> &boards,
+                      Chip8::Signal &input, std::uint64_t interval,
+                      std::uint64_t frames) {
+  while (scheduler.frame() + interval < frames) {
+    co_await scheduler.frames(interval);
+    const std::uint8_t key =
+        static_cast<std::uint8_t>(scheduler.frame() / interval % 16);
+    for (auto &board : boards)
+      board->handleKey(key, true);
+    input.notify();
+    co_await scheduler.frames(1);
+    for (auto &board : boards)
+      board->handleKey(key, false);
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t instances = 10000;
+  std::uint64_t frames = 600;
+  std::uint64_t interval = 30;
+  int opt;
+  while (-1 != (opt = getopt(argc, argv, "n:f:i:h"))) {
+    switch (opt) {
+    case 'n':
+      instances = std::strtoull(optarg, nullptr, 0);
+      break;
+    case 'f':
+      frames = std::strtoull(optarg, nullptr, 0);
+      break;
+    case 'i':
+      interval = std::strtoull(optarg, nullptr, 0);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind >= argc || 0 == instances) {
+    usage(argv[0]);
+    return 1;
+  }
+  const std::vector<std::uint8_t> rom = Chip8::LoadFile(argv[optind]);
+  if (rom.empty()) {
+    std::fprintf(stderr, "Unable to read %s\n", argv[optind]);
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<Chip8::Board>> boards;
+  boards.reserve(instances);
+  Chip8::Scheduler scheduler;
+  Chip8::Signal input(scheduler);
+  for (std::size_t index = 0; index < instances; ++index) {
+    boards.emplace_back(new Chip8::Board(std::make_shared<Chip8::Video>(),
+                                         std::make_shared<Chip8::Audio>()));
+    Chip8::Board &board = *boards.back();
+    board.setTimingMode(Chip8::TimingMode::Vip);
+    board.setSeed(static_cast<std::uint32_t>(index));
+    board.LoadBinary(rom);
+    scheduler.spawn(Chip8::runBoard(scheduler, board, input, frames));
+  }
+  if (interval)
+    scheduler.spawn(pressKeys(scheduler, boards, input, interval, frames));
+
+  const auto start = std::chrono::steady_clock::now();
+  std::size_t parked = 0;
+  while (scheduler.alive() && 0 != scheduler.run(1)) {
+    if (input.waiting() > parked)
+      parked = input.waiting();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  // Nearly every resume runs one machine frame
+  std::printf("%zu machines, %llu ticks, %.0f resumes/s, "
+              "at most %zu parked, %zu parked at exit\n",
+              instances, static_cast<unsigned long long>(scheduler.frame()),
+              seconds > 0 ? scheduler.resumes() / seconds : 0.0, parked,
+              input.waiting());
+  return 0;
+}
@@ -0,0 +1,148 @@
+#include <Chip8/TerminalVideo.h>
+#include <cerrno>
+#include <unistd.h>
+
+namespace Chip8 {
+
+constexpr std::uint16_t TerminalVideo::Unknown;
+constexpr std::size_t TerminalVideo::MaxCells;
+
+namespace {
+
+// Quadrant glyphs (U+2580 block) indexed by upper left 1, upper right 2,
+// lower left 4, lower right 8. Zero is a space.
+const std::uint8_t kQuadrants[16] = {0x00, 0x98, 0x9D, 0x80, 0x96, 0x8C,
+                                     0x9E, 0x9B, 0x97, 0x9A, 0x90, 0x9C,
+                                     0x84, 0x99, 0x9F, 0x88};
+
+// Braille dot bit of pixel (x, y) within a 2x4 cell
+const std::uint8_t kBrailleDots[4][2] = {
+    {0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+
+// ESC [ row ; column H is at most this long on a 64x32 screen
+constexpr std::size_t MoveLength = 8;
+
+} // namespace
+
+TerminalVideo::TerminalVideo(int fd, Glyphs glyphs)
+    : m_fd(fd), m_glyphs(glyphs) {
+  invalidate();
+  // Worst case: a move and a glyph per cell plus the frame prologue
+  m_frame.reserve(MaxCells * (MoveLength + 3) + 32);
+}
+
+TerminalVideo::~TerminalVideo() { close(); }
+
+void TerminalVideo::close() {
+  if (!m_started)
+    return;
+  m_started = false;
+  invalidate();
+  // Leave the cursor visible below the picture
+  m_frame.clear();
+  moveTo(0, rows());
+  m_frame += "\x1b[?25h";
+  ssize_t rv = ::write(m_fd, m_frame.data(), m_frame.size());
+  (void)rv;
+}
+
+std::uint16_t TerminalVideo::pattern(std::uint16_t column,
+                                     std::uint16_t row) const {
+  const std::size_t x = column * cellWidth();
+  const std::size_t y = row * cellHeight();
+  std::uint16_t bits = 0;
+  if (Glyphs::Braille == m_glyphs) {
+    for (std::size_t dy = 0; dy < 4; ++dy)
+      for (std::size_t dx = 0; dx < 2; ++dx)
+        if (m_screen[y + dy][x + dx])
+          bits |= kBrailleDots[dy][dx];
+  } else {
+    bits = (m_screen[y][x] ? 1 : 0) | (m_screen[y][x + 1] ? 2 : 0) |
+           (m_screen[y + 1][x] ? 4 : 0) | (m_screen[y + 1][x + 1] ? 8 : 0);
+  }
+  return bits;
+}
+
+void TerminalVideo::putGlyph(std::uint16_t pattern) {
+  // Both glyph sets are three byte UTF-8 sequences, except the space
+  if (Glyphs::Braille == m_glyphs) {
+    m_frame += '\xE2';
+    m_frame += static_cast<char>(0xA0 | pattern >> 6);
+    m_frame += static_cast<char>(0x80 | (pattern & 0x3F));
+  } else if (0 == pattern) {
+    m_frame += ' ';
+  } else {
+    m_frame += '\xE2';
+    m_frame += '\x96';
+    m_frame += static_cast<char>(kQuadrants[pattern]);
+  }
+}
+
+void TerminalVideo::moveTo(std::uint16_t column, std::uint16_t row) {
+  char text[MoveLength + 1];
+  char *out = text + sizeof(text);
+  // Built backwards, 1 based coordinates
+  *--out = 'H';
+  for (unsigned value = column + 1u; value; value /= 10)
+    *--out = static_cast<char>('0' + value % 10);
+  *--out = ';';
+  for (unsigned value = row + 1u; value; value /= 10)
+    *--out = static_cast<char>('0' + value % 10);
+  *--out = '[';
+  *--out = '\x1b';
+  m_frame.append(out, text + sizeof(text) - out);
+}
+
+const std::string &TerminalVideo::render() {
+  m_frame.clear();
+  if (!m_started) {
+    // Clear the terminal and hide the cursor once
+    m_frame += "\x1b[2J\x1b[?25l";
+    m_started = true;
+  }
+  // Cursor position after the last glyph, no row when unknown
+  std::uint16_t cursorColumn = 0;
+  std::uint16_t cursorRow = rows();
+  for (std::uint16_t row = 0; row < rows(); ++row) {
+    for (std::uint16_t column = 0; column < columns(); ++column) {
+      std::uint16_t &cell = m_cells[row * columns() + column];
+      const std::uint16_t bits = pattern(column, row);
+      if (bits == cell)
+        continue;
+      cell = bits;
+      if (row == cursorRow && column >= cursorColumn &&
+          (column - cursorColumn) * 3 < MoveLength) {
+        // Cheaper to repeat the few unchanged cells than to move over them
+        for (; cursorColumn < column; ++cursorColumn)
+          putGlyph(m_cells[row * columns() + cursorColumn]);
+      } else {
+        moveTo(column, row);
+      }
+      putGlyph(bits);
+      cursorColumn = column + 1;
+      cursorRow = row;
+    }
+  }
+  return m_frame;
+}
+
+void TerminalVideo::update() {
+  render();
+  m_frames++;
+  if (m_frame.empty())
+    return;
+  const char *data = m_frame.data();
+  std::size_t left = m_frame.size();
+  while (left > 0) {
+    const ssize_t count = ::write(m_fd, data, left);
+    if (count < 0 && EINTR == errno)
+      continue;
+    if (count <= 0)
+      break;
+    data += count;
+    left -= count;
+  }
+  m_bytes += m_frame.size();
+}
+
+} // namespace Chip8
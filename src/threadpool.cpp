@@ -0,0 +1,57 @@
+#include <Chip8/ThreadPool.h>
+
+namespace Chip8 {
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (0 == threads)
+    threads = std::thread::hardware_concurrency();
+  if (0 == threads)
+    threads = 1;
+  for (unsigned id = 0; id < threads; ++id)
+    m_threads.emplace_back(&ThreadPool::worker, this, id);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (auto &thread : m_threads)
+    thread.join();
+}
+
+void ThreadPool::worker(unsigned id) {
+  std::uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_wake.wait(lock, [&]() { return m_stop || seen != m_generation; });
+    if (m_stop)
+      return;
+    seen = m_generation;
+    const Job &job = *m_job;
+    const std::size_t count = m_count;
+    lock.unlock();
+    for (std::size_t index; (index = m_next.fetch_add(1)) < count;)
+      job(index, id);
+    lock.lock();
+    if (0 == --m_busy)
+      m_done.notify_all();
+  }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const Job &job) {
+  if (0 == count)
+    return;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_job = &job;
+  m_count = count;
+  m_next = 0;
+  m_busy = size();
+  m_generation++;
+  m_wake.notify_all();
+  m_done.wait(lock, [&]() { return 0 == m_busy; });
+  m_job = nullptr;
+}
+
+} // namespace Chip8
@@ -0,0 +1,126 @@
+#include <Chip8/Trace.h>
+#include <cstring>
+
+namespace Chip8 {
+
+TraceRecorder::~TraceRecorder() {
+  if (isOpen() && ResultType::Ok != close())
+    std::fprintf(stderr, "Trace file could not be completed\n");
+}
+
+ResultType TraceRecorder::open(const char *path) {
+  if (isOpen())
+    return ResultType::Error;
+  m_file = std::fopen(path, "wb");
+  if (nullptr == m_file)
+    return ResultType::Error;
+  TraceHeader header = {{'C', '8', 'T', 'R'}, TraceVersion, 0};
+  if (1 != std::fwrite(&header, sizeof(header), 1, m_file)) {
+    std::fclose(m_file);
+    m_file = nullptr;
+    return ResultType::Error;
+  }
+  m_regs.fill(0);
+  m_I = 0;
+  m_records = 0;
+  m_writer.start([this](const Block &block) {
+    return block.size == std::fwrite(block.data, 1, block.size, m_file);
+  });
+  return ResultType::Ok;
+}
+
+ResultType TraceRecorder::close() {
+  if (!isOpen())
+    return ResultType::Error;
+  bool ok = m_writer.stop();
+  ok = (0 == std::fclose(m_file)) && ok;
+  m_file = nullptr;
+  return ok ? ResultType::Ok : ResultType::Error;
+}
+
+ResultType TraceReader::open(const char *path) {
+  std::FILE *in = std::fopen(path, "rb");
+  if (nullptr == in)
+    return ResultType::Error;
+  m_data.clear();
+  std::uint8_t buffer[64 * 1024];
+  std::size_t count;
+  while (0 < (count = std::fread(buffer, 1, sizeof(buffer), in)))
+    m_data.insert(m_data.end(), buffer, buffer + count);
+  std::fclose(in);
+  TraceHeader header;
+  if (m_data.size() < sizeof(header))
+    return ResultType::Error;
+  std::memcpy(&header, m_data.data(), sizeof(header));
+  if (0 != std::memcmp(header.magic, "C8TR", 4) ||
+      TraceVersion != header.version)
+    return ResultType::Error;
+  m_pos = sizeof(header);
+  std::memset(&m_state, 0, sizeof(m_state));
+  return ResultType::Ok;
+}
+
+bool TraceReader::next(TraceRecord &record) {
+  if (m_data.size() - m_pos < 5)
+    return false;
+  const std::uint8_t *in = m_data.data() + m_pos;
+  const std::uint8_t *end = m_data.data() + m_data.size();
+  m_state.pc = in[0] | in[1] << 8;
+  m_state.opcode = in[2] | in[3] << 8;
+  in += 4;
+  std::uint32_t changed = 0;
+  for (unsigned shift = 0; shift < 28; shift += 7) {
+    if (in == end)
+      return false;
+    const std::uint8_t byte = *in++;
+    changed |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+    if (0 == (byte & 0x80))
+      break;
+  }
+  for (std::uint32_t bits = changed & 0xFFFF; bits; bits &= bits - 1) {
+    if (in == end)
+      return false;
+    m_state.regs[__builtin_ctz(bits)] = *in++;
+  }
+  if (changed & TraceChangedI) {
+    if (end - in < 2)
+      return false;
+    m_state.I = in[0] | in[1] << 8;
+    in += 2;
+  }
+  m_state.changed = changed;
+  m_pos = in - m_data.data();
+  record = m_state;
+  return true;
+}
+
+ResultType compareTraces(const char *pathA, const char *pathB,
+                         bool &diverged, TraceDivergence &divergence) {
+  TraceReader readerA;
+  TraceReader readerB;
+  ResultType rv = readerA.open(pathA);
+  CHIP8_CHECK_RESULT(rv);
+  rv = readerB.open(pathB);
+  CHIP8_CHECK_RESULT(rv);
+  std::memset(&divergence, 0, sizeof(divergence));
+  diverged = false;
+  for (;; divergence.index++) {
+    divergence.endA = !readerA.next(divergence.a);
+    divergence.endB = !readerB.next(divergence.b);
+    if (divergence.endA || divergence.endB) {
+      diverged = divergence.endA != divergence.endB;
+      return ResultType::Ok;
+    }
+    // The change masks are not compared, equal machines agree on them.
+    // A failed fetch is not part of the machine state though.
+    const TraceRecord &a = divergence.a;
+    const TraceRecord &b = divergence.b;
+    if (a.pc != b.pc || a.opcode != b.opcode || a.regs != b.regs ||
+        a.I != b.I || ((a.changed ^ b.changed) & TraceFetchFailed)) {
+      diverged = true;
+      return ResultType::Ok;
+    }
+  }
+}
+
+} // namespace Chip8
@@ -0,0 +1,113 @@
+#include <Chip8/Instruction.h>
+#include <Chip8/Trace.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Offline companion of Chip8_headless -T: decodes, disassembles and compares
+// execution traces.
+
+namespace {
+
+void usage(const char *name) {
+  std::fprintf(stderr,
+               "Usage %s COMMAND\n"
+               "  dump FILE [COUNT]  decode and disassemble a trace\n"
+               "  diff FILE FILE     report the first divergence\n",
+               name);
+}
+
+std::string changes(const Chip8::TraceRecord &record) {
+  std::string out;
+  char text[16];
+  for (unsigned reg = 0; reg < Chip8::StdRegisterCount; ++reg) {
+    if (record.changed & (1u << reg)) {
+      std::snprintf(text, sizeof(text), " V%X=%.2X", reg, record.regs[reg]);
+      out += text;
+    }
+  }
+  if (record.changed & Chip8::TraceChangedI) {
+    std::snprintf(text, sizeof(text), " I=%.3X", record.I);
+    out += text;
+  }
+  return out;
+}
+
+void disasm(const Chip8::TraceRecord &record, char *text, std::size_t size) {
+  if (record.changed & Chip8::TraceFetchFailed)
+    std::snprintf(text, size, "<fetch failed>");
+  else
+    Chip8::Instruction(record.opcode).disasm(text, size);
+}
+
+void printRecord(std::uint64_t index, const Chip8::TraceRecord &record) {
+  char text[Chip8::DisasmMaxLength];
+  disasm(record, text, sizeof(text));
+  std::printf("%10llu  0x%.3X  %.4X  %-16s%s\n",
+              static_cast<unsigned long long>(index), record.pc,
+              record.opcode, text, changes(record).c_str());
+}
+
+void printState(const char *name, const Chip8::TraceRecord &record) {
+  char text[Chip8::DisasmMaxLength];
+  disasm(record, text, sizeof(text));
+  std::printf("%s: PC 0x%.3X  %.4X  %-16s I=%.3X\n   ", name, record.pc,
+              record.opcode, text, record.I);
+  for (unsigned reg = 0; reg < Chip8::StdRegisterCount; ++reg)
+    std::printf(" V%X=%.2X", reg, record.regs[reg]);
+  std::printf("\n");
+}
+
+int dump(const char *path, std::uint64_t count) {
+  Chip8::TraceReader reader;
+  if (Chip8::ResultType::Ok != reader.open(path)) {
+    std::fprintf(stderr, "Unable to read trace %s\n", path);
+    return 1;
+  }
+  Chip8::TraceRecord record;
+  for (std::uint64_t index = 0; index < count && reader.next(record); ++index)
+    printRecord(index, record);
+  return 0;
+}
+
+int diff(const char *pathA, const char *pathB) {
+  bool diverged;
+  Chip8::TraceDivergence divergence;
+  if (Chip8::ResultType::Ok !=
+      Chip8::compareTraces(pathA, pathB, diverged, divergence)) {
+    std::fprintf(stderr, "Unable to read traces\n");
+    return 2;
+  }
+  if (!diverged) {
+    std::printf("identical, %llu instructions\n",
+                static_cast<unsigned long long>(divergence.index));
+    return 0;
+  }
+  std::printf("first divergence at instruction %llu\n",
+              static_cast<unsigned long long>(divergence.index));
+  if (divergence.endA)
+    std::printf("A: trace ended\n");
+  else
+    printState("A", divergence.a);
+  if (divergence.endB)
+    std::printf("B: trace ended\n");
+  else
+    printState("B", divergence.b);
+  return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc >= 3 && 0 == std::strcmp(argv[1], "dump")) {
+    const std::uint64_t count =
+        argc >= 4 ? std::strtoull(argv[3], nullptr, 0) : UINT64_MAX;
+    return dump(argv[2], count);
+  }
+  if (argc == 4 && 0 == std::strcmp(argv[1], "diff"))
+    return diff(argv[2], argv[3]);
+  usage(argv[0]);
+  return 1;
+}
@@ -0,0 +1,195 @@
+#include <Chip8/Upscaler.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHIP8_UPSCALER_X86
+#endif
+
+namespace Chip8 {
+
+namespace {
+
+constexpr std::uint32_t kAlpha = 0xFF000000u;
+// Overlapping stores may run this many pixels past a cell
+constexpr unsigned kPadding = 8;
+
+std::uint32_t gray(std::uint8_t value) { return kAlpha | value * 0x010101u; }
+
+// Half brightness, alpha stays opaque
+std::uint32_t dim(std::uint32_t pixel) {
+  return kAlpha | ((pixel >> 1) & 0x007F7F7Fu);
+}
+
+void fillScalar(std::uint32_t *dst, std::uint32_t value, unsigned count) {
+  std::fill(dst, dst + count, value);
+}
+
+void dimScalar(std::uint32_t *dst, const std::uint32_t *src, unsigned count) {
+  for (unsigned x = 0; x < count; ++x)
+    dst[x] = dim(src[x]);
+}
+
+#ifdef CHIP8_UPSCALER_X86
+// Rounds count up to whole vectors, the caller pads the row
+__attribute__((target("sse2"))) void
+fillSse2(std::uint32_t *dst, std::uint32_t value, unsigned count) {
+  const __m128i v = _mm_set1_epi32(static_cast<int>(value));
+  for (unsigned x = 0; x < count; x += 4)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), v);
+}
+
+__attribute__((target("sse2"))) void
+dimSse2(std::uint32_t *dst, const std::uint32_t *src, unsigned count) {
+  const __m128i mask = _mm_set1_epi32(0x007F7F7F);
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(kAlpha));
+  for (unsigned x = 0; x < count; x += 4) {
+    __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+    v = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 1), mask), alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), v);
+  }
+}
+
+__attribute__((target("avx2"))) void
+fillAvx2(std::uint32_t *dst, std::uint32_t value, unsigned count) {
+  const __m256i v = _mm256_set1_epi32(static_cast<int>(value));
+  for (unsigned x = 0; x < count; x += 8)
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), v);
+}
+
+__attribute__((target("avx2"))) void
+dimAvx2(std::uint32_t *dst, const std::uint32_t *src, unsigned count) {
+  const __m256i mask = _mm256_set1_epi32(0x007F7F7F);
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kAlpha));
+  for (unsigned x = 0; x < count; x += 8) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+    v = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(v, 1), mask),
+                        alpha);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), v);
+  }
+}
+#endif
+
+// EPX / Scale2x: each pixel becomes 2x2, corners take a neighbour's value
+// where two edges agree
+void scale2x(const Upscaler::Leds &leds, std::uint8_t *out) {
+  const unsigned width = ScreenWidth * 2;
+  for (unsigned y = 0; y < ScreenHeight; ++y) {
+    for (unsigned x = 0; x < ScreenWidth; ++x) {
+      const std::uint8_t p = leds[y][x];
+      const std::uint8_t a = y > 0 ? leds[y - 1][x] : p;
+      const std::uint8_t b = x + 1 < ScreenWidth ? leds[y][x + 1] : p;
+      const std::uint8_t c = x > 0 ? leds[y][x - 1] : p;
+      const std::uint8_t d = y + 1 < ScreenHeight ? leds[y + 1][x] : p;
+      std::uint8_t *top = out + (2 * y) * width + 2 * x;
+      std::uint8_t *bottom = top + width;
+      const bool split = a != d && b != c;
+      top[0] = split && c == a ? a : p;
+      top[1] = split && a == b ? b : p;
+      bottom[0] = split && d == c ? c : p;
+      bottom[1] = split && b == d ? d : p;
+    }
+  }
+}
+
+} // namespace
+
+const char *simdName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::Avx2:
+    return "avx2";
+  case SimdLevel::Sse2:
+    return "sse2";
+  default:
+    return "scalar";
+  }
+}
+
+Upscaler::Upscaler(unsigned scale, UpscaleFilter filter, unsigned effects)
+    : m_filter(filter), m_scale(std::max(1u, scale)), m_effects(effects) {
+  if (UpscaleFilter::Scale2x == m_filter) {
+    m_scale = std::max(2u, m_scale & ~1u);
+    m_epx.resize(4 * ScreenWidth * ScreenHeight);
+  }
+  m_bright.resize(width() + kPadding);
+  m_dimmed.resize(width() + kPadding);
+  setSimd(detectSimd());
+}
+
+SimdLevel Upscaler::detectSimd() {
+#ifdef CHIP8_UPSCALER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return SimdLevel::Avx2;
+  if (__builtin_cpu_supports("sse2"))
+    return SimdLevel::Sse2;
+#endif
+  return SimdLevel::Scalar;
+}
+
+void Upscaler::setSimd(SimdLevel level) {
+  m_simd = std::min(level, detectSimd());
+  switch (m_simd) {
+#ifdef CHIP8_UPSCALER_X86
+  case SimdLevel::Avx2:
+    m_fill = fillAvx2;
+    m_dim = dimAvx2;
+    break;
+  case SimdLevel::Sse2:
+    m_fill = fillSse2;
+    m_dim = dimSse2;
+    break;
+#endif
+  default:
+    m_fill = fillScalar;
+    m_dim = dimScalar;
+    break;
+  }
+}
+
+void Upscaler::run(const Leds &leds, std::uint32_t *out, std::size_t pitch) {
+  const std::uint8_t *source = &leds[0][0];
+  unsigned columns = ScreenWidth;
+  unsigned rows = ScreenHeight;
+  if (UpscaleFilter::Scale2x == m_filter) {
+    scale2x(leds, m_epx.data());
+    source = m_epx.data();
+    columns *= 2;
+    rows *= 2;
+  }
+  const unsigned cell = width() / columns;
+  // Effects follow the original pixels, not the Scale2x ones
+  const bool grid = (m_effects & UpscaleGrid) && m_scale > 1;
+  const bool scanlines = (m_effects & UpscaleScanlines) && m_scale > 1;
+  const unsigned litRows = m_scale - std::max(1u, m_scale / 4);
+  const std::size_t bytes = width() * sizeof(std::uint32_t);
+
+  std::uint8_t *line = reinterpret_cast<std::uint8_t *>(out);
+  for (unsigned y = 0; y < rows; ++y) {
+    const std::uint8_t *src = source + y * columns;
+    // Cells written left to right, each overwrites the previous overshoot
+    for (unsigned x = 0; x < columns; ++x)
+      m_fill(&m_bright[x * cell], gray(src[x]), cell);
+    if (grid) {
+      for (unsigned x = m_scale - 1; x < width(); x += m_scale)
+        m_bright[x] = dim(m_bright[x]);
+    }
+    bool haveDimmed = false;
+    for (unsigned sub = 0; sub < cell; ++sub) {
+      const unsigned row = (y * cell + sub) % m_scale;
+      const bool dark = (grid && m_scale - 1 == row) ||
+                        (scanlines && row >= litRows);
+      if (dark && !haveDimmed) {
+        m_dim(m_dimmed.data(), m_bright.data(), width());
+        haveDimmed = true;
+      }
+      std::memcpy(line, dark ? m_dimmed.data() : m_bright.data(), bytes);
+      line += pitch;
+    }
+  }
+}
+
+} // namespace Chip8
@@ -1,4 +1,6 @@
 #include <Chip8/Video.h>
+#include <cstdio>
+#include <cstring>
 
 namespace Chip8 {
 
@@ -13,6 +15,27 @@ void Video::clearScreen() {
       bit = 0;
 }
 
+void Video::updateLeds() {
+  for (uint8_t y = 0; y < m_screen.size(); ++y) {
+    for (uint8_t x = 0; x < m_screen[y].size(); ++x) {
+      auto &val = m_ledBuffer[y][x];
+      constexpr uint8_t showDiffVal = 0x55;
+      constexpr uint8_t hideDiffVal = 0x15;
+      if (m_screen[y][x]) {
+        if (val < 0xFF - showDiffVal)
+          val += showDiffVal;
+        else
+          val = 0xFF;
+      } else {
+        if (val > hideDiffVal)
+          val -= hideDiffVal;
+        else
+          val = 0;
+      }
+    }
+  }
+}
+
 bool Video::flipSprite(uint8_t x, uint8_t y, uint8_t v) {
   bool rv = false;
   for (uint8_t it = 0; it < 8; ++it) {
@@ -29,11 +52,53 @@ bool Video::flipBit(uint8_t x, uint8_t y, bool v) {
   return oldv && !v;
 }
 
+void Video::copyPixels(std::uint8_t *out) const {
+  static_assert(sizeof(m_screen) == ScreenWidth * ScreenHeight,
+                "screen must be one byte per pixel");
+  // bool holds 0 or 1, the rows are contiguous
+  std::memcpy(out, m_screen.data(), sizeof(m_screen));
+}
+
+void Video::saveState(BoardState &state) const { pack(state.screen); }
+
+void Video::pack(std::array<std::uint8_t, PackedScreenSize> &packed) const {
+  auto out = packed.begin();
+  for (const auto &row : m_screen) {
+    for (std::size_t x = 0; x < row.size(); x += 8) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      static_assert(sizeof(bool) == 1, "bool must be one byte");
+      // Eight 0/1 bytes, byte N moved to bit 7 - N of the top byte
+      std::uint64_t bytes;
+      std::memcpy(&bytes, &row[x], sizeof(bytes));
+      *out++ = static_cast<uint8_t>((bytes * 0x8040201008040201ull) >> 56);
+#else
+      uint8_t byte = 0;
+      for (std::size_t bit = 0; bit < 8; ++bit)
+        byte |= (row[x + bit] ? 0x80 : 0) >> bit;
+      *out++ = byte;
+#endif
+    }
+  }
+}
+
+void Video::loadState(const BoardState &state) {
+  auto in = state.screen.begin();
+  for (auto &row : m_screen) {
+    for (std::size_t x = 0; x < row.size(); x += 8) {
+      uint8_t byte = *in++;
+      for (std::size_t bit = 0; bit < 8; ++bit)
+        row[x + bit] = 0 != (byte & (0x80 >> bit));
+    }
+  }
+}
+
 void Video::dump() {
-  for (auto row : m_screen) {
-    for (auto bit : row)
-      std::printf("%c", bit ? '*' : '_');
-    std::printf("\n");
+  char line[64 + 1];
+  line[64] = '\n';
+  for (const auto &row : m_screen) {
+    for (std::size_t x = 0; x < row.size(); ++x)
+      line[x] = row[x] ? '*' : '_';
+    std::fwrite(line, 1, sizeof(line), stdout);
   }
 }
 
@@ -0,0 +1,63 @@
+#include <Chip8/VideoAtlas.h>
+#include <cmath>
+#include <cstring>
+
+namespace Chip8 {
+
+constexpr unsigned VideoAtlas::TileWidth;
+constexpr unsigned VideoAtlas::TileHeight;
+
+VideoAtlas::VideoAtlas(std::size_t count, unsigned columns)
+    : m_count(count ? count : 1) {
+  if (0 == columns) {
+    // Tiles are 2:1, twice as many rows as columns gives a square
+    columns = static_cast<unsigned>(
+        std::ceil(std::sqrt(static_cast<double>(m_count) / 2.0)));
+    if (0 == columns)
+      columns = 1;
+  }
+  m_columns = columns;
+  m_rows = static_cast<unsigned>((m_count + m_columns - 1) / m_columns);
+  m_pixels.assign(static_cast<std::size_t>(width()) * height(), 0xFF000000u);
+  m_leds.assign(m_count * TileWidth * TileHeight, 0);
+  m_dirtyBegin = m_rows;
+}
+
+bool VideoAtlas::update(std::size_t index, const Video &video) {
+  if (index >= m_count)
+    return false;
+  const auto &leds = video.leds();
+  std::uint8_t *cached = &m_leds[index * TileWidth * TileHeight];
+  static_assert(sizeof(leds) == TileWidth * TileHeight, "one byte per LED");
+  // Most machines show the same picture as last frame
+  if (0 == std::memcmp(cached, leds.data(), sizeof(leds)))
+    return false;
+  const unsigned column = static_cast<unsigned>(index % m_columns);
+  const unsigned row = static_cast<unsigned>(index / m_columns);
+  std::uint32_t *tile = &m_pixels[static_cast<std::size_t>(row) *
+                                       TileHeight * width() +
+                                   column * TileWidth];
+  for (unsigned y = 0; y < TileHeight; ++y) {
+    std::uint8_t *line = cached + y * TileWidth;
+    if (0 == std::memcmp(line, leds[y].data(), TileWidth))
+      continue;
+    std::memcpy(line, leds[y].data(), TileWidth);
+    std::uint32_t *out = tile + static_cast<std::size_t>(y) * width();
+    for (unsigned x = 0; x < TileWidth; ++x)
+      out[x] = 0xFF000000u | leds[y][x] * 0x010101u;
+  }
+  if (row < m_dirtyBegin)
+    m_dirtyBegin = row;
+  if (row + 1 > m_dirtyEnd)
+    m_dirtyEnd = row + 1;
+  m_changedTiles++;
+  return true;
+}
+
+void VideoAtlas::clearDirty() {
+  m_dirtyBegin = m_rows;
+  m_dirtyEnd = 0;
+  m_changedTiles = 0;
+}
+
+} // namespace Chip8
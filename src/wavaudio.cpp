@@ -0,0 +1,174 @@
+#include <Chip8/Board.h>
+#include <Chip8/WavAudio.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace Chip8 {
+
+namespace {
+
+// COSMAC VIP: 1.76 MHz clock, 8 clocks per machine cycle
+constexpr std::uint64_t VipCyclesPerSecond = 1760000 / 8;
+
+// Samples rendered per fwrite
+constexpr std::size_t ChunkSamples = 64 * 1024;
+
+// Canonical 44 byte header of a PCM WAV file, little endian
+struct WavHeader {
+  char riff[4];
+  std::uint32_t riffSize;
+  char wave[4];
+  char fmt[4];
+  std::uint32_t fmtSize;
+  std::uint16_t format;
+  std::uint16_t channels;
+  std::uint32_t rate;
+  std::uint32_t byteRate;
+  std::uint16_t blockAlign;
+  std::uint16_t bits;
+  char data[4];
+  std::uint32_t dataSize;
+};
+static_assert(sizeof(WavHeader) == 44, "WavHeader must not be padded");
+
+} // namespace
+
+void WavAudio::record(bool on) {
+  // Beeps toggle on timer ticks, with VIP timing a tick belongs to the frame
+  // boundary rather than the instruction that crossed it
+  std::uint64_t now = 0;
+  if (m_board && TimingMode::Vip == m_board->timingMode())
+    now = m_board->frame() * Chip8::VipCyclesPerFrame;
+  else if (m_board)
+    now = m_board->cycles();
+  // A restored earlier state discards what followed it
+  while (!m_transitions.empty() && m_transitions.back() > now)
+    m_transitions.pop_back();
+  const bool recordedOn = 1 == m_transitions.size() % 2;
+  if (on == recordedOn)
+    return;
+  if (!m_transitions.empty() && m_transitions.back() == now) {
+    // Zero length beep or gap
+    m_transitions.pop_back();
+    return;
+  }
+  m_transitions.push_back(now);
+}
+
+void WavAudio::beginBeep() {
+  record(true);
+  Audio::beginBeep();
+}
+
+void WavAudio::endBeep() {
+  record(false);
+  Audio::endBeep();
+}
+
+void WavAudio::reset() {
+  if (beep())
+    record(false);
+  Audio::reset();
+}
+
+void WavAudio::clear() {
+  m_transitions.clear();
+  if (beep())
+    record(true);
+}
+
+std::uint64_t WavAudio::beepCycles(std::uint64_t end) const {
+  std::uint64_t total = 0;
+  for (std::size_t it = 0; it < m_transitions.size(); it += 2) {
+    const std::uint64_t start = std::min(m_transitions[it], end);
+    const std::uint64_t stop =
+        it + 1 < m_transitions.size() ? std::min(m_transitions[it + 1], end)
+                                      : end;
+    total += stop - start;
+  }
+  return total;
+}
+
+std::uint64_t WavAudio::sampleAt(std::uint64_t cycle, unsigned rate) {
+  return cycle * rate / VipCyclesPerSecond;
+}
+
+void WavAudio::render(unsigned rate, std::uint64_t first, std::size_t count,
+                      std::int16_t *out) const {
+  const std::uint64_t last = first + count;
+  // 32 bit phase accumulator, the tone runs free so its phase only depends
+  // on the sample index
+  const std::uint32_t step =
+      static_cast<std::uint32_t>((std::uint64_t(m_toneHz) << 32) / rate);
+  const std::int16_t high = m_amplitude;
+  const std::int16_t low = -m_amplitude;
+  // First beep that may overlap the range
+  std::size_t it = std::upper_bound(m_transitions.begin(),
+                                    m_transitions.end(), 0,
+                                    [&](int, std::uint64_t cycle) {
+                                      return sampleAt(cycle, rate) > first;
+                                    }) -
+                   m_transitions.begin();
+  it &= ~std::size_t(1);
+  std::uint64_t pos = first;
+  while (pos < last) {
+    std::uint64_t start = last;
+    std::uint64_t stop = last;
+    if (it < m_transitions.size()) {
+      start = std::max(sampleAt(m_transitions[it], rate), pos);
+      if (it + 1 < m_transitions.size())
+        stop = std::max(sampleAt(m_transitions[it + 1], rate), start);
+      start = std::min(start, last);
+      stop = std::min(stop, last);
+    }
+    std::memset(out + (pos - first), 0, (start - pos) * sizeof(*out));
+    std::uint32_t phase = static_cast<std::uint32_t>(start * step);
+    for (std::uint64_t sample = start; sample < stop; ++sample) {
+      out[sample - first] = phase & 0x80000000u ? low : high;
+      phase += step;
+    }
+    pos = stop;
+    it += 2;
+  }
+}
+
+ResultType WavAudio::writeWav(const char *path, unsigned rate,
+                              std::uint64_t end) const {
+  if (0 == rate)
+    return ResultType::Error;
+  const std::uint64_t samples = sampleAt(end, rate);
+  // RIFF sizes are 32 bit
+  if (samples * 2 > 0xFFFFFFFFu - sizeof(WavHeader))
+    return ResultType::OutOfRange;
+  std::FILE *file = std::fopen(path, "wb");
+  if (!file)
+    return ResultType::Error;
+  WavHeader header;
+  std::memcpy(header.riff, "RIFF", 4);
+  header.riffSize = static_cast<std::uint32_t>(36 + samples * 2);
+  std::memcpy(header.wave, "WAVE", 4);
+  std::memcpy(header.fmt, "fmt ", 4);
+  header.fmtSize = 16;
+  header.format = 1; // PCM
+  header.channels = 1;
+  header.rate = rate;
+  header.byteRate = rate * 2;
+  header.blockAlign = 2;
+  header.bits = 16;
+  std::memcpy(header.data, "data", 4);
+  header.dataSize = static_cast<std::uint32_t>(samples * 2);
+  bool ok = 1 == std::fwrite(&header, sizeof(header), 1, file);
+  std::vector<std::int16_t> chunk(ChunkSamples);
+  for (std::uint64_t pos = 0; ok && pos < samples; pos += ChunkSamples) {
+    const std::size_t count =
+        static_cast<std::size_t>(std::min<std::uint64_t>(ChunkSamples,
+                                                         samples - pos));
+    render(rate, pos, count, chunk.data());
+    ok = count == std::fwrite(chunk.data(), sizeof(chunk[0]), count, file);
+  }
+  ok = 0 == std::fclose(file) && ok;
+  return ok ? ResultType::Ok : ResultType::Error;
+}
+
+} // namespace Chip8
@@ -0,0 +1,65 @@
+#include <Chip8/Audio.h>
+#include <Chip8/Board.h>
+#include <Chip8/Scheduler.h>
+#include <Chip8/Video.h>
+
+#include <gtest/gtest.h>
+
+// Built as C++20 next to tests.cpp when the compiler has coroutines
+
+namespace {
+
+Chip8::Task countFrames(Chip8::Scheduler &scheduler, int &count, int total) {
+  for (; count < total; ++count)
+    co_await scheduler.frames(2);
+}
+
+} // namespace
+
+TEST(Scheduler, SleepsAndFinishesTasks) {
+  Chip8::Scheduler scheduler;
+  int fast = 0, slow = 0;
+  scheduler.spawn(countFrames(scheduler, fast, 3));
+  scheduler.spawn(countFrames(scheduler, slow, 100));
+  EXPECT_EQ(2u, scheduler.alive());
+  // Resumed in ticks 1, 3, 5 and 7
+  EXPECT_EQ(4u, scheduler.run(4));
+  EXPECT_EQ(1, fast);
+  EXPECT_EQ(1, slow);
+  scheduler.run(4);
+  EXPECT_EQ(3, fast);
+  EXPECT_EQ(1u, scheduler.alive());
+  // Parked coroutine frames go away with the scheduler
+}
+
+TEST(Scheduler, BoardsParkOnKeyWait) {
+  // LD V1, K; JP 0x200
+  const std::vector<std::uint8_t> rom = {0xF1, 0x0A, 0x12, 0x00};
+  Chip8::Scheduler scheduler;
+  Chip8::Signal input(scheduler);
+  std::vector<std::unique_ptr<Chip8::Board>> boards;
+  for (int index = 0; index < 2; ++index) {
+    boards.emplace_back(new Chip8::Board(std::make_shared<Chip8::Video>(),
+                                         std::make_shared<Chip8::Audio>()));
+    boards.back()->setTimingMode(Chip8::TimingMode::Vip);
+    boards.back()->LoadBinary(rom);
+    scheduler.spawn(Chip8::runBoard(scheduler, *boards.back(), input, 50));
+  }
+  // First frame reaches the key wait, then nothing is runnable
+  EXPECT_EQ(2u, scheduler.run(100));
+  EXPECT_EQ(2u, input.waiting());
+  EXPECT_TRUE(boards[0]->isIdleKeyWait());
+  EXPECT_EQ(1u, boards[0]->frame());
+
+  boards[0]->handleKey(7, true);
+  input.notify();
+  // One frame, then back in the key wait
+  EXPECT_EQ(2u, scheduler.run(100));
+  Chip8::BoardState state;
+  boards[0]->saveCoreState(state);
+  EXPECT_EQ(7, state.regs[1]);
+  EXPECT_EQ(2u, boards[0]->frame());
+  EXPECT_EQ(1u, boards[1]->frame());
+  EXPECT_EQ(2u, input.waiting());
+  EXPECT_EQ(2u, scheduler.alive());
+}
@@ -1,10 +1,35 @@
+#include <Chip8/AccessMap.h>
+#include <Chip8/Analysis.h>
 #include <Chip8/Board.h>
+#include <Chip8/Breakpoints.h>
 #include <Chip8/Cpu.h>
+#include <Chip8/Explorer.h>
+#include <Chip8/FrameRecorder.h>
+#include <Chip8/History.h>
 #include <Chip8/Memory.h>
+#include <Chip8/Movie.h>
+#include <Chip8/Profiler.h>
+#include <Chip8/Rewind.h>
+#include <Chip8/RunAhead.h>
+#include <Chip8/SaveState.h>
+#include <Chip8/SharedEnv.h>
+#include <Chip8/TerminalVideo.h>
+#include <Chip8/Trace.h>
+#include <Chip8/Upscaler.h>
 #include <Chip8/Video.h>
+#include <Chip8/VideoAtlas.h>
+#include <Chip8/WavAudio.h>
+#include <chip8.h>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <thread>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include "../src/debugger.h"
+#include "../src/gdbstub.h"
 #include "../src/sdlvideo.h"
 
 #include <gtest/gtest.h>
@@ -68,11 +93,30 @@ public:
   }
 
 protected:
-  virtual void SetUp() { g_board->reset(); }
+  // g_board is shared by every test, a failed ASSERT must not leak timing,
+  // seed or hooks into the next one
+  virtual void SetUp() {
+    g_board->setTimingMode(Chip8::TimingMode::Host);
+    g_board->setSeed(0);
+    g_board->setBreak(false);
+    g_board->setProfiler(nullptr);
+    g_board->setAccessMap(nullptr);
+    g_board->setTracer(nullptr);
+    g_board->setFrameRecorder(nullptr);
+    g_board->setHistory(nullptr);
+    g_board->setBreakpoints(nullptr);
+    g_board->reset();
+  }
   virtual void TearDown() {}
 
   virtual Chip8::Board *board() { return g_board.get(); }
   virtual std::shared_ptr<Chip8::Board> board_sp() { return g_board; }
+  // Registers and timers without the memory image
+  Chip8::BoardState coreState() {
+    Chip8::BoardState state;
+    board()->saveCoreState(state);
+    return state;
+  }
 };
 
 // using Chip8Test = Chip8TestBase<::testing::Test>;
@@ -101,6 +145,1266 @@ TEST_F(Chip8Test, ADD_Vx_nn) {
   });
 }
 
+TEST_F(Chip8Test, VipTiming_TimersFollowCycles) {
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  // LD V0, 0x3C; LD DT, V0; JP 0x204
+  board()->LoadBinary({0x60, 0x3C, 0xF0, 0x15, 0x12, 0x04});
+  for (int frame = 1; frame <= 10; ++frame) {
+    board()->runFrame();
+    ASSERT_EQ(static_cast<uint64_t>(frame), board()->frame());
+    ASSERT_GE(board()->cycles(), frame * Chip8::VipCyclesPerFrame);
+  }
+  EXPECT_EQ(0x3C - 10, coreState().dt);
+}
+
+TEST_F(Chip8Test, VipTiming_DrawWaitsForVblank) {
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  // DRW V0, V0, 1
+  board()->LoadBinary({0xD0, 0x01});
+  board()->step();
+  EXPECT_EQ(Chip8::VipCyclesPerFrame, board()->cycles());
+  EXPECT_EQ(1u, board()->frame());
+}
+
+TEST_F(Chip8Test, VipTiming_Deterministic) {
+  // RND V1, 0xFF; DRW V1, V1, 5; JP 0x200
+  const std::vector<uint8_t> rom = {0xC1, 0xFF, 0xD1, 0x15, 0x12, 0x00};
+  auto run = [&]() {
+    board()->setTimingMode(Chip8::TimingMode::Vip);
+    board()->reset();
+    board()->LoadBinary(rom);
+    for (int frame = 0; frame < 120; ++frame)
+      board()->runFrame();
+    return std::make_pair(board()->cycles(), coreState().regs[1]);
+  };
+  EXPECT_EQ(run(), run());
+}
+
+TEST_F(Chip8Test, Movie_RecordReplay) {
+  // LD V0, K; ADD V1, V0; JP 0x200
+  const std::vector<uint8_t> rom = {0xF0, 0x0A, 0x81, 0x04, 0x12, 0x00};
+  const std::string path = ::testing::TempDir() + "chip8_movie.c8m";
+  const std::vector<std::pair<uint64_t, uint8_t>> presses = {
+      {3, 0x5}, {10, 0xA}, {11, 0x1}, {400, 0xF}};
+
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  board()->setSeed(1234);
+  board()->reset();
+  board()->LoadBinary(rom);
+  {
+    Chip8::MovieWriter writer;
+    ASSERT_EQ(Chip8::ResultType::Ok,
+              writer.open(path.c_str(), *board(), rom));
+    for (const auto &press : presses) {
+      while (board()->frame() < press.first)
+        board()->runFrame();
+      writer.record(board()->cycles(), press.second, true);
+      board()->handleKey(press.second, true);
+      writer.record(board()->cycles(), press.second, false);
+      board()->handleKey(press.second, false);
+    }
+    writer.close(board()->frame());
+  }
+  const uint8_t expected = coreState().regs[1];
+  const uint64_t expectedCycles = board()->cycles();
+
+  Chip8::MoviePlayer player;
+  ASSERT_EQ(Chip8::ResultType::Ok, player.load(path.c_str()));
+  EXPECT_EQ(1234u, player.header().seed);
+  EXPECT_EQ(8u, player.header().events);
+  board()->setTimingMode(Chip8::TimingMode::Host);
+  player.prepare(*board());
+  board()->LoadBinary(rom);
+  while (board()->frame() < player.header().frames) {
+    player.apply(*board());
+    board()->step();
+  }
+  player.apply(*board());
+  EXPECT_TRUE(player.done());
+  EXPECT_EQ(expected, coreState().regs[1]);
+  EXPECT_EQ(expectedCycles, board()->cycles());
+  EXPECT_FALSE(player.corrupt());
+
+  // Header is little endian on disk; an event whose varint never ends is
+  // rejected instead of shifting past 64 bits
+  std::FILE *file = std::fopen(path.c_str(), "r+b");
+  ASSERT_NE(nullptr, file);
+  std::uint8_t header[sizeof(Chip8::MovieHeader)];
+  ASSERT_EQ(1u, std::fread(header, sizeof(header), 1, file));
+  EXPECT_EQ(Chip8::MovieVersion, header[4] | header[5] << 8);
+  EXPECT_EQ(8u, header[24]);
+  std::fseek(file, sizeof(header), SEEK_SET);
+  for (int it = 0; it < 12; ++it)
+    std::fputc(0xFF, file);
+  std::fclose(file);
+  EXPECT_EQ(Chip8::ResultType::Error, player.load(path.c_str()));
+  std::remove(path.c_str());
+}
+
+namespace {
+// RND V1, 0xFF; RND V2, 0x1F; LD I, 0x50; DRW V1, V2, 5; LD [I], V2;
+// JP 0x200
+const std::vector<uint8_t> kNoiseRom = {0xC1, 0xFF, 0xC2, 0x1F, 0xA0, 0x50,
+                                        0xD1, 0x25, 0xF2, 0x55, 0x12, 0x00};
+
+bool sameState(const Chip8::BoardState &a, const Chip8::BoardState &b) {
+  return 0 == std::memcmp(&a, &b, sizeof(a));
+}
+} // namespace
+
+TEST_F(Chip8Test, State_SaveLoadRoundTrip) {
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  board()->LoadBinary(kNoiseRom);
+  for (int frame = 0; frame < 30; ++frame)
+    board()->runFrame();
+  board()->handleKey(0x7, true);
+  Chip8::BoardState saved, restored, after;
+  board()->saveState(saved);
+  for (int frame = 0; frame < 30; ++frame)
+    board()->runFrame();
+  board()->saveState(after);
+  board()->loadState(saved);
+  board()->saveState(restored);
+  EXPECT_TRUE(sameState(saved, restored));
+  EXPECT_TRUE(board()->isKeyDown(0x7));
+  for (int frame = 0; frame < 30; ++frame)
+    board()->runFrame();
+  board()->saveState(restored);
+  EXPECT_TRUE(sameState(after, restored));
+}
+
+TEST_F(Chip8Test, Rewind_RestoresHistory) {
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  board()->LoadBinary(kNoiseRom);
+  Chip8::RewindBuffer rewind(100, 16);
+  std::vector<Chip8::BoardState> history(250);
+  for (auto &state : history) {
+    board()->runFrame();
+    board()->saveState(state);
+    rewind.capture(state);
+  }
+  // Oldest keyframe group got evicted, newest history must be intact
+  EXPECT_LE(rewind.size(), 100u);
+  EXPECT_GE(rewind.size(), 100u - 16u);
+  EXPECT_LT(rewind.bytes(), rewind.size() * sizeof(Chip8::BoardState) / 8);
+  const std::size_t available = rewind.size();
+  Chip8::BoardState state;
+  for (std::size_t it = 0; it < available / 2; ++it) {
+    ASSERT_TRUE(rewind.rewind(state));
+    ASSERT_TRUE(sameState(history[history.size() - 1 - it], state));
+  }
+  // Capturing after a partial rewind continues from the restored point
+  board()->loadState(state);
+  rewind.capture(state);
+  ASSERT_TRUE(rewind.rewind(state));
+  EXPECT_TRUE(sameState(history[history.size() - available / 2], state));
+  while (rewind.rewind(state)) {
+  }
+  EXPECT_EQ(0u, rewind.size());
+}
+
+TEST_F(Chip8Test, SaveState_FileRoundTrip) {
+  const std::string path = ::testing::TempDir() + "chip8_test.state";
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  board()->LoadBinary(kNoiseRom);
+  for (int frame = 0; frame < 20; ++frame)
+    board()->runFrame();
+  Chip8::BoardState saved, restored;
+  board()->saveState(saved);
+  ASSERT_EQ(Chip8::ResultType::Ok,
+            Chip8::saveStateFile(path.c_str(), *board()));
+
+  board()->setTimingMode(Chip8::TimingMode::Host);
+  board()->reset();
+  ASSERT_EQ(Chip8::ResultType::Ok,
+            Chip8::loadStateFile(path.c_str(), *board()));
+  EXPECT_EQ(Chip8::TimingMode::Vip, board()->timingMode());
+  board()->saveState(restored);
+  EXPECT_TRUE(sameState(saved, restored));
+
+  // Corrupted payload is rejected
+  std::FILE *file = std::fopen(path.c_str(), "r+b");
+  ASSERT_NE(nullptr, file);
+  std::fseek(file, sizeof(Chip8::SaveStateHeader) + 100, SEEK_SET);
+  std::fputc(0xAA, file);
+  std::fclose(file);
+  EXPECT_EQ(Chip8::ResultType::Error,
+            Chip8::loadStateFile(path.c_str(), *board()));
+  std::remove(path.c_str());
+}
+
+TEST_F(Chip8Test, RunAhead_PresentsFutureFrame) {
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  board()->LoadBinary(kNoiseRom);
+  auto shown = std::make_shared<Chip8::Video>();
+  Chip8::RunAhead runAhead(shown, 3);
+  for (int frame = 0; frame < 10; ++frame)
+    board()->runFrame();
+  runAhead.present(*board());
+
+  Chip8::BoardState real, presented;
+  for (int frame = 0; frame < 3; ++frame)
+    board()->runFrame();
+  board()->saveState(real);
+  shown->saveState(presented);
+  EXPECT_EQ(real.screen, presented.screen);
+}
+
+TEST_F(Chip8Test, RunAhead_ProbeSkipsInvisiblePresses) {
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  // LD V1, 5; SKNP V1; JP 0x208; JP 0x20E; LD F, V0; DRW V0, V0, 1;
+  // JP 0x20C; JP 0x202. Draws once while key 5 is held.
+  board()->LoadBinary({0x61, 0x05, 0xE1, 0xA1, 0x12, 0x08, 0x12, 0x0E, 0xF0,
+                       0x29, 0xD0, 0x01, 0x12, 0x0C, 0x12, 0x02});
+  Chip8::RunAhead runAhead(std::make_shared<Chip8::Video>(), 2);
+  auto press = [&](std::uint8_t key, int frames) {
+    runAhead.keyPressed();
+    board()->handleKey(key, true);
+    for (int frame = 0; frame < frames; ++frame) {
+      board()->runFrame();
+      runAhead.present(*board());
+    }
+    board()->handleKey(key, false);
+  };
+  // Key 3 does nothing, the next press replaces its probe
+  press(3, 5);
+  press(5, 5);
+  EXPECT_EQ(1u, runAhead.samples());
+  EXPECT_EQ(1u, runAhead.unanswered());
+  // Nothing changes any more, the probe times out
+  press(5, 70);
+  EXPECT_EQ(1u, runAhead.samples());
+  EXPECT_EQ(2u, runAhead.unanswered());
+}
+
+TEST_F(Chip8Test, Explorer_FindsKeyGatedCode) {
+  // LD V0, K; SE V0, 5; JP 0x200; LD V1, 1; JP 0x208
+  const std::vector<uint8_t> rom = {0xF0, 0x0A, 0x30, 0x05, 0x12,
+                                    0x00, 0x61, 0x01, 0x12, 0x08};
+  Chip8::ExplorerOptions options;
+  options.depth = 2;
+  options.framesPerInput = 2;
+  options.threads = 2;
+  Chip8::Explorer explorer(rom, options);
+  explorer.run();
+  ASSERT_EQ(2u, explorer.levels().size());
+  EXPECT_EQ(5u, explorer.coverage());
+  bool found = false;
+  for (const auto &discovery : explorer.discoveries()) {
+    if (0x206 == discovery.pc) {
+      found = true;
+      // First decision point only reaches LD V0, K, key 0 is tried first
+      EXPECT_EQ("05", Chip8::Explorer::formatPath(discovery.inputs));
+    }
+  }
+  EXPECT_TRUE(found);
+  // Waiting, key 5 pressed, and every other key looping back to LD V0, K
+  EXPECT_LE(explorer.uniqueStates(), 1u + Chip8::ExplorerInputs * 2);
+
+  // Counts add up over batches of one parent
+  options.depth = 3;
+  options.batch = 1;
+  Chip8::Explorer batched(rom, options);
+  batched.run();
+  ASSERT_EQ(3u, batched.levels().size());
+  EXPECT_EQ(Chip8::ExplorerInputs, batched.levels()[0].expanded);
+  for (std::size_t depth = 1; depth < 3; ++depth)
+    EXPECT_EQ(Chip8::ExplorerInputs * batched.levels()[depth - 1].unique,
+              batched.levels()[depth].expanded);
+  EXPECT_EQ(explorer.levels()[1].unique, batched.levels()[1].unique);
+
+  // Time does not matter, any memory byte does
+  Chip8::BoardState a, b;
+  board()->LoadBinary(rom);
+  board()->saveState(a);
+  b = a;
+  b.cycles += 100;
+  b.frame += 1;
+  EXPECT_EQ(Chip8::Explorer::hashState(a), Chip8::Explorer::hashState(b));
+  b.memory[0xFFF] ^= 1;
+  EXPECT_NE(Chip8::Explorer::hashState(a), Chip8::Explorer::hashState(b));
+}
+
+TEST_F(Chip8Test, Memory_CopyOnWriteFork) {
+  Chip8::Memory parent;
+  EXPECT_EQ(0u, parent.ownedPages());
+  ASSERT_EQ(Chip8::ResultType::Ok, parent.write(0x300, 0xAB));
+  EXPECT_EQ(1u, parent.ownedPages());
+  Chip8::Memory child = parent.fork();
+  EXPECT_EQ(0u, parent.ownedPages());
+  EXPECT_EQ(0u, child.ownedPages());
+  // Writes after the fork stay private to the writer
+  ASSERT_EQ(Chip8::ResultType::Ok, child.write(0x301, 0xCD));
+  ASSERT_EQ(Chip8::ResultType::Ok, parent.write(0x050, 0x00));
+  EXPECT_EQ(1u, child.ownedPages());
+  EXPECT_EQ(1u, parent.ownedPages());
+  uint8_t value;
+  ASSERT_EQ(Chip8::ResultType::Ok, parent.read(0x300, value));
+  EXPECT_EQ(0xAB, value);
+  ASSERT_EQ(Chip8::ResultType::Ok, parent.read(0x301, value));
+  EXPECT_EQ(0x00, value);
+  ASSERT_EQ(Chip8::ResultType::Ok, child.read(0x301, value));
+  EXPECT_EQ(0xCD, value);
+  // Font glyph '0' is intact in the child and in fresh instances
+  ASSERT_EQ(Chip8::ResultType::Ok, child.read(0x050, value));
+  EXPECT_EQ(0xF0, value);
+  Chip8::Memory fresh;
+  ASSERT_EQ(Chip8::ResultType::Ok, fresh.read(0x050, value));
+  EXPECT_EQ(0xF0, value);
+  EXPECT_EQ(Chip8::ResultType::OutOfRange, child.write(0x1000, 0));
+}
+
+TEST_F(Chip8Test, Board_ForkRunsIndependently) {
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  board()->LoadBinary(kNoiseRom);
+  for (int frame = 0; frame < 10; ++frame)
+    board()->runFrame();
+  auto fork = board()->fork(std::make_shared<Chip8::Video>(),
+                            std::make_shared<Chip8::Audio>());
+  Chip8::BoardState original, forked;
+  board()->saveState(original);
+  fork->saveState(forked);
+  EXPECT_TRUE(sameState(original, forked));
+  for (int frame = 0; frame < 10; ++frame)
+    fork->runFrame();
+  board()->saveState(forked);
+  EXPECT_TRUE(sameState(original, forked));
+  for (int frame = 0; frame < 10; ++frame)
+    board()->runFrame();
+  Chip8::BoardState a, b;
+  board()->saveState(a);
+  fork->saveState(b);
+  EXPECT_TRUE(sameState(a, b));
+}
+
+TEST_F(Chip8Test, Profiler_CountsAndStacks) {
+  Chip8::Profiler profiler;
+  // 0x200 CALL 0x300; 0x300 DRW; 0x302 RET; 0x202 LD V0, K (waiting)
+  profiler.record(0x200, 0x2300, 66, false);
+  profiler.record(0x300, 0xD015, 172, false);
+  profiler.record(0x302, 0x00EE, 50, false);
+  profiler.record(0x202, 0xF00A, 40, false);
+  profiler.record(0x204, 0x0000, 3668, true);
+  EXPECT_EQ(66u + 172 + 50 + 40 + 3668, profiler.cycles());
+  EXPECT_EQ(1u, profiler.opcodeClass(0xD).count);
+  EXPECT_EQ(172u, profiler.draw().cycles);
+  EXPECT_EQ(3668u, profiler.keyWait().cycles);
+  EXPECT_EQ(0u, profiler.pc(0x204).count);
+  auto hot = profiler.hot(2);
+  ASSERT_EQ(2u, hot.size());
+  EXPECT_EQ(0x300, hot[0].pc);
+  EXPECT_EQ(0x200, hot[1].pc);
+
+  std::FILE *out = std::tmpfile();
+  ASSERT_NE(nullptr, out);
+  profiler.writeCollapsed(out);
+  std::rewind(out);
+  char text[128] = {};
+  EXPECT_LT(0u, std::fread(text, 1, sizeof(text) - 1, out));
+  std::fclose(out);
+  EXPECT_STREQ("main 3774\nmain;sub_300 222\n", text);
+}
+
+#ifdef CHIP8_ENABLE_PROFILER
+TEST_F(Chip8Test, Profiler_FedByBoardStep) {
+  auto profiler = std::make_shared<Chip8::Profiler>();
+  board()->setProfiler(profiler);
+  // LD V0, 1; ADD V0, 1; JP 0x202
+  board()->LoadBinary({0x60, 0x01, 0x70, 0x01, 0x12, 0x02});
+  for (int it = 0; it < 21; ++it)
+    board()->step();
+  board()->setProfiler(nullptr);
+  EXPECT_EQ(1u, profiler->pc(0x200).count);
+  EXPECT_EQ(10u, profiler->pc(0x202).count);
+  EXPECT_EQ(10u, profiler->opcodeClass(0x1).count);
+  EXPECT_EQ(board()->cycles(), profiler->cycles());
+}
+#endif
+
+TEST_F(Chip8Test, AccessMap_CodeDataAndSelfModifying) {
+  auto map = std::make_shared<Chip8::AccessMap>();
+  board()->setAccessMap(map);
+  // LD I, 0x20A; LD V0, 0x61; LD [I], V0; JP 0x20A; (unused);
+  // LD V0, 0 patched into LD V1, 0; JP 0x20C
+  board()->LoadBinary({0xA2, 0x0A, 0x60, 0x61, 0xF0, 0x55, 0x12, 0x0A,
+                       0x00, 0x00, 0x60, 0x00, 0x12, 0x0C});
+  for (int it = 0; it < 6; ++it)
+    board()->step();
+  board()->setAccessMap(nullptr);
+  EXPECT_EQ(0x61, coreState().regs[0]);
+  EXPECT_EQ(1u, map->executions(0x200));
+  EXPECT_EQ(1u, map->writes(0x20A));
+  EXPECT_EQ(0u, map->reads(0x200));
+  // 0x208 is never reached
+  EXPECT_EQ(12u, map->executed(0x200, 0x20E));
+  EXPECT_EQ(std::vector<std::uint16_t>{0x20A}, map->selfModifying());
+  auto regions = map->regions();
+  ASSERT_EQ(3u, regions.size());
+  EXPECT_EQ(Chip8::AccessMap::Kind::Code, regions[0].kind);
+  EXPECT_EQ(0x208, regions[0].end);
+  EXPECT_EQ(Chip8::AccessMap::Kind::SelfModifying, regions[1].kind);
+  EXPECT_EQ(0x20A, regions[1].begin);
+  EXPECT_EQ(0x20B, regions[1].end);
+  EXPECT_EQ(Chip8::AccessMap::Kind::Code, regions[2].kind);
+  EXPECT_EQ(0x20E, regions[2].end);
+}
+
+TEST_F(Chip8Test, Trace_RecordDecodeAndDiff) {
+  const char *pathA = "Chip8_tests_a.trace";
+  const char *pathB = "Chip8_tests_b.trace";
+  for (const char *path : {pathA, pathB}) {
+    auto tracer = std::make_shared<Chip8::TraceRecorder>();
+    ASSERT_EQ(Chip8::ResultType::Ok, tracer->open(path));
+    board()->setSeed(path == pathA ? 1 : 2);
+    board()->reset();
+    board()->LoadBinary(kNoiseRom);
+    board()->setTracer(tracer);
+    for (int it = 0; it < 20000; ++it)
+      board()->step();
+    board()->setTracer(nullptr);
+    EXPECT_EQ(20000u, tracer->records());
+    ASSERT_EQ(Chip8::ResultType::Ok, tracer->close());
+  }
+
+  Chip8::TraceReader reader;
+  ASSERT_EQ(Chip8::ResultType::Ok, reader.open(pathA));
+  Chip8::TraceRecord record;
+  ASSERT_TRUE(reader.next(record));
+  // RND V1, 0xFF
+  EXPECT_EQ(0x200, record.pc);
+  EXPECT_EQ(0xC1FF, record.opcode);
+  EXPECT_EQ(0u, record.changed & ~(1u << 1));
+  std::size_t count = 1;
+  while (reader.next(record))
+    count++;
+  EXPECT_EQ(20000u, count);
+  // Six instruction loop, last record is LD V2, 0x1F
+  EXPECT_EQ(0x202, record.pc);
+  EXPECT_EQ(0x050 + 3, record.I);
+
+  bool diverged = true;
+  Chip8::TraceDivergence divergence;
+  ASSERT_EQ(Chip8::ResultType::Ok,
+            Chip8::compareTraces(pathA, pathA, diverged, divergence));
+  EXPECT_FALSE(diverged);
+  EXPECT_EQ(20000u, divergence.index);
+  ASSERT_EQ(Chip8::ResultType::Ok,
+            Chip8::compareTraces(pathA, pathB, diverged, divergence));
+  EXPECT_TRUE(diverged);
+  // Seeds differ, so the first RND results differ
+  EXPECT_LT(divergence.index, 6u);
+  EXPECT_NE(divergence.a.regs, divergence.b.regs);
+  std::remove(pathA);
+  std::remove(pathB);
+}
+
+TEST_F(Chip8Test, Trace_RecordsFetchFailure) {
+  const char *path = "Chip8_tests_fetch.trace";
+  auto tracer = std::make_shared<Chip8::TraceRecorder>();
+  ASSERT_EQ(Chip8::ResultType::Ok, tracer->open(path));
+  // JP 0xFFF, the second byte of the next opcode is past the end of memory
+  board()->LoadBinary({0x1F, 0xFF});
+  board()->setTracer(tracer);
+  board()->step();
+  board()->step();
+  board()->setTracer(nullptr);
+  ASSERT_EQ(Chip8::ResultType::Ok, tracer->close());
+
+  Chip8::TraceReader reader;
+  ASSERT_EQ(Chip8::ResultType::Ok, reader.open(path));
+  Chip8::TraceRecord record;
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(0x1FFF, record.opcode);
+  EXPECT_EQ(0u, record.changed & Chip8::TraceFetchFailed);
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(0xFFF, record.pc);
+  EXPECT_EQ(0, record.opcode);
+  EXPECT_NE(0u, record.changed & Chip8::TraceFetchFailed);
+  EXPECT_FALSE(reader.next(record));
+  std::remove(path);
+}
+
+TEST_F(Chip8Test, History_SeekReplaysAndIndexes) {
+  board()->setTimingMode(Chip8::TimingMode::Vip);
+  board()->LoadBinary(kNoiseRom);
+  auto history = std::make_shared<Chip8::History>(64);
+  board()->setHistory(history);
+  std::vector<Chip8::BoardState> states(3001);
+  for (int step = 0; step < 3000; ++step) {
+    // External input lands between steps and must be replayed
+    if (step % 97 == 0)
+      board()->handleKey(step % 16, step % 2 == 0);
+    board()->saveState(states[step]);
+    board()->step();
+  }
+  board()->saveState(states[3000]);
+  EXPECT_EQ(3000u, history->end());
+
+  // Replayed steps are not counted again
+  auto map = std::make_shared<Chip8::AccessMap>();
+  board()->setAccessMap(map);
+  for (std::uint64_t step : {0u, 1u, 63u, 64u, 65u, 1000u, 2999u, 3000u}) {
+    ASSERT_EQ(Chip8::ResultType::Ok, history->seek(*board(), step));
+    Chip8::BoardState state;
+    board()->saveState(state);
+    EXPECT_TRUE(sameState(states[step], state)) << "step " << step;
+  }
+  EXPECT_EQ(0u, map->executions(0x200));
+  EXPECT_EQ(map, board()->accessMap());
+  EXPECT_EQ(Chip8::ResultType::OutOfRange, history->seek(*board(), 3001));
+
+  // Six instruction loop: RND, RND, LD I, DRW, LD [I], JP
+  EXPECT_EQ(2998u, history->lastMemoryWrite(0x050, 3000));
+  EXPECT_EQ(2992u, history->lastMemoryWrite(0x050, 2998));
+  EXPECT_EQ(Chip8::History::None, history->lastMemoryWrite(0x300, 3000));
+  EXPECT_EQ(2997u, history->lastOpcodeClass(0xD, 3000));
+  EXPECT_EQ(2998u, history->lastRegisterWrite(Chip8::History::RegisterI, 3000));
+  EXPECT_EQ(2996u, history->lastRegisterWrite(Chip8::History::RegisterI, 2998));
+  EXPECT_EQ(Chip8::History::None, history->lastRegisterWrite(0x5, 3000));
+
+  // Stepping after a seek back drops the recorded future
+  ASSERT_EQ(Chip8::ResultType::Ok, history->seek(*board(), 1000));
+  board()->step();
+  EXPECT_EQ(1001u, history->end());
+  EXPECT_EQ(1000u, history->lastMemoryWrite(0x050, 3000));
+
+  // Loading a state from outside starts over from it
+  board()->loadState(states[2000]);
+  EXPECT_EQ(0u, history->end());
+  EXPECT_EQ(Chip8::History::None, history->lastMemoryWrite(0x050, 3000));
+  board()->step();
+  ASSERT_EQ(Chip8::ResultType::Ok, history->seek(*board(), 0));
+  Chip8::BoardState state;
+  board()->saveState(state);
+  EXPECT_TRUE(sameState(states[2000], state));
+}
+
+TEST_F(Chip8Test, History_IndexesKeyLoads) {
+  // LD V5, K; JP 0x202
+  board()->LoadBinary({0xF5, 0x0A, 0x12, 0x02});
+  auto history = std::make_shared<Chip8::History>(64);
+  board()->setHistory(history);
+  // LD V5, K, then two steps waiting for the key
+  for (int step = 0; step < 3; ++step)
+    board()->step();
+  board()->handleKey(0x7, true);
+  board()->step();
+  EXPECT_EQ(7, coreState().regs[5]);
+  EXPECT_EQ(2u, history->lastRegisterWrite(5, history->step()));
+
+  ASSERT_EQ(Chip8::ResultType::Ok, history->seek(*board(), 2));
+  EXPECT_EQ(0, coreState().regs[5]);
+  ASSERT_EQ(Chip8::ResultType::Ok, history->seek(*board(), 3));
+  EXPECT_EQ(7, coreState().regs[5]);
+}
+
+TEST_F(Chip8Test, Instruction_DisasmIntoBuffer) {
+  // Every instruction form, operands without leading zeros
+  const std::pair<std::uint16_t, const char *> expected[] = {
+      {0x00E0, "CLS"},
+      {0x00EE, "RET"},
+      {0x0123, "[UNKNOWN]"},
+      {0x1228, "JP 228"},
+      {0x100A, "JP A"},
+      {0x2FFF, "CALL FFF"},
+      {0x3305, "SE V3, 0x5"},
+      {0x4AFF, "SNE VA, 0xFF"},
+      {0x5120, "SE V1, V2"},
+      {0x6B00, "LD VB, 0x0"},
+      {0x7C1F, "ADD VC, 0x1F"},
+      {0x8010, "LD V0, V1"},
+      {0x8231, "OR V2, V3"},
+      {0x8452, "AND V4, V5"},
+      {0x8673, "XOR V6, V7"},
+      {0x8894, "ADD V8, V9"},
+      {0x8AB5, "SUB VA, VB"},
+      {0x8CD6, "SHR VC{, VD}"},
+      {0x8EF7, "SUBN VE, VF"},
+      {0x801E, "SHL V0{, V1}"},
+      {0x8018, "[UNKNOWN]"},
+      {0x9DE0, "SNE VD, VE"},
+      {0xA050, "LD I, 0x50"},
+      {0xB300, "JP V0, 0x300"},
+      {0xCF0F, "RND VF, 0xF"},
+      {0xDAB5, "DRW VA, VB, 0x5"},
+      {0xD120, "DRW V1, V2, 0x0"},
+      {0xE49E, "SKP V4"},
+      {0xE5A1, "SKNP V5"},
+      {0xE500, "[UNKNOWN]"},
+      {0xF607, "LD V6, DT"},
+      {0xF70A, "LD V7, K"},
+      {0xF815, "LD DT, V8"},
+      {0xF918, "LD ST, V9"},
+      {0xFA1E, "ADD I, VA"},
+      {0xFB29, "LD F, VB"},
+      {0xFC33, "LD B, VC"},
+      {0xFD55, "LD [I], VD"},
+      {0xFE65, "LD VE, [I]"},
+      {0xF000, "[UNKNOWN]"},
+  };
+  char text[Chip8::DisasmMaxLength];
+  for (const auto &entry : expected) {
+    const Chip8::Instruction instr(entry.first);
+    const std::size_t length = instr.disasm(text, sizeof(text));
+    EXPECT_STREQ(entry.second, text) << std::hex << entry.first;
+    EXPECT_EQ(std::strlen(entry.second), length) << std::hex << entry.first;
+    EXPECT_EQ(entry.second, instr.disasm()) << std::hex << entry.first;
+  }
+  for (std::uint32_t code = 0; code <= 0xFFFF; ++code) {
+    const Chip8::Instruction instr(code);
+    const std::size_t length = instr.disasm(text, sizeof(text));
+    ASSERT_LT(length, sizeof(text)) << code;
+    EXPECT_EQ(instr.valid(), std::string("[UNKNOWN]") != text) << code;
+  }
+  // Truncated, always terminated
+  Chip8::Instruction draw(0xDAB5);
+  EXPECT_EQ(3u, draw.disasm(text, 4));
+  EXPECT_STREQ("DRW", text);
+}
+
+namespace {
+std::string captured(const std::function<void(std::FILE *)> &write) {
+  std::FILE *file = std::tmpfile();
+  write(file);
+  std::string text(std::ftell(file), '\0');
+  std::rewind(file);
+  if (!text.empty() && std::fread(&text[0], 1, text.size(), file) == 0)
+    text.clear();
+  std::fclose(file);
+  return text;
+}
+} // namespace
+
+TEST_F(Chip8Test, Analysis_RecoversBlocksCallsAndData) {
+  const std::vector<uint8_t> rom = {
+      0x22, 0x08, // 200 CALL 208
+      0x30, 0x00, // 202 SE V0, 0x0
+      0x12, 0x00, // 204 JP 200
+      0x12, 0x04, // 206 JP 204
+      0xA2, 0x0E, // 208 LD I, 0x20E
+      0xD0, 0x05, // 20A DRW V0, V0, 0x5
+      0x00, 0xEE, // 20C RET
+      0xF0, 0x90, 0x90, 0x90, 0xF0};
+  Chip8::Analysis analysis;
+  ASSERT_EQ(Chip8::ResultType::Ok, analysis.analyze(rom));
+  EXPECT_EQ(14u, analysis.codeBytes());
+  EXPECT_EQ(Chip8::Analysis::Opcode, analysis.kind(0x20C));
+  EXPECT_EQ(Chip8::Analysis::Operand, analysis.kind(0x20D));
+  EXPECT_EQ(Chip8::Analysis::Data, analysis.kind(0x20E));
+
+  const auto &blocks = analysis.blocks();
+  ASSERT_EQ(4u, blocks.size());
+  EXPECT_EQ(0x200, blocks[0].start);
+  EXPECT_EQ(0x204, blocks[0].end);
+  EXPECT_EQ((std::vector<std::uint16_t>{0x204, 0x206}), blocks[0].successors);
+  EXPECT_EQ((std::vector<std::uint16_t>{0x200}), blocks[1].successors);
+  EXPECT_EQ((std::vector<std::uint16_t>{0x204}), blocks[2].successors);
+  EXPECT_EQ(0x200, blocks[2].function);
+  ASSERT_NE(nullptr, analysis.block(0x20A));
+  EXPECT_EQ(0x208, analysis.block(0x20A)->start);
+  EXPECT_EQ(0x208, analysis.block(0x20A)->function);
+  EXPECT_TRUE(analysis.block(0x20A)->successors.empty());
+  EXPECT_EQ(nullptr, analysis.block(0x20E));
+  ASSERT_EQ(1u, analysis.calls().size());
+  EXPECT_EQ(0x200, analysis.calls()[0].first);
+  EXPECT_EQ(0x208, analysis.calls()[0].second);
+
+  const std::string listing = captured(
+      [&](std::FILE *out) { analysis.writeListing(out); });
+  EXPECT_NE(std::string::npos, listing.find("sub_208:\n"));
+  EXPECT_NE(std::string::npos, listing.find("loc_206:\n"));
+  EXPECT_NE(std::string::npos,
+            listing.find("db 0xF0, 0x90, 0x90, 0x90, 0xF0\n"));
+  const std::string dot =
+      captured([&](std::FILE *out) { analysis.writeDot(out); });
+  EXPECT_NE(std::string::npos, dot.find("b200 -> b208 [style=dashed];"));
+  EXPECT_NE(std::string::npos, dot.find("b206 -> b204;"));
+
+  EXPECT_EQ(Chip8::ResultType::OutOfRange,
+            analysis.analyze(std::vector<uint8_t>(Chip8::MemorySize)));
+}
+
+TEST_F(Chip8Test, Breakpoints_ConditionsCompileToBytecode) {
+  board()->LoadBinary({0x63, 0x10, 0xA3, 0x10}); // LD V3, 0x10; LD I, 0x310
+  board()->LoadBinary({0x42}, 0x300);
+  board()->step();
+  board()->step();
+  auto holds = [&](const char *text) {
+    Chip8::Condition condition;
+    std::string reason;
+    EXPECT_EQ(Chip8::ResultType::Ok, condition.compile(text, reason))
+        << text << ": " << reason;
+    return condition.evaluate(*board());
+  };
+  EXPECT_TRUE(holds("V3 == 0x10 && I > 0x300"));
+  EXPECT_FALSE(holds("V3 == 0x10 && I > 0x310"));
+  EXPECT_TRUE(holds("v3 != 16 || PC == 0x204"));
+  EXPECT_TRUE(holds("[0x300] == 0x42 && [0x2FF + 1] == 66"));
+  EXPECT_TRUE(holds("V3 & 0x10 == 0x10"));
+  EXPECT_TRUE(holds("(V3 + 1) - 0x11 == 0"));
+  EXPECT_TRUE(holds("!(V0 || DT) && -V3 < 0 && ~0 == -1"));
+
+  Chip8::Condition condition;
+  std::string reason;
+  EXPECT_EQ(Chip8::ResultType::Error, condition.compile("V3 ==", reason));
+  EXPECT_NE(std::string::npos, reason.find("column 6"));
+  EXPECT_EQ(Chip8::ResultType::Error, condition.compile("VG == 1", reason));
+  EXPECT_EQ(Chip8::ResultType::Error, condition.compile("(V1", reason));
+}
+
+TEST_F(Chip8Test, Breakpoints_StopAndResume) {
+  // LD V0, 1; ADD V0, 1; LD I, 0x300; LD [I], V0; JP 0x202
+  board()->LoadBinary({0x60, 0x01, 0x70, 0x01, 0xA3, 0x00, 0xF0, 0x55, 0x12,
+                       0x02});
+  auto breakpoints = std::make_shared<Chip8::Breakpoints>();
+  EXPECT_FALSE(breakpoints->armed());
+  Chip8::Condition condition;
+  std::string reason;
+  ASSERT_EQ(Chip8::ResultType::Ok, condition.compile("V0 == 4", reason));
+  breakpoints->setExec(0x204, condition);
+  EXPECT_TRUE(breakpoints->armed());
+  board()->setBreakpoints(breakpoints);
+
+  auto runToBreak = [&]() {
+    board()->setBreak(false);
+    for (int it = 0; it < 100 && !board()->isBreak(); ++it)
+      board()->step();
+    return board()->isBreak();
+  };
+  // Stops in front of the instruction once the condition holds
+  ASSERT_TRUE(runToBreak());
+  EXPECT_EQ(Chip8::Breakpoints::HitKind::Exec, breakpoints->lastHit().kind);
+  EXPECT_EQ(0x204, board()->pc());
+  EXPECT_EQ(4, coreState().regs[0]);
+
+  // Resuming runs the instruction, the write watchpoint stops after it
+  breakpoints->clear(0x204);
+  breakpoints->setWrite(0x300, 0x301);
+  ASSERT_TRUE(runToBreak());
+  EXPECT_EQ(Chip8::Breakpoints::HitKind::Write, breakpoints->lastHit().kind);
+  EXPECT_EQ(0x300, breakpoints->lastHit().addr);
+  EXPECT_EQ(0x208, board()->pc());
+
+  breakpoints->clearAll();
+  ASSERT_EQ(Chip8::ResultType::Ok, condition.compile("V0 >= 7", reason));
+  breakpoints->addCondition(condition);
+  ASSERT_TRUE(runToBreak());
+  EXPECT_EQ(Chip8::Breakpoints::HitKind::Condition,
+            breakpoints->lastHit().kind);
+  EXPECT_EQ(7, coreState().regs[0]);
+  // Continuing from the stop does not stop again at the same place
+  board()->setBreak(false);
+  board()->step();
+  EXPECT_FALSE(board()->isBreak());
+  breakpoints->clearAll();
+  EXPECT_FALSE(breakpoints->armed());
+}
+
+TEST_F(Chip8Test, GdbServer_LoopbackSession) {
+  // LD V0, 5; ADD V0, 1; JP 0x202
+  board()->LoadBinary({0x60, 0x05, 0x70, 0x01, 0x12, 0x02});
+  auto breakpoints = std::make_shared<Chip8::Breakpoints>();
+  Chip8::GdbServer server(g_board, breakpoints);
+  ASSERT_EQ(Chip8::ResultType::Ok, server.listen(0));
+
+  const int client = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_LE(0, client);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(server.port());
+  ASSERT_EQ(0, connect(client, reinterpret_cast<sockaddr *>(&addr),
+                       sizeof(addr)));
+  for (int it = 0; it < 1000 && !server.connected(); ++it)
+    server.poll();
+  ASSERT_TRUE(server.connected());
+  EXPECT_TRUE(board()->isBreak());
+
+  std::string received;
+  // Services the server until one whole packet arrived, returns its payload
+  auto await = [&]() {
+    for (int it = 0; it < 100000; ++it) {
+      server.poll();
+      if (!board()->isBreak())
+        board()->step();
+      char buffer[512];
+      const ssize_t count =
+          recv(client, buffer, sizeof(buffer), MSG_DONTWAIT);
+      if (count > 0)
+        received.append(buffer, count);
+      const std::size_t begin = received.find('$');
+      const std::size_t end = received.find('#', begin);
+      if (std::string::npos != begin && std::string::npos != end &&
+          end + 3 <= received.size()) {
+        const std::string payload = received.substr(begin + 1, end - begin - 1);
+        received.erase(0, end + 3);
+        return payload;
+      }
+    }
+    return std::string("timeout");
+  };
+  auto request = [&](const std::string &payload) {
+    unsigned sum = 0;
+    for (char c : payload)
+      sum += static_cast<std::uint8_t>(c);
+    char tail[4];
+    std::snprintf(tail, sizeof(tail), "#%02x", sum & 0xFF);
+    const std::string packet = "$" + payload + tail;
+    EXPECT_EQ(static_cast<ssize_t>(packet.size()),
+              send(client, packet.data(), packet.size(), 0));
+    return await();
+  };
+
+  EXPECT_EQ("S05", request("?"));
+  // V0-VF, I, PC little endian, SP, DT, ST
+  const std::string regs = request("g");
+  ASSERT_EQ(2u * (21 + 2), regs.size());
+  EXPECT_EQ("0002", regs.substr(2 * 18, 4));
+  EXPECT_EQ("6005", request("m200,2"));
+  EXPECT_EQ("E01", request("m1000,1"));
+
+  EXPECT_EQ("T05", request("s"));
+  EXPECT_EQ("05", request("p0"));
+  EXPECT_EQ("OK", request("P0=09"));
+  EXPECT_EQ(9, coreState().regs[0]);
+
+  // Continue runs until the breakpoint, the stop arrives asynchronously
+  EXPECT_EQ("OK", request("Z0,204,2"));
+  EXPECT_EQ("T05swbreak:;", request("c"));
+  EXPECT_EQ("0402", request("p11"));
+  EXPECT_EQ(10, coreState().regs[0]);
+  EXPECT_EQ("OK", request("z0,204,2"));
+  EXPECT_FALSE(breakpoints->armed());
+
+  EXPECT_EQ("OK", request("M300,2:abcd"));
+  EXPECT_EQ("abcd", request("m300,2"));
+  EXPECT_EQ("OK", request("D"));
+  for (int it = 0; it < 1000 && server.connected(); ++it)
+    server.poll();
+  EXPECT_FALSE(server.connected());
+  EXPECT_FALSE(board()->isBreak());
+  close(client);
+}
+
+TEST_F(Chip8Test, Debugger_CommandQueue) {
+  // LD V0, 0; ADD V0, 1; JP 0x202
+  board()->LoadBinary({0x60, 0x00, 0x70, 0x01, 0x12, 0x02});
+  Chip8::Debugger debugger(board_sp());
+  Chip8::Debugger::Reply reply;
+  // Nothing queued, nothing answered
+  debugger.poll();
+  EXPECT_FALSE(debugger.receive(reply));
+
+  // Stepping stops the machine, the reply is a snapshot after the steps
+  ASSERT_TRUE(debugger.send("s 3"));
+  EXPECT_EQ(0x200, board()->pc());
+  debugger.poll();
+  ASSERT_TRUE(debugger.receive(reply));
+  EXPECT_TRUE(reply.answer);
+  EXPECT_TRUE(reply.paused);
+  EXPECT_EQ(0x202, reply.state.pc);
+  EXPECT_EQ(1, reply.state.regs[0]);
+  EXPECT_FALSE(debugger.receive(reply));
+  EXPECT_TRUE(board()->isBreak());
+
+  // A breakpoint on the way ends "s N" early and stays stopped in front of
+  // the instruction
+  ASSERT_TRUE(debugger.send("b 0x204 if V0 == 3"));
+  ASSERT_TRUE(debugger.send("s 10"));
+  debugger.poll();
+  ASSERT_TRUE(debugger.receive(reply));
+  EXPECT_EQ(0x202, reply.state.pc);
+  ASSERT_TRUE(debugger.receive(reply));
+  EXPECT_TRUE(reply.paused);
+  EXPECT_EQ(0x204, reply.state.pc);
+  EXPECT_EQ(3, reply.state.regs[0]);
+  EXPECT_TRUE(board()->isBreak());
+  EXPECT_EQ(0x204, board()->pc());
+
+  // Continue resumes past the breakpoint it stopped at
+  ASSERT_TRUE(debugger.send("c"));
+  debugger.poll();
+  ASSERT_TRUE(debugger.receive(reply));
+  EXPECT_FALSE(reply.paused);
+  EXPECT_FALSE(board()->isBreak());
+  for (int it = 0; it < 4; ++it)
+    board()->step();
+  EXPECT_FALSE(board()->isBreak());
+  EXPECT_EQ(5, coreState().regs[0]);
+}
+
+TEST_F(Chip8Test, TerminalVideo_DrawsOnlyChangedCells) {
+  // Renders without writing, no terminal attached
+  Chip8::TerminalVideo video(-1, Chip8::TerminalVideo::Glyphs::Braille);
+  video.reset();
+  EXPECT_EQ(32, video.columns());
+  EXPECT_EQ(8, video.rows());
+  // First frame clears the terminal and draws every cell
+  const std::string first = video.render();
+  EXPECT_EQ(0u, first.find("\x1b[2J"));
+  EXPECT_EQ(std::string::npos, first.find("\x1b[2J", 1));
+  EXPECT_LT(32u * 8 * 3, first.size());
+  EXPECT_TRUE(video.render().empty());
+
+  // Upper left pixel of cell (1, 2) is braille dot 1
+  video.flipBit(2, 8, true);
+  EXPECT_EQ("\x1b[3;2H\xE2\xA0\x81", video.render());
+  // Neighbouring changes on one row share the cursor move
+  video.flipBit(2, 8, true);
+  video.flipBit(8, 8, true);
+  EXPECT_EQ("\x1b[3;2H\xE2\xA0\x80\xE2\xA0\x80\xE2\xA0\x80"
+            "\xE2\xA0\x81",
+            video.render());
+
+  Chip8::TerminalVideo quadrant(-1, Chip8::TerminalVideo::Glyphs::Quadrant);
+  quadrant.reset();
+  EXPECT_EQ(16, quadrant.rows());
+  quadrant.render();
+  // Lower half of cell (0, 0) is U+2584
+  quadrant.flipBit(0, 1, true);
+  quadrant.flipBit(1, 1, true);
+  EXPECT_EQ("\x1b[1;1H\xE2\x96\x84", quadrant.render());
+  quadrant.invalidate();
+  EXPECT_LT(32u * 16, quadrant.render().size());
+}
+
+TEST_F(Chip8Test, WavAudio_RecordsBeepAtEmulatedTime) {
+  auto audio = std::make_shared<Chip8::WavAudio>();
+  Chip8::Board board(std::make_shared<Chip8::Video>(), audio);
+  audio->attach(board);
+  board.setTimingMode(Chip8::TimingMode::Vip);
+  board.reset();
+  // LD V0, 30; LD ST, V0; JP 0x204
+  board.LoadBinary({0x60, 0x1E, 0xF0, 0x18, 0x12, 0x04});
+  while (board.frame() < 60)
+    board.step();
+
+  // Sounds from the first timer tick until ST runs out 29 ticks later
+  const auto &transitions = audio->transitions();
+  ASSERT_EQ(2u, transitions.size());
+  EXPECT_EQ(1u * Chip8::VipCyclesPerFrame, transitions[0]);
+  EXPECT_EQ(30u * Chip8::VipCyclesPerFrame, transitions[1]);
+  EXPECT_EQ(29u * Chip8::VipCyclesPerFrame,
+            audio->beepCycles(board.cycles()));
+
+  const unsigned rate = 8000;
+  const std::uint64_t end = Chip8::WavAudio::sampleAt(board.cycles(), rate);
+  std::vector<std::int16_t> samples(end);
+  audio->render(rate, 0, samples.size(), samples.data());
+  const std::uint64_t start = Chip8::WavAudio::sampleAt(transitions[0], rate);
+  const std::uint64_t stop = Chip8::WavAudio::sampleAt(transitions[1], rate);
+  std::size_t loud = 0;
+  for (std::size_t it = 0; it < samples.size(); ++it) {
+    if (it < start || it >= stop)
+      EXPECT_EQ(0, samples[it]);
+    else
+      loud += 0 != samples[it];
+  }
+  EXPECT_EQ(stop - start, loud);
+  // Rendering in pieces gives the same samples
+  std::vector<std::int16_t> piece(100);
+  audio->render(rate, start - 30, piece.size(), piece.data());
+  EXPECT_TRUE(std::equal(piece.begin(), piece.end(),
+                         samples.begin() + (start - 30)));
+
+  const std::string path = ::testing::TempDir() + "chip8_beep.wav";
+  ASSERT_EQ(Chip8::ResultType::Ok,
+            audio->writeWav(path.c_str(), rate, board.cycles()));
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  std::fseek(file, 0, SEEK_END);
+  EXPECT_EQ(static_cast<long>(44 + 2 * end), std::ftell(file));
+  std::fclose(file);
+  std::remove(path.c_str());
+
+  // Going back in time drops the recorded future
+  Chip8::BoardState state;
+  board.saveState(state);
+  state.frame = 10;
+  state.beep = 1;
+  board.loadState(state);
+  EXPECT_EQ(1u, audio->transitions().size());
+  audio->clear();
+  ASSERT_EQ(1u, audio->transitions().size());
+  EXPECT_EQ(10u * Chip8::VipCyclesPerFrame, audio->transitions()[0]);
+}
+
+TEST_F(Chip8Test, FrameRecorder_StoresRunsOfIdenticalFrames) {
+  Chip8::Video video;
+  video.reset();
+  const std::string path = ::testing::TempDir() + "chip8_frames.raw";
+  Chip8::FrameRecorder recorder;
+  ASSERT_EQ(Chip8::ResultType::Ok,
+            recorder.open(path.c_str(), Chip8::FrameFormat::Raw, 2));
+  for (int it = 0; it < 3; ++it)
+    recorder.capture(video);
+  video.flipBit(1, 0, true);
+  for (int it = 0; it < 2; ++it)
+    recorder.capture(video);
+  ASSERT_EQ(Chip8::ResultType::Ok, recorder.close());
+  EXPECT_EQ(5u, recorder.frames());
+  EXPECT_EQ(2u, recorder.stored());
+
+  auto read = [](const std::string &name) {
+    std::string data;
+    std::FILE *file = std::fopen(name.c_str(), "rb");
+    if (!file)
+      return data;
+    char buffer[4096];
+    std::size_t count;
+    while (0 < (count = std::fread(buffer, 1, sizeof(buffer), file)))
+      data.append(buffer, count);
+    std::fclose(file);
+    return data;
+  };
+  // One scaled picture per run, the index holds the timing
+  const std::string frames = read(path);
+  const std::size_t size = 128 * 64;
+  ASSERT_EQ(2 * size, frames.size());
+  EXPECT_EQ(16, frames[2]);
+  EXPECT_EQ(235, static_cast<std::uint8_t>(frames[size + 2]));
+  EXPECT_EQ(235, static_cast<std::uint8_t>(frames[size + 128 + 3]));
+  EXPECT_EQ(16, frames[size + 4]);
+  EXPECT_EQ("# 128x64 gray8, frame repeat\n0 3\n3 2\n", read(path + ".idx"));
+  std::remove(path.c_str());
+  std::remove((path + ".idx").c_str());
+
+  // Y4M repeats every frame in full
+  const std::string y4m = ::testing::TempDir() + "chip8_frames.y4m";
+  ASSERT_EQ(Chip8::ResultType::Ok,
+            recorder.open(y4m.c_str(), Chip8::FrameFormat::Y4m, 1));
+  for (int it = 0; it < 4; ++it)
+    recorder.capture(video);
+  ASSERT_EQ(Chip8::ResultType::Ok, recorder.close());
+  const std::string stream = read(y4m);
+  const std::string header = "YUV4MPEG2 W64 H32 F60:1 Ip A1:1 C420jpeg\n";
+  EXPECT_EQ(0u, stream.find(header));
+  EXPECT_EQ(header.size() + 4 * (6 + 64 * 32 + 2 * 32 * 16), stream.size());
+  std::remove(y4m.c_str());
+}
+
+TEST_F(Chip8Test, FrameRecorder_KeepsEveryChangingFrame) {
+  Chip8::Video video;
+  video.reset();
+  const std::string path = ::testing::TempDir() + "chip8_changing.raw";
+  Chip8::FrameRecorder recorder;
+  ASSERT_EQ(Chip8::ResultType::Ok,
+            recorder.open(path.c_str(), Chip8::FrameFormat::Raw, 1));
+  // Many more runs than the writer queue holds, captured without pause
+  const std::uint64_t count = 10000;
+  for (std::uint64_t it = 0; it < count; ++it) {
+    video.flipBit(it % 64, it / 64 % 32, true);
+    recorder.capture(video);
+  }
+  ASSERT_EQ(Chip8::ResultType::Ok, recorder.close());
+  EXPECT_EQ(count, recorder.frames());
+  EXPECT_EQ(count, recorder.stored());
+
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  std::fseek(file, 0, SEEK_END);
+  EXPECT_EQ(static_cast<long>(count * 64 * 32), std::ftell(file));
+  std::fclose(file);
+  // One "frame 1" line per frame, in order
+  std::FILE *index = std::fopen((path + ".idx").c_str(), "r");
+  ASSERT_NE(nullptr, index);
+  char line[64];
+  ASSERT_NE(nullptr, std::fgets(line, sizeof(line), index));
+  std::uint64_t frames = 0;
+  unsigned long long first;
+  unsigned repeat;
+  while (2 == std::fscanf(index, "%llu %u", &first, &repeat)) {
+    EXPECT_EQ(frames, first);
+    EXPECT_EQ(1u, repeat);
+    frames++;
+  }
+  std::fclose(index);
+  EXPECT_EQ(count, frames);
+  std::remove(path.c_str());
+  std::remove((path + ".idx").c_str());
+}
+
+TEST_F(Chip8Test, SharedEnv_AgentDrivesInstance) {
+  const std::string name = "/chip8_test_" + std::to_string(getpid());
+  Chip8::SharedRegion server;
+  ASSERT_EQ(Chip8::ResultType::Ok, server.create(name.c_str(), 2));
+  // SKNP V1 (key 5); ADD V0, 1; JP 0x200
+  const std::vector<std::uint8_t> rom = {0x61, 0x05, 0xE1, 0xA1,
+                                         0x70, 0x01, 0x12, 0x02};
+  std::thread emulator([&]() {
+    Chip8::Board board(std::make_shared<Chip8::Video>(),
+                       std::make_shared<Chip8::Audio>());
+    board.setTimingMode(Chip8::TimingMode::Vip);
+    board.reset();
+    board.LoadBinary(rom);
+    server.serve(board, 1, rom);
+  });
+
+  // The agent maps the region on its own, as another process would
+  Chip8::SharedRegion agent;
+  ASSERT_EQ(Chip8::ResultType::Ok, agent.open(name.c_str()));
+  EXPECT_EQ(2u, agent.slots());
+  Chip8::SharedSlot &slot = agent.slot(1);
+  std::uint32_t seen = 0;
+  slot.waitFrame(seen);
+  seen = slot.frameSeq.load();
+  EXPECT_EQ(0u, slot.state.frame);
+
+  // V0 only counts while key 5 is held
+  std::uint8_t count = 0;
+  for (int it = 0; it < 100; ++it) {
+    slot.act(it < 50 ? 1u << 5 : 0);
+    slot.waitFrame(seen);
+    seen = slot.frameSeq.load();
+    EXPECT_EQ(static_cast<std::uint64_t>(it + 1), slot.state.frame);
+    EXPECT_EQ(Chip8::SharedSlot::Running, slot.status);
+    if (50 == it)
+      count = slot.state.regs[0];
+  }
+  EXPECT_LT(0, count);
+  EXPECT_EQ(count, slot.state.regs[0]);
+
+  slot.framesPerAction = 10;
+  slot.act(0, Chip8::SharedSlot::Reset);
+  slot.waitFrame(seen);
+  seen = slot.frameSeq.load();
+  EXPECT_EQ(10u, slot.state.frame);
+  EXPECT_EQ(0, slot.state.regs[0]);
+
+  slot.act(0, Chip8::SharedSlot::Quit);
+  emulator.join();
+  agent.close();
+  server.close();
+  // The creator unlinked the object
+  EXPECT_EQ(Chip8::ResultType::Error, agent.open(name.c_str()));
+}
+
+TEST_F(Chip8Test, CApi_StepsAndObservesAllMachines) {
+  EXPECT_EQ(CHIP8_ABI_VERSION, chip8_abi_version());
+  // LD V1, 5; SKNP V1; JP 0x208; JP 0x20E; LD F, V0; DRW V0, V0, 1;
+  // JP 0x20C; JP 0x202. Draws the top row of font 0 once key 5 is held.
+  const std::vector<std::uint8_t> rom = {0x61, 0x05, 0xE1, 0xA1, 0x12, 0x08,
+                                         0x12, 0x0E, 0xF0, 0x29, 0xD0, 0x01,
+                                         0x12, 0x0C, 0x12, 0x02};
+  EXPECT_EQ(nullptr, chip8_envs_create(0, rom.data(), rom.size(), 0));
+  chip8_envs *envs = chip8_envs_create(3, rom.data(), rom.size(), 1);
+  ASSERT_NE(nullptr, envs);
+  EXPECT_EQ(3u, chip8_envs_count(envs));
+
+  const std::uint16_t keys[3] = {1u << 5, 0, 1u << 5};
+  std::vector<std::uint8_t> out(3 * CHIP8_OBSERVATION_SIZE, 0xAA);
+  ASSERT_EQ(0, chip8_envs_step(envs, keys, 2, out.data()));
+  for (unsigned env = 0; env < 3; ++env) {
+    const std::uint8_t *screen = out.data() + env * CHIP8_OBSERVATION_SIZE;
+    const std::uint8_t lit = 1 == env ? 0 : 1;
+    for (int x = 0; x < 8; ++x)
+      EXPECT_EQ(x < 4 ? lit : 0, screen[x]) << env << " " << x;
+    EXPECT_EQ(0, screen[64]);
+  }
+  std::vector<std::uint8_t> again(out.size());
+  ASSERT_EQ(0, chip8_envs_observe(envs, again.data()));
+  EXPECT_EQ(out, again);
+
+  const std::uint8_t mask[3] = {1, 0, 0};
+  ASSERT_EQ(0, chip8_envs_reset(envs, mask));
+  ASSERT_EQ(0, chip8_envs_observe(envs, again.data()));
+  EXPECT_EQ(0, again[0]);
+  EXPECT_EQ(1, again[2 * CHIP8_OBSERVATION_SIZE]);
+
+  std::uint8_t status[3];
+  ASSERT_EQ(0, chip8_envs_status(envs, status));
+  EXPECT_EQ(CHIP8_STATUS_RUNNING, status[0]);
+  EXPECT_EQ(-1, chip8_envs_step(envs, nullptr, 1, nullptr));
+  chip8_envs_destroy(envs);
+}
+
+TEST_F(Chip8Test, VideoAtlas_UploadsOnlyChangedTileRows) {
+  Chip8::VideoAtlas atlas(5, 2);
+  EXPECT_EQ(3u, atlas.rows());
+  EXPECT_EQ(128u, atlas.width());
+  EXPECT_EQ(96u, atlas.height());
+  EXPECT_EQ(16u, Chip8::VideoAtlas(512).columns());
+
+  Chip8::Video video;
+  video.reset();
+  video.updateLeds();
+  EXPECT_FALSE(atlas.update(3, video));
+  EXPECT_FALSE(atlas.dirty());
+
+  video.flipBit(2, 1, true);
+  video.updateLeds();
+  EXPECT_TRUE(atlas.update(3, video));
+  EXPECT_FALSE(atlas.update(3, video));
+  EXPECT_TRUE(atlas.update(4, video));
+  EXPECT_FALSE(atlas.update(5, video));
+  EXPECT_EQ(2u, atlas.changedTiles());
+  // Tile 3 is row 1, tile 4 row 2
+  EXPECT_EQ(32u, atlas.dirtyTop());
+  EXPECT_EQ(64u, atlas.dirtyHeight());
+  const std::uint32_t lit = atlas.pixels()[(32 + 1) * 128 + 64 + 2];
+  EXPECT_EQ(0xFF000000u, lit & 0xFF000000u);
+  EXPECT_NE(0xFF000000u, lit);
+  EXPECT_EQ(0xFF000000u, atlas.pixels()[(32 + 1) * 128 + 2]);
+
+  atlas.clearDirty();
+  EXPECT_FALSE(atlas.dirty());
+  EXPECT_EQ(0u, atlas.dirtyHeight());
+}
+
+TEST_F(Chip8Test, Upscaler_KernelsMatchScalar) {
+  Chip8::Upscaler::Leds leds = {};
+  // Diagonal line, Scale2x rounds its steps
+  for (unsigned i = 0; i < 16; ++i)
+    leds[4 + i][10 + i] = 0xFF;
+  leds[0][63] = 0x80;
+
+  const unsigned effects[] = {0, Chip8::UpscaleScanlines,
+                              Chip8::UpscaleScanlines | Chip8::UpscaleGrid};
+  for (Chip8::UpscaleFilter filter :
+       {Chip8::UpscaleFilter::Nearest, Chip8::UpscaleFilter::Scale2x}) {
+    for (unsigned effect : effects) {
+      Chip8::Upscaler upscaler(5, filter, effect);
+      upscaler.setSimd(Chip8::SimdLevel::Scalar);
+      const std::size_t size = upscaler.width() * upscaler.height();
+      std::vector<std::uint32_t> expected(size);
+      upscaler.run(leds, expected.data(), upscaler.width() * 4);
+      for (Chip8::SimdLevel level :
+           {Chip8::SimdLevel::Sse2, Chip8::SimdLevel::Avx2}) {
+        upscaler.setSimd(level);
+        std::vector<std::uint32_t> out(size);
+        upscaler.run(leds, out.data(), upscaler.width() * 4);
+        EXPECT_EQ(expected, out) << Chip8::simdName(upscaler.simd());
+      }
+    }
+  }
+
+  Chip8::Upscaler nearest(3);
+  EXPECT_EQ(192u, nearest.width());
+  std::vector<std::uint32_t> out(nearest.width() * nearest.height());
+  nearest.run(leds, out.data(), nearest.width() * 4);
+  EXPECT_EQ(0xFFFFFFFFu, out[(4 * 3 + 2) * 192 + 10 * 3 + 2]);
+  EXPECT_EQ(0xFF000000u, out[(4 * 3) * 192 + 11 * 3]);
+  EXPECT_EQ(0xFF808080u, out[191]);
+
+  // Odd scales round down for Scale2x
+  Chip8::Upscaler epx(5, Chip8::UpscaleFilter::Scale2x);
+  EXPECT_EQ(4u, epx.scale());
+  out.assign(epx.width() * epx.height(), 0);
+  epx.run(leds, out.data(), epx.width() * 4);
+  // Dark (11, 4) sits in the step, its lower left quarter fills in
+  EXPECT_EQ(0xFF000000u, out[(4 * 4) * 256 + 11 * 4]);
+  EXPECT_EQ(0xFFFFFFFFu, out[(4 * 4 + 3) * 256 + 11 * 4]);
+  EXPECT_EQ(0xFF000000u, out[(4 * 4 + 3) * 256 + 11 * 4 + 3]);
+
+  Chip8::Upscaler lines(4, Chip8::UpscaleFilter::Nearest,
+                        Chip8::UpscaleScanlines);
+  out.assign(lines.width() * lines.height(), 0);
+  lines.run(leds, out.data(), lines.width() * 4);
+  EXPECT_EQ(0xFFFFFFFFu, out[(4 * 4 + 2) * 256 + 10 * 4]);
+  EXPECT_EQ(0xFF7F7F7Fu, out[(4 * 4 + 3) * 256 + 10 * 4]);
+}
+
 // INSTANTIATE_TEST_CASE_P(
 //    Chip8Test_RegsAnd8bitValsInstance, Chip8Test_RegsAnd8bitVals,
 //    ::testing::Combine(::testing::Range<uint8_t>(0, 0xf + 1),